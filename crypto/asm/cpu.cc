@@ -10,9 +10,11 @@
 #include "crypto/cpu.hh"
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 
 #if defined(ARCH_CPU_X86_FAMILY)
 #if defined(_MSC_VER)
@@ -40,12 +42,123 @@ CPU::CPU()
     has_sse42_(false),
     has_avx_(false),
     has_avx_hardware_(false),
+    has_avx2_(false),
     has_aesni_(false),
+    has_pclmulqdq_(false),
+    has_bmi2_(false),
+    has_adx_(false),
+    has_sha_(false),
+    has_vaes_(false),
+    has_vpclmulqdq_(false),
     has_non_stop_time_stamp_counter_(false),
     cpu_vendor_("unknown") {
   Initialize();
 }
 
+CPU::CPU(uint32_t disabled_features) : CPU() {
+  Mask(disabled_features);
+}
+
+namespace {
+
+// Features disabled with CPU::DisableFeatures().
+std::atomic<uint32_t> g_disabled_features(0);
+
+// Set when CPU::Get() starts to query the processor, after which disabling
+// features has no effect.
+std::atomic<bool> g_cpu_queried(false);
+
+const struct {
+  const char* name;
+  CPU::Feature feature;
+} kFeatureNames[] = {
+  { "sse2", CPU::FEATURE_SSE2 },
+  { "ssse3", CPU::FEATURE_SSSE3 },
+  { "sse41", CPU::FEATURE_SSE41 },
+  { "sse42", CPU::FEATURE_SSE42 },
+  { "avx", CPU::FEATURE_AVX },
+  { "avx2", CPU::FEATURE_AVX2 },
+  { "aesni", CPU::FEATURE_AESNI },
+  { "pclmulqdq", CPU::FEATURE_PCLMULQDQ },
+  { "bmi2", CPU::FEATURE_BMI2 },
+  { "adx", CPU::FEATURE_ADX },
+  { "sha", CPU::FEATURE_SHA },
+  { "vaes", CPU::FEATURE_VAES },
+  { "vpclmulqdq", CPU::FEATURE_VPCLMULQDQ },
+};
+
+}  // anonymous namespace
+
+// static
+const CPU& CPU::Get() {
+  // C++11 guarantees that this is initialized once, even if several threads
+  // get here at the same time.
+  static const CPU cpu = []() {
+    g_cpu_queried = true;
+    uint32_t disabled = g_disabled_features;
+    const char* env = getenv("LIBSEAL_DISABLE_CPU_FEATURES");
+    if (env != NULL)
+      disabled |= ParseFeatureList(env);
+
+    return CPU(disabled);
+  }();
+  return cpu;
+}
+
+// static
+bool CPU::DisableFeatures(uint32_t features) {
+  g_disabled_features |= features;
+  return !g_cpu_queried;
+}
+
+// static
+uint32_t CPU::ParseFeatureList(const std::string& list) {
+  uint32_t features = 0;
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = std::min(list.find(',', start), list.size());
+    std::string name = list.substr(start, end - start);
+    for (size_t i = 0; i < sizeof(kFeatureNames) / sizeof(kFeatureNames[0]);
+         i++) {
+      if (name == kFeatureNames[i].name)
+        features |= kFeatureNames[i].feature;
+    }
+    start = end + 1;
+  }
+  return features;
+}
+
+void CPU::Mask(uint32_t features) {
+  if (features & FEATURE_SSE2) has_sse2_ = false;
+  if (features & FEATURE_SSSE3) has_ssse3_ = false;
+  if (features & FEATURE_SSE41) has_sse41_ = false;
+  if (features & FEATURE_SSE42) has_sse42_ = false;
+  if (features & FEATURE_AVX) has_avx_ = false;
+  if (features & FEATURE_AVX2) has_avx2_ = false;
+  if (features & FEATURE_AESNI) has_aesni_ = false;
+  if (features & FEATURE_PCLMULQDQ) has_pclmulqdq_ = false;
+  if (features & FEATURE_BMI2) has_bmi2_ = false;
+  if (features & FEATURE_ADX) has_adx_ = false;
+  if (features & FEATURE_SHA) has_sha_ = false;
+  if (features & FEATURE_VAES) has_vaes_ = false;
+  if (features & FEATURE_VPCLMULQDQ) has_vpclmulqdq_ = false;
+
+  // Clear the features which build on the masked ones, so that the code
+  // which checks only for the newest feature it uses does not run either.
+  has_ssse3_ = has_ssse3_ && has_sse2_;
+  has_sse41_ = has_sse41_ && has_ssse3_;
+  has_sse42_ = has_sse42_ && has_sse41_;
+  has_avx_ = has_avx_ && has_sse42_;
+
+  // These use the AVX register state.
+  has_avx2_ = has_avx2_ && has_avx_;
+  has_vaes_ = has_vaes_ && has_avx_ && has_aesni_;
+  has_vpclmulqdq_ = has_vpclmulqdq_ && has_avx_ && has_pclmulqdq_;
+
+  // The SHA-NI code shuffles the bytes with pshufb and uses SSE4.1.
+  has_sha_ = has_sha_ && has_sse41_;
+}
+
 namespace {
 
 #ifndef _MSC_VER
@@ -58,7 +171,7 @@ void __cpuid(int cpu_info[4], int info_type) {
     "cpuid\n"
     "xchg %%edi, %%ebx\n"
     : "=a"(cpu_info[0]), "=D"(cpu_info[1]), "=c"(cpu_info[2]), "=d"(cpu_info[3])
-    : "a"(info_type)
+    : "a"(info_type), "c"(0)
   );
 }
 
@@ -68,7 +181,7 @@ void __cpuid(int cpu_info[4], int info_type) {
   __asm__ volatile (
     "cpuid \n\t"
     : "=a"(cpu_info[0]), "=b"(cpu_info[1]), "=c"(cpu_info[2]), "=d"(cpu_info[3])
-    : "a"(info_type)
+    : "a"(info_type), "c"(0)
   );
 }
 
@@ -139,6 +252,21 @@ void CPU::Initialize() {
         (cpu_info[2] & 0x08000000) != 0 /* OSXSAVE */ &&
         (_xgetbv(0) & 6) == 6 /* XSAVE enabled by kernel */;
     has_aesni_ = (cpu_info[2] & 0x02000000) != 0;
+    has_pclmulqdq_ = (cpu_info[2] & 0x00000002) != 0;
+  }
+
+  // Leaf 7 has sub-leaves, and the extended features are in sub-leaf 0,
+  // which is why __cpuid() above always clears ECX. The ones which use the
+  // YMM registers also need the kernel to save them, as checked with xgetbv
+  // for AVX above; BMI2, ADX and SHA only use the older registers.
+  if (num_ids >= 7) {
+    __cpuid(cpu_info, 7);
+    has_avx2_ = has_avx_ && (cpu_info[1] & 0x00000020) != 0;
+    has_bmi2_ = (cpu_info[1] & 0x00000100) != 0;
+    has_adx_ = (cpu_info[1] & 0x00080000) != 0;
+    has_sha_ = (cpu_info[1] & 0x20000000) != 0;
+    has_vaes_ = has_avx_ && (cpu_info[2] & 0x00000200) != 0;
+    has_vpclmulqdq_ = has_avx_ && (cpu_info[2] & 0x00000400) != 0;
   }
 
   // Get the brand string of the cpu.
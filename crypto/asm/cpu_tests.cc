@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include "crypto/cipher/aes.hh"
+#include "crypto/hash/sha1.hh"
+#include "crypto/cpu.hh"
+
+#include <cstdlib>
+
+TEST(CPU, ParseFeatureList) {
+    EXPECT_EQ(0u, crypto::CPU::ParseFeatureList(""));
+    EXPECT_EQ(uint32_t(crypto::CPU::FEATURE_AVX2 | crypto::CPU::FEATURE_AESNI),
+              crypto::CPU::ParseFeatureList("avx2,aesni"));
+    EXPECT_EQ(uint32_t(crypto::CPU::FEATURE_SHA),
+              crypto::CPU::ParseFeatureList("bogus,,sha"));
+}
+
+TEST(CPU, Consistency) {
+    crypto::CPU cpu;
+
+    // The features which need the AVX state are never reported without it
+    if (!cpu.has_avx()) {
+        EXPECT_FALSE(cpu.has_avx2());
+        EXPECT_FALSE(cpu.has_vaes());
+        EXPECT_FALSE(cpu.has_vpclmulqdq());
+    }
+}
+
+// Masking a feature hides everything which builds on it, and nothing else
+TEST(CPU, MaskCascade) {
+    crypto::CPU cpu;
+
+    crypto::CPU no_ssse3(crypto::CPU::FEATURE_SSSE3);
+    EXPECT_FALSE(no_ssse3.has_ssse3());
+    EXPECT_FALSE(no_ssse3.has_sse41());
+    EXPECT_FALSE(no_ssse3.has_sse42());
+    EXPECT_FALSE(no_ssse3.has_avx());
+    EXPECT_FALSE(no_ssse3.has_avx2());
+    EXPECT_FALSE(no_ssse3.has_vaes());
+    EXPECT_FALSE(no_ssse3.has_vpclmulqdq());
+    EXPECT_FALSE(no_ssse3.has_sha());
+    EXPECT_EQ(cpu.has_sse2(), no_ssse3.has_sse2());
+    EXPECT_EQ(cpu.has_aesni(), no_ssse3.has_aesni());
+    EXPECT_EQ(cpu.has_pclmulqdq(), no_ssse3.has_pclmulqdq());
+    EXPECT_EQ(cpu.has_bmi2(), no_ssse3.has_bmi2());
+
+    crypto::CPU no_sse41(crypto::CPU::FEATURE_SSE41);
+    EXPECT_EQ(cpu.has_ssse3(), no_sse41.has_ssse3());
+    EXPECT_FALSE(no_sse41.has_sse41());
+    EXPECT_FALSE(no_sse41.has_avx());
+    EXPECT_FALSE(no_sse41.has_sha());
+
+    crypto::CPU no_avx(crypto::CPU::FEATURE_AVX);
+    EXPECT_EQ(cpu.has_sse42(), no_avx.has_sse42());
+    EXPECT_EQ(cpu.has_sha(), no_avx.has_sha());
+    EXPECT_FALSE(no_avx.has_avx2());
+    EXPECT_FALSE(no_avx.has_vaes());
+
+    crypto::CPU no_aesni(crypto::CPU::FEATURE_AESNI);
+    EXPECT_FALSE(no_aesni.has_vaes());
+    EXPECT_EQ(cpu.has_avx2(), no_aesni.has_avx2());
+    EXPECT_EQ(cpu.has_vpclmulqdq(), no_aesni.has_vpclmulqdq());
+
+    crypto::CPU no_pclmulqdq(crypto::CPU::FEATURE_PCLMULQDQ);
+    EXPECT_FALSE(no_pclmulqdq.has_vpclmulqdq());
+    EXPECT_EQ(cpu.has_vaes(), no_pclmulqdq.has_vaes());
+}
+
+// Disables features for CPU::Get() and checks that the factories fall back.
+// The mask only takes effect if nothing has called CPU::Get() yet; under
+// --gtest_repeat the later iterations see the mask of the first one.
+TEST(CPU, DisableFeatures) {
+    crypto::CPU cpu;
+    uint32_t disabled = crypto::CPU::FEATURE_AESNI |
+                        crypto::CPU::FEATURE_SSSE3;
+    static const bool disabled_in_time =
+        crypto::CPU::DisableFeatures(disabled);
+    ASSERT_TRUE(disabled_in_time) << "CPU::Get() was called before";
+
+    const crypto::CPU &masked = crypto::CPU::Get();
+    EXPECT_FALSE(masked.has_aesni());
+    EXPECT_FALSE(masked.has_ssse3());
+    EXPECT_FALSE(masked.has_avx2());
+    EXPECT_FALSE(masked.has_sha());
+    EXPECT_EQ(cpu.has_sse2(), masked.has_sse2());
+    EXPECT_EQ(cpu.has_pclmulqdq(), masked.has_pclmulqdq());
+
+    crypto::bytestring key(16);
+    crypto::AESBase_u aes = crypto::AES(key.cmem());
+    EXPECT_NE(nullptr, dynamic_cast<crypto::BitslicedAES *>(aes.get()))
+        << aes->get_impl_desc();
+
+    crypto::SHA1Base_u sha1 = crypto::SHA1();
+    EXPECT_NE(nullptr, dynamic_cast<crypto::SHA1Impl *>(sha1.get()));
+
+    // Too late now
+    EXPECT_FALSE(crypto::CPU::DisableFeatures(crypto::CPU::FEATURE_SSE2));
+    EXPECT_EQ(cpu.has_sse2(), crypto::CPU::Get().has_sse2());
+}
+
+int main(int argc, char **argv) {
+    // The tests compare CPU::Get() with the actual processor
+    unsetenv("LIBSEAL_DISABLE_CPU_FEATURES");
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <functional>
 
 #include "crypto/common.hh"
 
@@ -74,33 +75,73 @@ class BlockCipher : public CipherBase {
     virtual void decrypt_block(const uint8_t *ciphertext,
                                uint8_t *plaintext) const = 0;
 
+    /**
+     * Encrypt |num_blocks| consecutive blocks pointed by |plaintext| and put
+     * the result into |ciphertext| (ECB mode).  The blocks are independent of
+     * each other, so the implementations may process several of them at
+     * once.  The default implementation calls encrypt_block() for each block.
+     */
+    virtual void encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                                size_t num_blocks) const;
+
+    /**
+     * Decrypt |num_blocks| consecutive blocks pointed by |ciphertext| and put
+     * the result into |plaintext|.  The blocks are independent of each other,
+     * so the implementations may process several of them at once.  The
+     * default implementation calls decrypt_block() for each block.
+     */
+    virtual void decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                                size_t num_blocks) const;
+
     /**
      * CBC mode encryption.
      *
      * Encrypt specified chunk of plaintext using key and the specified IV.
      * Does not handle padding; plaintext MUST be divisible by the block size
-     * and the IV length MUST be equal to the block size.
+     * and the IV length MUST be equal to the block size.  |ciphertext| MUST
+     * be of the same size as |plaintext|, and may point to the same memory,
+     * in which case the data is encrypted in place.  Does not allocate.
      */
-    virtual void encrypt_cbc(const bytestring &plaintext, const bytestring &iv,
-            bytestring &ciphertext) const;
+    virtual void encrypt_cbc(const memslice plaintext, const memslice iv,
+                             memslice ciphertext) const;
 
     /**
      * CBC mode decryption.
      *
      * Decrypt specified block of ciphertext using key and the specified IV.
      * Does not handle padding; ciphertext MUST be divisible by the block size
-     * and the IV length MUST be equal to the block size.
+     * and the IV length MUST be equal to the block size.  |plaintext| MUST be
+     * of the same size as |ciphertext|, and may point to the same memory, in
+     * which case the data is decrypted in place.  Does not allocate.
      */
-    virtual void decrypt_cbc(const bytestring &ciphertext, const bytestring &iv,
-            bytestring &plaintext) const;
+    virtual void decrypt_cbc(const memslice ciphertext, const memslice iv,
+                             memslice plaintext) const;
 
     /**
      * CTR mode encryption/decryption.
      *
-     * 
+     * XOR |input| with the keystream produced by encrypting successive
+     * values of the counter, starting with |iv|, and put the result into
+     * |output|.  The counter is the whole block interpreted as a big-endian
+     * integer, as in NIST SP 800-38A.  The input does not have to be
+     * divisible by the block size; the IV length MUST be equal to the block
+     * size.  |output| MUST be of the same size as |input|, and may point to
+     * the same memory.  Does not allocate.
      */
-    //virtual void counter_xor(const bytestring &iv, const bytestring &input,
-                     //bytestring &output) const;
+    virtual void counter_xor(const memslice iv, const memslice input,
+                             memslice output) const;
+
+    /**
+     * Convenience wrappers around the modes above, which resize the output
+     * buffer to the size of the input.  A subclass overriding one of the
+     * modes hides its wrapper, so it needs a using-declaration to keep it.
+     */
+    void encrypt_cbc(const bytestring &plaintext, const bytestring &iv,
+                     bytestring &ciphertext) const;
+    void decrypt_cbc(const bytestring &ciphertext, const bytestring &iv,
+                     bytestring &plaintext) const;
+    void counter_xor(const bytestring &iv, const bytestring &input,
+                     bytestring &output) const;
 };
 
 typedef std::unique_ptr<BlockCipher> BlockCipher_u;
@@ -119,12 +160,112 @@ class StreamCipher : public CipherBase {
      * Generate the secret stream and xor it with the contents of the supplied
      * memory slice.
      */
-    virtual void stream_xor(memslice stream) = 0;
+    virtual void stream_xor(memslice stream) {
+        xor_to(stream, stream);
+    }
+
+    /**
+     * XOR |input| with the next bytes of the secret stream, and put the
+     * result into |output|.  |output| MUST be of the same size as |input|,
+     * and may point to the same memory.  Does not allocate.
+     */
+    virtual void xor_to(const memslice input, memslice output) = 0;
 };
 
 typedef std::unique_ptr<StreamCipher> StreamCipher_u;
 typedef std::function<StreamCipher_u(const memslice, const memslice)> StreamCipherFactory;
 
+/**
+ * Base class for stream ciphers which generate the keystream independently of
+ * the data, and do so faster in large chunks, like RC4.  The keystream is
+ * generated into an internal buffer, and the data is XORed with it from
+ * there, so that a short message costs little more than the XOR itself.
+ */
+class BufferedStreamCipher : public StreamCipher {
+  public:
+    static constexpr size_t buffer_size = 512;
+
+  private:
+    uint8_t keystream[buffer_size];
+
+    // Offset of the first unused byte of |keystream|
+    size_t keystream_pos;
+
+  protected:
+    BufferedStreamCipher() : keystream_pos(buffer_size) {}
+
+    /**
+     * Put the next |len| bytes of the secret stream into |output|.  |len| is
+     * always buffer_size.
+     */
+    virtual void generate(uint8_t *output, size_t len) = 0;
+
+    /**
+     * XOR as much of |input| as the buffered keystream covers into |output|,
+     * and return the number of bytes done.
+     */
+    size_t xor_buffered(const uint8_t *input, uint8_t *output, size_t len);
+
+    /**
+     * Mark the buffer as full and return it, for the caller to put the next
+     * buffer_size bytes of the stream into.  Lets implementations generate
+     * the keystream of several objects at once.
+     */
+    uint8_t *refill_buffer() {
+        keystream_pos = 0;
+        return keystream;
+    }
+
+  public:
+    virtual ~BufferedStreamCipher() {};
+
+    virtual void xor_to(const memslice input, memslice output) override;
+};
+
+/**
+ * The base interface of an authenticated encryption with associated data
+ * (AEAD) algorithm, that is, a cipher which both encrypts the data and
+ * authenticates it together with some additional data which is not
+ * encrypted, like a TLS record header.
+ */
+class AEAD : public CipherBase {
+  public:
+    virtual ~AEAD() {};
+
+    /**
+     * Return the size of the nonce the algorithm requires.
+     */
+    virtual size_t get_nonce_size() const = 0;
+
+    /**
+     * Return the size of the authentication tag appended to the ciphertext.
+     */
+    virtual size_t get_tag_size() const = 0;
+
+    /**
+     * Encrypt |plaintext| and authenticate it together with |ad| using
+     * |nonce|, which MUST be of size returned by get_nonce_size() and MUST
+     * never be reused with the same key.  The ciphertext followed by the
+     * authentication tag is put into |ciphertext|.
+     */
+    virtual void seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext,
+                      bytestring &ciphertext) const = 0;
+
+    /**
+     * Verify the authentication tag at the end of |ciphertext| against the
+     * ciphertext and |ad|, and decrypt the ciphertext into |plaintext|.
+     * Returns false if the verification fails, in which case |plaintext| is
+     * left empty.
+     */
+    virtual bool open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext,
+                      bytestring &plaintext) const = 0;
+};
+
+typedef std::unique_ptr<AEAD> AEAD_u;
+typedef std::function<AEAD_u(const memslice)> AEADFactory;
+
 }
 
 #endif /* __CRYPTO_CIPHER_HH */
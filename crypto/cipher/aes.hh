@@ -3,14 +3,24 @@
 
 #include "crypto/cipher.hh"
 
-#include <vector>
+#include <type_traits>
 
 namespace crypto {
 
+class AESNI;
+
 class AESBase : public BlockCipher {
   public:
     virtual ~AESBase() {};
 
+    /**
+     * Return this object if it is an AESNI instance, or nullptr otherwise.
+     * Lets the multi-buffer code sort out its jobs without RTTI.
+     */
+    virtual const AESNI *get_aesni() const {
+        return nullptr;
+    }
+
     virtual const char *get_name() const override {
         return "AES";
     }
@@ -27,17 +37,39 @@ class AESBase : public BlockCipher {
 typedef std::unique_ptr<AESBase> AESBase_u;
 AESBase_u AES(const memslice key);
 
+/**
+ * A single CBC encryption request for aes_encrypt_cbc_multi().  |size| is the
+ * size of the plaintext in bytes and has to be divisible by the block size;
+ * |iv| points to a full block.  The ciphertext buffer must be at least |size|
+ * bytes long.
+ */
+struct AESCBCJob {
+    const AESBase *cipher;
+    const uint8_t *iv;
+    const uint8_t *plaintext;
+    uint8_t *ciphertext;
+    size_t size;
+};
+
+/**
+ * Encrypt several independent streams in CBC mode.  Encryption of a single
+ * CBC stream is serial, so the AES unit spends most of the time waiting for
+ * the previous block; with AES-NI the jobs are instead processed in
+ * interleaved lanes, one block of each stream per round of instructions.
+ * Jobs whose cipher is not AESNI are processed one after another.
+ */
+void aes_encrypt_cbc_multi(const AESCBCJob *jobs, size_t num_jobs);
+
 /**
  * Reference implementation of AES in pure C.  Uses lookup tables, and as such
- * is vulnerable to the cache-timing attacks.  Used as a last fallback if no
- * other implementation works, or for testing other implementations against it.
+ * is vulnerable to the cache-timing attacks.  Only used for testing other
+ * implementations against it.
  */
 class ReferenceAES : public AESBase {
   private:
-    std::vector<uint32_t> enc_key_schedule;
-    std::vector<uint32_t> dec_key_schedule;
-
-    size_t key_size;
+    // Four 32-bit words per round key
+    alignas(16) uint32_t enc_key_schedule[15 * 4];
+    alignas(16) uint32_t dec_key_schedule[15 * 4];
     uint8_t nrounds;
 
   public:
@@ -54,16 +86,136 @@ class ReferenceAES : public AESBase {
 };
 
 /**
- * AES-NI implementation.
- *
- * TODO: invoke necessary subroutines directly instead of calling Intel
- * library.  Currently, this has some const_casts due to Intel library missing
- * const specifiers.  Also, it reschedules the key on every call instead of
- * doing that once when set_key is invoked.
+ * Constant-time implementation of AES which uses bitslicing: eight blocks are
+ * transposed so that each SSE2 register holds a single bit of every byte of
+ * all of them, and the S-box is computed as a boolean circuit instead of a
+ * table lookup.  Used as a fallback when neither AES-NI nor SSSE3 is
+ * available.  Since one block costs as much as eight, the modes which can be
+ * parallelized are implemented in terms of eight blocks at a time.
+ */
+class BitslicedAES : public AESBase {
+  private:
+    // Bitsliced round keys, compressed to two 64-bit words per round
+    uint64_t round_keys[15 * 2];
+    uint8_t nrounds;
+
+  public:
+    BitslicedAES(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "Bitsliced AES (constant-time)";
+    }
+
+    virtual void encrypt_block(const uint8_t *plaintext,
+                               uint8_t *ciphertext) const override;
+    virtual void decrypt_block(const uint8_t *ciphertext,
+                               uint8_t *plaintext) const override;
+    virtual void encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                                size_t num_blocks) const override;
+    virtual void decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                                size_t num_blocks) const override;
+    using BlockCipher::counter_xor;
+    virtual void counter_xor(const memslice iv, const memslice input,
+                             memslice output) const override;
+};
+
+/**
+ * Constant-time implementation of AES which uses SSSE3 vector permutations
+ * (pshufb) as 16-entry lookup tables, as described by Hamburg in
+ * "Accelerating AES with Vector Permute Instructions".  Used when SSSE3 is
+ * available but AES-NI is not.
+ */
+class VPAES : public AESBase {
+  private:
+    alignas(16) uint8_t enc_round_keys[15 * 16];
+    alignas(16) uint8_t dec_round_keys[15 * 16];
+    uint8_t nrounds;
+
+  public:
+    VPAES(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "VPAES (SSSE3 vector permutations)";
+    }
+
+    virtual void encrypt_block(const uint8_t *plaintext,
+                               uint8_t *ciphertext) const override;
+    virtual void decrypt_block(const uint8_t *ciphertext,
+                               uint8_t *plaintext) const override;
+    virtual void encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                                size_t num_blocks) const override;
+    virtual void decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                                size_t num_blocks) const override;
+    using BlockCipher::encrypt_cbc;
+    using BlockCipher::counter_xor;
+    virtual void encrypt_cbc(const memslice plaintext, const memslice iv,
+                             memslice ciphertext) const override;
+    virtual void counter_xor(const memslice iv, const memslice input,
+                             memslice output) const override;
+};
+
+/**
+ * AES-NI implementation which uses compiler intrinsics.  The key is expanded
+ * once when the object is constructed, and both encryption and decryption
+ * round keys are stored aligned within the object itself.
+ */
+class AESNI : public AESBase {
+  private:
+    alignas(16) uint8_t enc_round_keys[15 * 16];
+    alignas(16) uint8_t dec_round_keys[15 * 16];
+    uint8_t nrounds;
+
+    // GCM, XTS and CBC-HMAC reuse the key schedule in their stitched kernels
+    friend class AESNIGCM;
+    friend class AESNIXTS;
+    friend class AESNICBCHMACSHA1;
+
+  public:
+    AESNI(const memslice key);
+
+    /**
+     * Multi-buffer CBC encryption backend of aes_encrypt_cbc_multi().  Jobs
+     * whose cipher is not an AESNI instance are skipped.
+     */
+    static void encrypt_cbc_multi(const AESCBCJob *jobs, size_t num_jobs);
+
+    virtual const AESNI *get_aesni() const override {
+        return this;
+    }
+
+    virtual const char *get_impl_desc() const override {
+        return "AES-NI (intrinsics)";
+    }
+
+    virtual void encrypt_block(const uint8_t *plaintext,
+                               uint8_t *ciphertext) const override;
+    virtual void decrypt_block(const uint8_t *ciphertext,
+                               uint8_t *plaintext) const override;
+    virtual void encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                                size_t num_blocks) const override;
+    virtual void decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                                size_t num_blocks) const override;
+    using BlockCipher::encrypt_cbc;
+    using BlockCipher::decrypt_cbc;
+    using BlockCipher::counter_xor;
+    virtual void encrypt_cbc(const memslice plaintext, const memslice iv,
+                             memslice ciphertext) const override;
+    virtual void decrypt_cbc(const memslice ciphertext, const memslice iv,
+                             memslice plaintext) const override;
+    virtual void counter_xor(const memslice iv, const memslice input,
+                             memslice output) const override;
+};
+
+/**
+ * AES-NI implementation which calls into the Intel library.  It reschedules
+ * the key on every call, and needs some const_casts due to Intel library
+ * missing const specifiers.  AESNI above should be used instead; this class
+ * is kept for testing and benchmarking against it.
  */
 class IntelAES : public AESBase {
   private:
-    bytestring secret_key;
+    alignas(16) uint8_t secret_key[32];
+    uint8_t key_size;
 
   public:
     IntelAES(const memslice key);
@@ -76,12 +228,34 @@ class IntelAES : public AESBase {
                                uint8_t *ciphertext) const override;
     virtual void decrypt_block(const uint8_t *ciphertext,
                                uint8_t *plaintext) const override;
-    virtual void encrypt_cbc(const bytestring &plaintext, const bytestring &iv,
-            bytestring &ciphertext) const override;
-    virtual void decrypt_cbc(const bytestring &ciphertext, const bytestring &iv,
-            bytestring &plaintext) const override;
+    virtual void encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                                size_t num_blocks) const override;
+    virtual void decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                                size_t num_blocks) const override;
+    using BlockCipher::encrypt_cbc;
+    using BlockCipher::decrypt_cbc;
+    virtual void encrypt_cbc(const memslice plaintext, const memslice iv,
+                             memslice ciphertext) const override;
+    virtual void decrypt_cbc(const memslice ciphertext, const memslice iv,
+                             memslice plaintext) const override;
 };
 
+/**
+ * Storage which is large enough and suitably aligned to hold any of the AES
+ * implementations above.  None of them allocates memory on its own, so an
+ * array of AESStorage is all that is needed to keep many keys contiguously.
+ */
+typedef std::aligned_union<0, ReferenceAES, BitslicedAES, VPAES, AESNI,
+                           IntelAES>::type AESStorage;
+
+/**
+ * Same as AES(), but construct the cipher in the caller-provided |storage|
+ * instead of on the heap.  The returned pointer points into |storage|; the
+ * object must not be deleted, but destroyed by calling its destructor
+ * explicitly before the storage is reused.
+ */
+AESBase *AES_emplace(const memslice key, AESStorage *storage);
+
 }
 
 #endif /* __CRYPTO_CIPHER_AES_HH */
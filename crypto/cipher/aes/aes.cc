@@ -2,116 +2,216 @@
 #include "crypto/cipher/aes.hh"
 #include "crypto/cipher/aes/rijndael-alg-fst.h"
 
-#include "iaesni.h"
-
 #include <cstdint>
+#include <new>
 
-#define MAX_AES_KEY_SCHEDULE_LEN   64
+// iaesni.h defines bool as a macro, so it has to be included last
+#include "iaesni.h"
 
 namespace crypto {
 
-AESBase_u AES(const memslice key) {
-    CPU cpu;
+namespace {
+
+// Construct |T| in |storage|, or on the heap if no storage is provided.
+template <typename T>
+AESBase *construct(const memslice key, AESStorage *storage) {
+    if (storage != nullptr) {
+        return new (storage) T(key);
+    }
+    return new T(key);
+}
+
+typedef AESBase *(*AESConstructor)(const memslice key, AESStorage *storage);
+
+AESConstructor select_implementation() {
+    const CPU &cpu = CPU::Get();
 
     if (cpu.has_aesni()) {
-        return AESBase_u(new IntelAES(key));
+        return construct<AESNI>;
+    }
+    if (cpu.has_ssse3()) {
+        return construct<VPAES>;
     }
 
-    return AESBase_u(new ReferenceAES(key));
+    return construct<BitslicedAES>;
 }
 
-ReferenceAES::ReferenceAES(const memslice key) {
-    enc_key_schedule.resize(MAX_AES_KEY_SCHEDULE_LEN);
-    dec_key_schedule.resize(MAX_AES_KEY_SCHEDULE_LEN);
+AESBase *construct_best(const memslice key, AESStorage *storage) {
+    // Resolved once, the first time a key is set up
+    static const AESConstructor constructor = select_implementation();
+    return constructor(key, storage);
+}
 
-    // FIXME: assert key size
-    key_size = key.size();
+}
 
-    rijndaelKeySetupEnc(&*enc_key_schedule.begin(), key.cptr(), key_size * 8);
-    rijndaelKeySetupDec(&*dec_key_schedule.begin(), key.cptr(), key_size * 8);
+AESBase_u AES(const memslice key) {
+    return AESBase_u(construct_best(key, nullptr));
+}
 
-    if (key_size == 16) {
-        nrounds = 10;
+AESBase *AES_emplace(const memslice key, AESStorage *storage) {
+    contract_assert(storage != nullptr);
+    return construct_best(key, storage);
+}
+
+void aes_encrypt_cbc_multi(const AESCBCJob *jobs, size_t num_jobs) {
+    size_t num_aesni_jobs = 0;
+
+    for (size_t i = 0; i < num_jobs; i++) {
+        const AESCBCJob &job = jobs[i];
+        contract_assert(job.size % 16 == 0);
+
+        if (job.cipher->get_aesni() != nullptr) {
+            num_aesni_jobs++;
+            continue;
+        }
+
+        // Fallback: plain serial CBC for the other implementations
+        const uint8_t *chain = job.iv;
+        for (size_t offset = 0; offset < job.size; offset += 16) {
+            uint8_t buffer[16];
+            for (size_t j = 0; j < 16; j++) {
+                buffer[j] = chain[j] ^ job.plaintext[offset + j];
+            }
+            job.cipher->encrypt_block(buffer, job.ciphertext + offset);
+            chain = job.ciphertext + offset;
+        }
     }
-    if (key_size == 32) {
-        nrounds = 14;
+
+    // The AES-NI jobs are picked out of the array by the lanes themselves
+    if (num_aesni_jobs > 0) {
+        AESNI::encrypt_cbc_multi(jobs, num_jobs);
     }
 }
 
+ReferenceAES::ReferenceAES(const memslice key) {
+    contract_assert(is_valid_key_size(key.size()));
+
+    rijndaelKeySetupEnc(enc_key_schedule, key.cptr(), key.size() * 8);
+    nrounds = rijndaelKeySetupDec(dec_key_schedule, key.cptr(),
+                                  key.size() * 8);
+}
+
 void ReferenceAES::encrypt_block(const uint8_t *plaintext,
                                  uint8_t *ciphertext) const {
-    rijndaelEncrypt(enc_key_schedule.data(), nrounds, plaintext, ciphertext);
+    rijndaelEncrypt(enc_key_schedule, nrounds, plaintext, ciphertext);
 }
 
 void ReferenceAES::decrypt_block(const uint8_t *ciphertext,
                                  uint8_t *plaintext) const {
-    rijndaelDecrypt(dec_key_schedule.data(), nrounds, ciphertext, plaintext);
+    rijndaelDecrypt(dec_key_schedule, nrounds, ciphertext, plaintext);
 }
 
 
 IntelAES::IntelAES(const memslice key) {
-    secret_key = bytestring(key);
+    contract_assert(is_valid_key_size(key.size()));
+
+    key_size = key.size();
+    memcpy(secret_key, key.cptr(), key_size);
 }
 
 void IntelAES::encrypt_block(const uint8_t *plaintext,
                              uint8_t *ciphertext) const {
-    if (secret_key.size() == 16) {
+    if (key_size == 16) {
         intel_AES_enc128(const_cast<uint8_t *>(plaintext), ciphertext,
-                         const_cast<uint8_t *>(secret_key.cptr()), 1);
+                         const_cast<uint8_t *>(secret_key), 1);
     }
-    if (secret_key.size() == 32) {
+    if (key_size == 32) {
         intel_AES_enc256(const_cast<uint8_t *>(plaintext), ciphertext,
-                         const_cast<uint8_t *>(secret_key.cptr()), 1);
+                         const_cast<uint8_t *>(secret_key), 1);
     }
 }
 
 void IntelAES::decrypt_block(const uint8_t *ciphertext,
                                  uint8_t *plaintext) const {
-    if (secret_key.size() == 16) {
+    if (key_size == 16) {
+        intel_AES_dec128(const_cast<uint8_t *>(ciphertext), plaintext,
+                         const_cast<uint8_t *>(secret_key), 1);
+    }
+    if (key_size == 32) {
+        intel_AES_dec256(const_cast<uint8_t *>(ciphertext), plaintext,
+                         const_cast<uint8_t *>(secret_key), 1);
+    }
+}
+
+void IntelAES::encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                              size_t num_blocks) const {
+    if (num_blocks == 0) {
+        return;
+    }
+
+    // The Intel ECB routines process four blocks in parallel
+    if (key_size == 16) {
+        intel_AES_enc128(const_cast<uint8_t *>(plaintext), ciphertext,
+                         const_cast<uint8_t *>(secret_key), num_blocks);
+    }
+    if (key_size == 32) {
+        intel_AES_enc256(const_cast<uint8_t *>(plaintext), ciphertext,
+                         const_cast<uint8_t *>(secret_key), num_blocks);
+    }
+}
+
+void IntelAES::decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                              size_t num_blocks) const {
+    if (num_blocks == 0) {
+        return;
+    }
+
+    if (key_size == 16) {
         intel_AES_dec128(const_cast<uint8_t *>(ciphertext), plaintext,
-                         const_cast<uint8_t *>(secret_key.cptr()), 1);
+                         const_cast<uint8_t *>(secret_key), num_blocks);
     }
-    if (secret_key.size() == 32) {
+    if (key_size == 32) {
         intel_AES_dec256(const_cast<uint8_t *>(ciphertext), plaintext,
-                         const_cast<uint8_t *>(secret_key.cptr()), 1);
+                         const_cast<uint8_t *>(secret_key), num_blocks);
     }
 }
 
-void IntelAES::encrypt_cbc(const bytestring &plaintext, const bytestring &iv,
-                           bytestring &ciphertext) const {
-    size_t num_blocks = plaintext.size() / get_block_size();
-    ciphertext.resize(plaintext.size());
+void IntelAES::encrypt_cbc(const memslice plaintext, const memslice iv,
+                           memslice ciphertext) const {
+    contract_assert(iv.size() == 16);
+    contract_assert(plaintext.size() % 16 == 0);
+    contract_assert(ciphertext.size() == plaintext.size());
+    size_t num_blocks = plaintext.size() / 16;
+
+    // The Intel library writes the last ciphertext block back into the IV
+    uint8_t chain[16];
+    memcpy(chain, iv.cptr(), 16);
 
-    if (secret_key.size() == 16) {
+    if (key_size == 16) {
         intel_AES_enc128_CBC(const_cast<uint8_t *>(plaintext.cptr()),
                              ciphertext.ptr(),
-                             const_cast<uint8_t *>(secret_key.cptr()),
-                             num_blocks, const_cast<uint8_t *>(iv.cptr()));
+                             const_cast<uint8_t *>(secret_key),
+                             num_blocks, chain);
     }
-    if (secret_key.size() == 32) {
+    if (key_size == 32) {
         intel_AES_enc256_CBC(const_cast<uint8_t *>(plaintext.cptr()),
                              ciphertext.ptr(),
-                             const_cast<uint8_t *>(secret_key.cptr()),
-                             num_blocks, const_cast<uint8_t *>(iv.cptr()));
+                             const_cast<uint8_t *>(secret_key),
+                             num_blocks, chain);
     }
 }
 
-void IntelAES::decrypt_cbc(const bytestring &ciphertext, const bytestring &iv,
-            bytestring &plaintext) const {
-    size_t num_blocks = ciphertext.size() / get_block_size();
-    plaintext.resize(ciphertext.size());
+void IntelAES::decrypt_cbc(const memslice ciphertext, const memslice iv,
+                           memslice plaintext) const {
+    contract_assert(iv.size() == 16);
+    contract_assert(ciphertext.size() % 16 == 0);
+    contract_assert(plaintext.size() == ciphertext.size());
+    size_t num_blocks = ciphertext.size() / 16;
 
-    if (secret_key.size() == 16) {
+    uint8_t chain[16];
+    memcpy(chain, iv.cptr(), 16);
+
+    if (key_size == 16) {
         intel_AES_dec128_CBC(const_cast<uint8_t *>(ciphertext.cptr()),
                              plaintext.ptr(),
-                             const_cast<uint8_t *>(secret_key.cptr()),
-                             num_blocks, const_cast<uint8_t *>(iv.cptr()));
+                             const_cast<uint8_t *>(secret_key),
+                             num_blocks, chain);
     }
-    if (secret_key.size() == 32) {
+    if (key_size == 32) {
         intel_AES_dec256_CBC(const_cast<uint8_t *>(ciphertext.cptr()),
                              plaintext.ptr(),
-                             const_cast<uint8_t *>(secret_key.cptr()),
-                             num_blocks, const_cast<uint8_t *>(iv.cptr()));
+                             const_cast<uint8_t *>(secret_key),
+                             num_blocks, chain);
     }
 }
 
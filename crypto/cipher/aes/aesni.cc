@@ -0,0 +1,456 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// AES-NI implementation written using compiler intrinsics, compiled with
+// -maes.
+
+#include "crypto/cipher/aes.hh"
+
+#include <cstring>
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+inline __m128i load_block(const uint8_t *ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+
+inline void store_block(uint8_t *ptr, __m128i block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), block);
+}
+
+// One step of AES-128 key expansion.  |assist| is the result of
+// aeskeygenassist on the previous round key.
+inline __m128i expand_step_128(__m128i key, __m128i assist) {
+    assist = _mm_shuffle_epi32(assist, _MM_SHUFFLE(3, 3, 3, 3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// The odd step of AES-256 key expansion, which only applies SubWord without
+// rotation and round constant.
+inline __m128i expand_step_256_odd(__m128i key, __m128i prev) {
+    __m128i assist = _mm_aeskeygenassist_si128(prev, 0x00);
+    assist = _mm_shuffle_epi32(assist, _MM_SHUFFLE(2, 2, 2, 2));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// aeskeygenassist requires the round constant to be an immediate, hence the
+// macros below.
+#define EXPAND_128(i, rcon)                                                    \
+    rk[i] = expand_step_128(rk[i - 1],                                         \
+                            _mm_aeskeygenassist_si128(rk[i - 1], rcon))
+
+void expand_key_128(const uint8_t *key, __m128i *rk) {
+    rk[0] = load_block(key);
+    EXPAND_128(1, 0x01);
+    EXPAND_128(2, 0x02);
+    EXPAND_128(3, 0x04);
+    EXPAND_128(4, 0x08);
+    EXPAND_128(5, 0x10);
+    EXPAND_128(6, 0x20);
+    EXPAND_128(7, 0x40);
+    EXPAND_128(8, 0x80);
+    EXPAND_128(9, 0x1b);
+    EXPAND_128(10, 0x36);
+}
+
+#define EXPAND_256(i, rcon)                                                    \
+    rk[i] = expand_step_128(rk[i - 2],                                         \
+                            _mm_aeskeygenassist_si128(rk[i - 1], rcon));       \
+    rk[i + 1] = expand_step_256_odd(rk[i - 1], rk[i])
+
+void expand_key_256(const uint8_t *key, __m128i *rk) {
+    rk[0] = load_block(key);
+    rk[1] = load_block(key + 16);
+    EXPAND_256(2, 0x01);
+    EXPAND_256(4, 0x02);
+    EXPAND_256(6, 0x04);
+    EXPAND_256(8, 0x08);
+    EXPAND_256(10, 0x10);
+    EXPAND_256(12, 0x20);
+    rk[14] = expand_step_128(rk[12], _mm_aeskeygenassist_si128(rk[13], 0x40));
+}
+
+#undef EXPAND_128
+#undef EXPAND_256
+
+inline __m128i encrypt(const __m128i *rk, size_t nrounds, __m128i block) {
+    block = _mm_xor_si128(block, rk[0]);
+    for (size_t i = 1; i < nrounds; i++) {
+        block = _mm_aesenc_si128(block, rk[i]);
+    }
+    return _mm_aesenclast_si128(block, rk[nrounds]);
+}
+
+inline __m128i decrypt(const __m128i *rk, size_t nrounds, __m128i block) {
+    block = _mm_xor_si128(block, rk[0]);
+    for (size_t i = 1; i < nrounds; i++) {
+        block = _mm_aesdec_si128(block, rk[i]);
+    }
+    return _mm_aesdeclast_si128(block, rk[nrounds]);
+}
+
+// Encrypt eight independent blocks at once.  aesenc has a latency of
+// several cycles but a throughput of one per cycle, so keeping eight blocks
+// in flight lets the AES unit be fully utilized.
+inline void encrypt8(const __m128i *rk, size_t nrounds, __m128i *blocks) {
+    for (size_t j = 0; j < 8; j++) {
+        blocks[j] = _mm_xor_si128(blocks[j], rk[0]);
+    }
+    for (size_t i = 1; i < nrounds; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = _mm_aesenc_si128(blocks[j], rk[i]);
+        }
+    }
+    for (size_t j = 0; j < 8; j++) {
+        blocks[j] = _mm_aesenclast_si128(blocks[j], rk[nrounds]);
+    }
+}
+
+// Decrypt eight independent blocks at once, see encrypt8() above.
+inline void decrypt8(const __m128i *rk, size_t nrounds, __m128i *blocks) {
+    for (size_t j = 0; j < 8; j++) {
+        blocks[j] = _mm_xor_si128(blocks[j], rk[0]);
+    }
+    for (size_t i = 1; i < nrounds; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = _mm_aesdec_si128(blocks[j], rk[i]);
+        }
+    }
+    for (size_t j = 0; j < 8; j++) {
+        blocks[j] = _mm_aesdeclast_si128(blocks[j], rk[nrounds]);
+    }
+}
+
+/**
+ * 128-bit big-endian counter, kept as two native integers so that it can be
+ * incremented cheaply.
+ */
+struct Counter128 {
+    uint64_t hi;
+    uint64_t lo;
+
+    Counter128(const uint8_t *block) {
+        memcpy(&hi, block, 8);
+        memcpy(&lo, block + 8, 8);
+        hi = __builtin_bswap64(hi);
+        lo = __builtin_bswap64(lo);
+    }
+
+    inline __m128i next() {
+        __m128i block = _mm_set_epi64x(__builtin_bswap64(lo),
+                                       __builtin_bswap64(hi));
+        if (++lo == 0) {
+            hi++;
+        }
+        return block;
+    }
+};
+
+/**
+ * State of one lane of the multi-buffer CBC encryption.
+ */
+struct CBCLane {
+    const __m128i *rk;
+    const uint8_t *in;
+    uint8_t *out;
+    size_t remaining;
+    __m128i chain;
+};
+
+/**
+ * Encrypt the jobs with |nrounds| rounds in eight interleaved lanes.
+ * |round_keys| returns the expanded key for a job, or nullptr for the jobs
+ * which do not belong to this pass.  When a lane finishes its job, it picks
+ * up the next one; lanes without any work left keep running on dummy data,
+ * so that the inner loops stay branchless.
+ */
+template <class RoundKeys>
+void encrypt_cbc_lanes(const AESCBCJob *jobs, size_t num_jobs,
+                       size_t nrounds, RoundKeys round_keys) {
+    const size_t num_lanes = 8;
+    alignas(16) static const uint8_t dummy_keys[15 * 16] = { 0 };
+    static const uint8_t dummy_block[16] = { 0 };
+    uint8_t discard[16];
+
+    CBCLane lanes[num_lanes];
+    size_t next_job = 0;
+    size_t active = 0;
+
+    auto refill = [&](CBCLane &lane) {
+        while (next_job < num_jobs) {
+            const AESCBCJob &job = jobs[next_job++];
+            const __m128i *rk = round_keys(job);
+            // A job without a whole block would never finish its lane
+            if (rk == nullptr || job.size < 16) {
+                continue;
+            }
+            lane.rk = rk;
+            lane.in = job.plaintext;
+            lane.out = job.ciphertext;
+            lane.remaining = job.size / 16;
+            lane.chain = load_block(job.iv);
+            return true;
+        }
+
+        lane.rk = reinterpret_cast<const __m128i *>(dummy_keys);
+        lane.in = dummy_block;
+        lane.out = discard;
+        lane.remaining = 0;
+        lane.chain = _mm_setzero_si128();
+        return false;
+    };
+
+    for (size_t j = 0; j < num_lanes; j++) {
+        if (refill(lanes[j])) {
+            active++;
+        }
+    }
+
+    while (active > 0) {
+        __m128i blocks[num_lanes];
+        for (size_t j = 0; j < num_lanes; j++) {
+            blocks[j] = _mm_xor_si128(lanes[j].chain, load_block(lanes[j].in));
+            blocks[j] = _mm_xor_si128(blocks[j], lanes[j].rk[0]);
+        }
+        for (size_t i = 1; i < nrounds; i++) {
+            for (size_t j = 0; j < num_lanes; j++) {
+                blocks[j] = _mm_aesenc_si128(blocks[j], lanes[j].rk[i]);
+            }
+        }
+        for (size_t j = 0; j < num_lanes; j++) {
+            blocks[j] = _mm_aesenclast_si128(blocks[j], lanes[j].rk[nrounds]);
+        }
+
+        for (size_t j = 0; j < num_lanes; j++) {
+            CBCLane &lane = lanes[j];
+            if (lane.remaining == 0) {
+                continue;
+            }
+            store_block(lane.out, blocks[j]);
+            lane.chain = blocks[j];
+            lane.in += 16;
+            lane.out += 16;
+            if (--lane.remaining == 0 && !refill(lane)) {
+                active--;
+            }
+        }
+    }
+}
+
+}
+
+AESNI::AESNI(const memslice key) {
+    contract_assert(is_valid_key_size(key.size()));
+
+    __m128i *enc_rk = reinterpret_cast<__m128i *>(enc_round_keys);
+    __m128i *dec_rk = reinterpret_cast<__m128i *>(dec_round_keys);
+
+    if (key.size() == 16) {
+        nrounds = 10;
+        expand_key_128(key.cptr(), enc_rk);
+    } else {
+        nrounds = 14;
+        expand_key_256(key.cptr(), enc_rk);
+    }
+
+    // Decryption uses the equivalent inverse cipher, which needs the round
+    // keys in reverse order with InvMixColumns applied to all but the first
+    // and the last one.
+    dec_rk[0] = enc_rk[nrounds];
+    for (size_t i = 1; i < nrounds; i++) {
+        dec_rk[i] = _mm_aesimc_si128(enc_rk[nrounds - i]);
+    }
+    dec_rk[nrounds] = enc_rk[0];
+}
+
+void AESNI::encrypt_block(const uint8_t *plaintext,
+                          uint8_t *ciphertext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+    store_block(ciphertext, encrypt(rk, nrounds, load_block(plaintext)));
+}
+
+void AESNI::decrypt_block(const uint8_t *ciphertext,
+                          uint8_t *plaintext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(dec_round_keys);
+    store_block(plaintext, decrypt(rk, nrounds, load_block(ciphertext)));
+}
+
+void AESNI::encrypt_cbc(const memslice plaintext, const memslice iv,
+                        memslice ciphertext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+    contract_assert(iv.size() == 16);
+    contract_assert(plaintext.size() % 16 == 0);
+    contract_assert(ciphertext.size() == plaintext.size());
+    size_t num_blocks = plaintext.size() / 16;
+
+    const uint8_t *in = plaintext.cptr();
+    uint8_t *out = ciphertext.ptr();
+    __m128i chain = load_block(iv.cptr());
+    for (size_t i = 0; i < num_blocks; i++) {
+        chain = _mm_xor_si128(chain, load_block(in + i * 16));
+        chain = encrypt(rk, nrounds, chain);
+        store_block(out + i * 16, chain);
+    }
+}
+
+void AESNI::encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                           size_t num_blocks) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+
+    size_t i = 0;
+    for (; i + 8 <= num_blocks; i += 8) {
+        __m128i blocks[8];
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = load_block(plaintext + (i + j) * 16);
+        }
+        encrypt8(rk, nrounds, blocks);
+        for (size_t j = 0; j < 8; j++) {
+            store_block(ciphertext + (i + j) * 16, blocks[j]);
+        }
+    }
+    for (; i < num_blocks; i++) {
+        store_block(ciphertext + i * 16,
+                    encrypt(rk, nrounds, load_block(plaintext + i * 16)));
+    }
+}
+
+void AESNI::decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                           size_t num_blocks) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(dec_round_keys);
+
+    size_t i = 0;
+    for (; i + 8 <= num_blocks; i += 8) {
+        __m128i blocks[8];
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = load_block(ciphertext + (i + j) * 16);
+        }
+        decrypt8(rk, nrounds, blocks);
+        for (size_t j = 0; j < 8; j++) {
+            store_block(plaintext + (i + j) * 16, blocks[j]);
+        }
+    }
+    for (; i < num_blocks; i++) {
+        store_block(plaintext + i * 16,
+                    decrypt(rk, nrounds, load_block(ciphertext + i * 16)));
+    }
+}
+
+void AESNI::decrypt_cbc(const memslice ciphertext, const memslice iv,
+                        memslice plaintext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(dec_round_keys);
+    contract_assert(iv.size() == 16);
+    contract_assert(ciphertext.size() % 16 == 0);
+    contract_assert(plaintext.size() == ciphertext.size());
+    size_t num_blocks = ciphertext.size() / 16;
+
+    const uint8_t *in = ciphertext.cptr();
+    uint8_t *out = plaintext.ptr();
+    __m128i chain = load_block(iv.cptr());
+    size_t i = 0;
+
+    // Main loop: unlike encryption, CBC decryption is parallel, so eight
+    // blocks are kept in flight at once.  All of them are loaded before any
+    // plaintext is stored, which makes in-place decryption safe.
+    for (; i + 8 <= num_blocks; i += 8) {
+        __m128i blocks[8];
+        __m128i input[8];
+        for (size_t j = 0; j < 8; j++) {
+            input[j] = blocks[j] = load_block(in + (i + j) * 16);
+        }
+        decrypt8(rk, nrounds, blocks);
+        store_block(out + i * 16, _mm_xor_si128(blocks[0], chain));
+        for (size_t j = 1; j < 8; j++) {
+            store_block(out + (i + j) * 16,
+                        _mm_xor_si128(blocks[j], input[j - 1]));
+        }
+        chain = input[7];
+    }
+
+    // Remaining blocks
+    for (; i < num_blocks; i++) {
+        __m128i block = load_block(in + i * 16);
+        store_block(out + i * 16,
+                    _mm_xor_si128(decrypt(rk, nrounds, block), chain));
+        chain = block;
+    }
+}
+
+void AESNI::counter_xor(const memslice iv, const memslice input,
+                        memslice output) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+    contract_assert(iv.size() == 16);
+    contract_assert(output.size() == input.size());
+
+    const uint8_t *in = input.cptr();
+    uint8_t *out = output.ptr();
+    size_t remaining = input.size();
+    Counter128 counter(iv.cptr());
+
+    // Main loop: eight blocks at a time
+    while (remaining >= 8 * 16) {
+        __m128i blocks[8];
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = counter.next();
+        }
+        encrypt8(rk, nrounds, blocks);
+        for (size_t j = 0; j < 8; j++) {
+            store_block(out + j * 16,
+                        _mm_xor_si128(blocks[j], load_block(in + j * 16)));
+        }
+        in += 8 * 16;
+        out += 8 * 16;
+        remaining -= 8 * 16;
+    }
+
+    // Remaining whole blocks
+    while (remaining >= 16) {
+        __m128i keystream = encrypt(rk, nrounds, counter.next());
+        store_block(out, _mm_xor_si128(keystream, load_block(in)));
+        in += 16;
+        out += 16;
+        remaining -= 16;
+    }
+
+    // Partial last block
+    if (remaining > 0) {
+        uint8_t keystream[16];
+        store_block(keystream, encrypt(rk, nrounds, counter.next()));
+        for (size_t j = 0; j < remaining; j++) {
+            out[j] = in[j] ^ keystream[j];
+        }
+    }
+}
+
+void AESNI::encrypt_cbc_multi(const AESCBCJob *jobs, size_t num_jobs) {
+    // All lanes have to run the same number of rounds, so AES-128 and
+    // AES-256 jobs are processed in separate passes over the array
+    for (size_t nrounds : { 10, 14 }) {
+        encrypt_cbc_lanes(
+            jobs, num_jobs, nrounds,
+            [nrounds](const AESCBCJob &job) -> const __m128i * {
+                const AESNI *cipher = job.cipher->get_aesni();
+                if (cipher == nullptr || cipher->nrounds != nrounds) {
+                    return nullptr;
+                }
+                return reinterpret_cast<const __m128i *>(
+                    cipher->enc_round_keys);
+            });
+    }
+}
+
+}
@@ -0,0 +1,162 @@
+#include "crypto/cipher/aes.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+#include <cstdio>
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_impl(crypto::BlockCipherFactory impl, size_t key_size) {
+    bytestring key(key_size);
+    bytestring iv(16);
+    bytestring block(16);
+    bytestring input(16384);
+    bytestring output;
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = i;
+    }
+
+    crypto::BlockCipher_u cipher = impl(key.cmem());
+    const char *desc = cipher->get_impl_desc();
+    const char *name = key_size == 16 ? "AES-128" : "AES-256";
+    char op[64];
+
+    snprintf(op, sizeof(op), "%s key setup", name);
+    crypto::report_benchmark(
+        desc, op, 16,
+        crypto::cycles_per_byte([&]() { impl(key.cmem()); }, 16));
+
+    snprintf(op, sizeof(op), "%s encrypt block", name);
+    crypto::report_benchmark(
+        desc, op, 16,
+        crypto::cycles_per_byte([&]() {
+            cipher->encrypt_block(block.cptr(), block.ptr());
+        }, 16, 100000));
+
+    snprintf(op, sizeof(op), "%s decrypt block", name);
+    crypto::report_benchmark(
+        desc, op, 16,
+        crypto::cycles_per_byte([&]() {
+            cipher->decrypt_block(block.cptr(), block.ptr());
+        }, 16, 100000));
+
+    snprintf(op, sizeof(op), "%s encrypt CBC", name);
+    crypto::report_benchmark(
+        desc, op, input.size(),
+        crypto::cycles_per_byte([&]() {
+            cipher->encrypt_cbc(input, iv, output);
+        }, input.size(), 100));
+
+    snprintf(op, sizeof(op), "%s decrypt CBC", name);
+    crypto::report_benchmark(
+        desc, op, input.size(),
+        crypto::cycles_per_byte([&]() {
+            cipher->decrypt_cbc(input, iv, output);
+        }, input.size(), 100));
+
+    snprintf(op, sizeof(op), "%s CTR", name);
+    crypto::report_benchmark(
+        desc, op, input.size(),
+        crypto::cycles_per_byte([&]() {
+            cipher->counter_xor(iv, input, output);
+        }, input.size(), 100));
+}
+
+/**
+ * Encrypt eight independent CBC streams at once, as a server with many
+ * concurrent connections would.
+ */
+void benchmark_cbc_multi(size_t key_size) {
+    const size_t num_jobs = 8;
+    bytestring key(key_size);
+    bytestring iv(16);
+    bytestring input(16384);
+    bytestring outputs[num_jobs];
+    crypto::AESCBCJob jobs[num_jobs];
+
+    crypto::AESNI cipher(key.cmem());
+    for (size_t i = 0; i < num_jobs; i++) {
+        outputs[i].resize(input.size());
+        jobs[i] = { &cipher, iv.cptr(), input.cptr(), outputs[i].ptr(),
+                    input.size() };
+    }
+
+    char op[64];
+    snprintf(op, sizeof(op), "%s encrypt CBC x%zu",
+             key_size == 16 ? "AES-128" : "AES-256", num_jobs);
+    size_t bytes = num_jobs * input.size();
+    crypto::report_benchmark(
+        "AES-NI (multi-buffer)", op, bytes,
+        crypto::cycles_per_byte([&]() {
+            crypto::aes_encrypt_cbc_multi(jobs, num_jobs);
+        }, bytes, 20));
+}
+
+/**
+ * Set up keys through the AES() factory, both on the heap and into
+ * preallocated storage, as a server establishing many sessions would.
+ */
+void benchmark_factory_key_setup(size_t key_size) {
+    bytestring key(key_size);
+    crypto::AESStorage storage;
+    const char *desc = crypto::AES(key.cmem())->get_impl_desc();
+    const char *name = key_size == 16 ? "AES-128" : "AES-256";
+    char op[64];
+
+    snprintf(op, sizeof(op), "%s key setup (AES)", name);
+    crypto::report_benchmark(
+        desc, op, 16,
+        crypto::cycles_per_byte([&]() { crypto::AES(key.cmem()); }, 16));
+
+    snprintf(op, sizeof(op), "%s key setup (AES_emplace)", name);
+    crypto::report_benchmark(
+        desc, op, 16,
+        crypto::cycles_per_byte([&]() {
+            crypto::AES_emplace(key.cmem(), &storage)->~AESBase();
+        }, 16));
+}
+
+crypto::BlockCipher_u referenceAES(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::ReferenceAES(key));
+}
+
+crypto::BlockCipher_u bitslicedAES(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::BitslicedAES(key));
+}
+
+crypto::BlockCipher_u vpaes(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::VPAES(key));
+}
+
+crypto::BlockCipher_u intelAES(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::IntelAES(key));
+}
+
+crypto::BlockCipher_u aesni(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::AESNI(key));
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    for (size_t key_size : { 16, 32 }) {
+        benchmark_impl(referenceAES, key_size);
+        benchmark_impl(bitslicedAES, key_size);
+        if (cpu.has_ssse3()) {
+            benchmark_impl(vpaes, key_size);
+        }
+        if (cpu.has_aesni()) {
+            benchmark_impl(intelAES, key_size);
+            benchmark_impl(aesni, key_size);
+            benchmark_cbc_multi(key_size);
+        }
+        benchmark_factory_key_setup(key_size);
+    }
+
+    return 0;
+}
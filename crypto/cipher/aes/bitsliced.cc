@@ -0,0 +1,597 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Constant-time bitsliced AES.  The representation of the state follows the
+// "ct64" implementation from BearSSL by Thomas Pornin: four blocks are
+// spread over eight 64-bit words, word i holding bit i of every byte of all
+// four blocks.  Here each 64-bit word is widened to an SSE2 register whose
+// two halves hold two independent such states, so that eight blocks are
+// processed at once.  All operations used are lane-wise 64-bit operations,
+// with the exception of rotr32(), which swaps 32-bit halves within each lane.
+//
+// SSE2 is a part of the base x86-64 instruction set, so no CPU checks are
+// required.
+
+#include "crypto/cipher/aes.hh"
+
+#include <cstring>
+
+#include <emmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+/**
+ * Thin wrapper around an SSE2 register, so that the bitsliced code can be
+ * written with the usual C operators.
+ */
+struct Slice {
+    __m128i v;
+
+    Slice() {}
+    Slice(__m128i x) : v(x) {}
+    explicit Slice(uint64_t x) : v(_mm_set1_epi64x(x)) {}
+};
+
+inline Slice operator^(Slice a, Slice b) { return _mm_xor_si128(a.v, b.v); }
+inline Slice operator&(Slice a, Slice b) { return _mm_and_si128(a.v, b.v); }
+inline Slice operator|(Slice a, Slice b) { return _mm_or_si128(a.v, b.v); }
+inline Slice operator~(Slice a) {
+    return _mm_xor_si128(a.v, _mm_set1_epi32(-1));
+}
+inline Slice operator<<(Slice a, int n) { return _mm_slli_epi64(a.v, n); }
+inline Slice operator>>(Slice a, int n) { return _mm_srli_epi64(a.v, n); }
+inline Slice &operator^=(Slice &a, Slice b) { return a = a ^ b; }
+
+inline Slice rotr32(Slice a) {
+    return _mm_shuffle_epi32(a.v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+/**
+ * The AES S-box as a boolean circuit, from Boyar and Peralta, "A new
+ * combinational logic minimization technique with applications to
+ * cryptology".  Variables x* and s* are numbered from the most significant
+ * bit.
+ */
+void sbox(Slice *q) {
+    Slice x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+    Slice x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // Top linear transformation
+    Slice y14 = x3 ^ x5;
+    Slice y13 = x0 ^ x6;
+    Slice y9 = x0 ^ x3;
+    Slice y8 = x0 ^ x5;
+    Slice t0 = x1 ^ x2;
+    Slice y1 = t0 ^ x7;
+    Slice y4 = y1 ^ x3;
+    Slice y12 = y13 ^ y14;
+    Slice y2 = y1 ^ x0;
+    Slice y5 = y1 ^ x6;
+    Slice y3 = y5 ^ y8;
+    Slice t1 = x4 ^ y12;
+    Slice y15 = t1 ^ x5;
+    Slice y20 = t1 ^ x1;
+    Slice y6 = y15 ^ x7;
+    Slice y10 = y15 ^ t0;
+    Slice y11 = y20 ^ y9;
+    Slice y7 = x7 ^ y11;
+    Slice y17 = y10 ^ y11;
+    Slice y19 = y10 ^ y8;
+    Slice y16 = t0 ^ y11;
+    Slice y21 = y13 ^ y16;
+    Slice y18 = x0 ^ y16;
+
+    // Non-linear section
+    Slice t2 = y12 & y15;
+    Slice t3 = y3 & y6;
+    Slice t4 = t3 ^ t2;
+    Slice t5 = y4 & x7;
+    Slice t6 = t5 ^ t2;
+    Slice t7 = y13 & y16;
+    Slice t8 = y5 & y1;
+    Slice t9 = t8 ^ t7;
+    Slice t10 = y2 & y7;
+    Slice t11 = t10 ^ t7;
+    Slice t12 = y9 & y11;
+    Slice t13 = y14 & y17;
+    Slice t14 = t13 ^ t12;
+    Slice t15 = y8 & y10;
+    Slice t16 = t15 ^ t12;
+    Slice t17 = t4 ^ t14;
+    Slice t18 = t6 ^ t16;
+    Slice t19 = t9 ^ t14;
+    Slice t20 = t11 ^ t16;
+    Slice t21 = t17 ^ y20;
+    Slice t22 = t18 ^ y19;
+    Slice t23 = t19 ^ y21;
+    Slice t24 = t20 ^ y18;
+
+    Slice t25 = t21 ^ t22;
+    Slice t26 = t21 & t23;
+    Slice t27 = t24 ^ t26;
+    Slice t28 = t25 & t27;
+    Slice t29 = t28 ^ t22;
+    Slice t30 = t23 ^ t24;
+    Slice t31 = t22 ^ t26;
+    Slice t32 = t31 & t30;
+    Slice t33 = t32 ^ t24;
+    Slice t34 = t23 ^ t33;
+    Slice t35 = t27 ^ t33;
+    Slice t36 = t24 & t35;
+    Slice t37 = t36 ^ t34;
+    Slice t38 = t27 ^ t36;
+    Slice t39 = t29 & t38;
+    Slice t40 = t25 ^ t39;
+
+    Slice t41 = t40 ^ t37;
+    Slice t42 = t29 ^ t33;
+    Slice t43 = t29 ^ t40;
+    Slice t44 = t33 ^ t37;
+    Slice t45 = t42 ^ t41;
+    Slice z0 = t44 & y15;
+    Slice z1 = t37 & y6;
+    Slice z2 = t33 & x7;
+    Slice z3 = t43 & y16;
+    Slice z4 = t40 & y1;
+    Slice z5 = t29 & y7;
+    Slice z6 = t42 & y11;
+    Slice z7 = t45 & y17;
+    Slice z8 = t41 & y10;
+    Slice z9 = t44 & y12;
+    Slice z10 = t37 & y3;
+    Slice z11 = t33 & y4;
+    Slice z12 = t43 & y13;
+    Slice z13 = t40 & y5;
+    Slice z14 = t29 & y2;
+    Slice z15 = t42 & y9;
+    Slice z16 = t45 & y14;
+    Slice z17 = t41 & y8;
+
+    // Bottom linear transformation
+    Slice t46 = z15 ^ z16;
+    Slice t47 = z10 ^ z11;
+    Slice t48 = z5 ^ z13;
+    Slice t49 = z9 ^ z10;
+    Slice t50 = z2 ^ z12;
+    Slice t51 = z2 ^ z5;
+    Slice t52 = z7 ^ z8;
+    Slice t53 = z0 ^ z3;
+    Slice t54 = z6 ^ z7;
+    Slice t55 = z16 ^ z17;
+    Slice t56 = z12 ^ t48;
+    Slice t57 = t50 ^ t53;
+    Slice t58 = z4 ^ t46;
+    Slice t59 = z3 ^ t54;
+    Slice t60 = t46 ^ t57;
+    Slice t61 = z14 ^ t57;
+    Slice t62 = t52 ^ t58;
+    Slice t63 = t49 ^ t58;
+    Slice t64 = z4 ^ t59;
+    Slice t65 = t61 ^ t62;
+    Slice t66 = z1 ^ t63;
+    Slice s0 = t59 ^ t63;
+    Slice s6 = t56 ^ ~t62;
+    Slice s7 = t48 ^ ~t60;
+    Slice t67 = t64 ^ t65;
+    Slice s3 = t53 ^ t66;
+    Slice s4 = t51 ^ t66;
+    Slice s5 = t47 ^ t65;
+    Slice s1 = t64 ^ ~s3;
+    Slice s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/**
+ * Inverse of the affine transformation of the S-box.  The inverse S-box is
+ * computed by applying it both before and after the forward S-box, since
+ * inversion in GF(2^8) is an involution.
+ */
+void inv_affine(Slice *q) {
+    Slice q0 = ~q[0], q1 = ~q[1], q2 = q[2], q3 = q[3];
+    Slice q4 = q[4], q5 = ~q[5], q6 = ~q[6], q7 = q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+void inv_sbox(Slice *q) {
+    inv_affine(q);
+    sbox(q);
+    inv_affine(q);
+}
+
+/**
+ * Transpose the state between the "one word per block" representation and
+ * the bitsliced one.  The transformation is its own inverse.
+ */
+inline void swap_bits(Slice &x, Slice &y, uint64_t low_mask, uint64_t high_mask,
+                      int shift) {
+    Slice a = x, b = y;
+    x = (a & Slice(low_mask)) | ((b & Slice(low_mask)) << shift);
+    y = ((a & Slice(high_mask)) >> shift) | (b & Slice(high_mask));
+}
+
+void ortho(Slice *q) {
+    const uint64_t m1l = 0x5555555555555555ULL, m1h = 0xAAAAAAAAAAAAAAAAULL;
+    const uint64_t m2l = 0x3333333333333333ULL, m2h = 0xCCCCCCCCCCCCCCCCULL;
+    const uint64_t m4l = 0x0F0F0F0F0F0F0F0FULL, m4h = 0xF0F0F0F0F0F0F0F0ULL;
+
+    swap_bits(q[0], q[1], m1l, m1h, 1);
+    swap_bits(q[2], q[3], m1l, m1h, 1);
+    swap_bits(q[4], q[5], m1l, m1h, 1);
+    swap_bits(q[6], q[7], m1l, m1h, 1);
+
+    swap_bits(q[0], q[2], m2l, m2h, 2);
+    swap_bits(q[1], q[3], m2l, m2h, 2);
+    swap_bits(q[4], q[6], m2l, m2h, 2);
+    swap_bits(q[5], q[7], m2l, m2h, 2);
+
+    swap_bits(q[0], q[4], m4l, m4h, 4);
+    swap_bits(q[1], q[5], m4l, m4h, 4);
+    swap_bits(q[2], q[6], m4l, m4h, 4);
+    swap_bits(q[3], q[7], m4l, m4h, 4);
+}
+
+/**
+ * Spread the four little-endian words of a block over two 64-bit words, so
+ * that ortho() can be applied to them.
+ */
+void interleave_in(uint64_t *q0, uint64_t *q1, const uint32_t *w) {
+    uint64_t x0 = w[0], x1 = w[1], x2 = w[2], x3 = w[3];
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+    x0 &= 0x0000FFFF0000FFFFULL;
+    x1 &= 0x0000FFFF0000FFFFULL;
+    x2 &= 0x0000FFFF0000FFFFULL;
+    x3 &= 0x0000FFFF0000FFFFULL;
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+    x0 &= 0x00FF00FF00FF00FFULL;
+    x1 &= 0x00FF00FF00FF00FFULL;
+    x2 &= 0x00FF00FF00FF00FFULL;
+    x3 &= 0x00FF00FF00FF00FFULL;
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+void interleave_out(uint32_t *w, uint64_t q0, uint64_t q1) {
+    uint64_t x0 = q0 & 0x00FF00FF00FF00FFULL;
+    uint64_t x1 = q1 & 0x00FF00FF00FF00FFULL;
+    uint64_t x2 = (q0 >> 8) & 0x00FF00FF00FF00FFULL;
+    uint64_t x3 = (q1 >> 8) & 0x00FF00FF00FF00FFULL;
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+    x0 &= 0x0000FFFF0000FFFFULL;
+    x1 &= 0x0000FFFF0000FFFFULL;
+    x2 &= 0x0000FFFF0000FFFFULL;
+    x3 &= 0x0000FFFF0000FFFFULL;
+    w[0] = uint32_t(x0) | uint32_t(x0 >> 16);
+    w[1] = uint32_t(x1) | uint32_t(x1 >> 16);
+    w[2] = uint32_t(x2) | uint32_t(x2 >> 16);
+    w[3] = uint32_t(x3) | uint32_t(x3 >> 16);
+}
+
+/**
+ * Load up to eight blocks into the bitsliced state.  Block i goes into the
+ * position i % 4 of the lane i / 4; missing blocks are zero.
+ */
+void load_blocks(const uint8_t *in, size_t num_blocks, Slice *q) {
+    uint64_t lanes[2][8] = { { 0 } };
+    for (size_t i = 0; i < num_blocks; i++) {
+        uint32_t w[4];
+        memcpy(w, in + i * 16, 16);
+        interleave_in(&lanes[i / 4][i % 4], &lanes[i / 4][i % 4 + 4], w);
+    }
+    for (size_t k = 0; k < 8; k++) {
+        q[k] = _mm_set_epi64x(lanes[1][k], lanes[0][k]);
+    }
+    ortho(q);
+}
+
+void store_blocks(Slice *q, uint8_t *out, size_t num_blocks) {
+    uint64_t lanes[2][8];
+    ortho(q);
+    for (size_t k = 0; k < 8; k++) {
+        uint64_t halves[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(halves), q[k].v);
+        lanes[0][k] = halves[0];
+        lanes[1][k] = halves[1];
+    }
+    for (size_t i = 0; i < num_blocks; i++) {
+        uint32_t w[4];
+        interleave_out(w, lanes[i / 4][i % 4], lanes[i / 4][i % 4 + 4]);
+        memcpy(out + i * 16, w, 16);
+    }
+}
+
+// The round key is the same for all eight blocks, so the four bits of a nibble
+// in a slice are all equal, and a round key is stored compressed to two words
+// holding one bit per nibble of each slice, as in BearSSL.  Expanding it
+// takes a few scalar operations per slice, which run alongside the vector
+// code.
+inline void add_round_key(Slice *q, const uint64_t *rk) {
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t x = (rk[i / 4] >> (i % 4)) & 0x1111111111111111ULL;
+        q[i] ^= Slice(_mm_set1_epi64x((x << 4) - x));
+    }
+}
+
+void shift_rows(Slice *q) {
+    for (size_t i = 0; i < 8; i++) {
+        Slice x = q[i];
+        q[i] = (x & Slice(0x000000000000FFFFULL))
+             | ((x & Slice(0x00000000FFF00000ULL)) >> 4)
+             | ((x & Slice(0x00000000000F0000ULL)) << 12)
+             | ((x & Slice(0x0000FF0000000000ULL)) >> 8)
+             | ((x & Slice(0x000000FF00000000ULL)) << 8)
+             | ((x & Slice(0xF000000000000000ULL)) >> 12)
+             | ((x & Slice(0x0FFF000000000000ULL)) << 4);
+    }
+}
+
+void inv_shift_rows(Slice *q) {
+    for (size_t i = 0; i < 8; i++) {
+        Slice x = q[i];
+        q[i] = (x & Slice(0x000000000000FFFFULL))
+             | ((x & Slice(0x000000000FFF0000ULL)) << 4)
+             | ((x & Slice(0x00000000F0000000ULL)) >> 12)
+             | ((x & Slice(0x000000FF00000000ULL)) << 8)
+             | ((x & Slice(0x0000FF0000000000ULL)) >> 8)
+             | ((x & Slice(0x000F000000000000ULL)) << 12)
+             | ((x & Slice(0xFFF0000000000000ULL)) >> 4);
+    }
+}
+
+void mix_columns(Slice *q) {
+    Slice q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    Slice q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    Slice r0 = (q0 >> 16) | (q0 << 48);
+    Slice r1 = (q1 >> 16) | (q1 << 48);
+    Slice r2 = (q2 >> 16) | (q2 << 48);
+    Slice r3 = (q3 >> 16) | (q3 << 48);
+    Slice r4 = (q4 >> 16) | (q4 << 48);
+    Slice r5 = (q5 >> 16) | (q5 << 48);
+    Slice r6 = (q6 >> 16) | (q6 << 48);
+    Slice r7 = (q7 >> 16) | (q7 << 48);
+
+    q[0] = q7 ^ r7 ^ r0 ^ rotr32(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ rotr32(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ rotr32(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ rotr32(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ rotr32(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ rotr32(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ rotr32(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ rotr32(q7 ^ r7);
+}
+
+void inv_mix_columns(Slice *q) {
+    Slice q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    Slice q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    Slice r0 = (q0 >> 16) | (q0 << 48);
+    Slice r1 = (q1 >> 16) | (q1 << 48);
+    Slice r2 = (q2 >> 16) | (q2 << 48);
+    Slice r3 = (q3 >> 16) | (q3 << 48);
+    Slice r4 = (q4 >> 16) | (q4 << 48);
+    Slice r5 = (q5 >> 16) | (q5 << 48);
+    Slice r6 = (q6 >> 16) | (q6 << 48);
+    Slice r7 = (q7 >> 16) | (q7 << 48);
+
+    q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7 ^ rotr32(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+    q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7
+         ^ rotr32(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+    q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7
+         ^ rotr32(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+    q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5
+         ^ rotr32(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^ r7);
+    q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7
+         ^ rotr32(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+    q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7
+         ^ rotr32(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+    q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7
+         ^ rotr32(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+    q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7 ^ rotr32(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+}
+
+void encrypt8(const uint64_t *rk, size_t nrounds, Slice *q) {
+    add_round_key(q, rk);
+    for (size_t i = 1; i < nrounds; i++) {
+        sbox(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, rk + i * 2);
+    }
+    sbox(q);
+    shift_rows(q);
+    add_round_key(q, rk + nrounds * 2);
+}
+
+void decrypt8(const uint64_t *rk, size_t nrounds, Slice *q) {
+    add_round_key(q, rk + nrounds * 2);
+    for (size_t i = nrounds - 1; i > 0; i--) {
+        inv_shift_rows(q);
+        inv_sbox(q);
+        add_round_key(q, rk + i * 2);
+        inv_mix_columns(q);
+    }
+    inv_shift_rows(q);
+    inv_sbox(q);
+    add_round_key(q, rk);
+}
+
+/**
+ * SubWord() of the key schedule, computed with the bitsliced S-box so that
+ * the key expansion is constant-time as well.
+ */
+uint32_t sub_word(uint32_t x) {
+    uint8_t block[16] = { 0 };
+    memcpy(block, &x, 4);
+
+    Slice q[8];
+    load_blocks(block, 1, q);
+    sbox(q);
+    store_blocks(q, block, 1);
+
+    memcpy(&x, block, 4);
+    return x;
+}
+
+}
+
+BitslicedAES::BitslicedAES(const memslice key) {
+    contract_assert(is_valid_key_size(key.size()));
+
+    size_t nk = key.size() / 4;
+    nrounds = nk + 6;
+
+    // Regular key expansion, on little-endian words.  RotWord() hence
+    // becomes a right rotation, and the round constant goes into the lowest
+    // byte.
+    uint32_t w[60];
+    memcpy(w, key.cptr(), key.size());
+    uint32_t rcon = 0x01;
+    for (size_t i = nk; i < 4 * (nrounds + 1u); i++) {
+        uint32_t tmp = w[i - 1];
+        if (i % nk == 0) {
+            tmp = sub_word((tmp >> 8) | (tmp << 24)) ^ rcon;
+            rcon = (rcon << 1) ^ (0x11b & -(rcon >> 7));
+        } else if (nk > 6 && i % nk == 4) {
+            tmp = sub_word(tmp);
+        }
+        w[i] = w[i - nk] ^ tmp;
+    }
+
+    // Convert each round key into the bitsliced form, replicated for all
+    // eight blocks
+    for (size_t i = 0; i <= nrounds; i++) {
+        uint8_t blocks[8 * 16];
+        for (size_t j = 0; j < 8; j++) {
+            memcpy(blocks + j * 16, w + i * 4, 16);
+        }
+
+        Slice q[8];
+        load_blocks(blocks, 8, q);
+        uint64_t compressed[2] = { 0, 0 };
+        for (size_t k = 0; k < 8; k++) {
+            compressed[k / 4] |= _mm_cvtsi128_si64(q[k].v) &
+                                 (0x1111111111111111ULL << (k % 4));
+        }
+        round_keys[i * 2 + 0] = compressed[0];
+        round_keys[i * 2 + 1] = compressed[1];
+    }
+}
+
+void BitslicedAES::encrypt_block(const uint8_t *plaintext,
+                                 uint8_t *ciphertext) const {
+    Slice q[8];
+    load_blocks(plaintext, 1, q);
+    encrypt8(round_keys, nrounds, q);
+    store_blocks(q, ciphertext, 1);
+}
+
+void BitslicedAES::decrypt_block(const uint8_t *ciphertext,
+                                 uint8_t *plaintext) const {
+    Slice q[8];
+    load_blocks(ciphertext, 1, q);
+    decrypt8(round_keys, nrounds, q);
+    store_blocks(q, plaintext, 1);
+}
+
+void BitslicedAES::encrypt_blocks(const uint8_t *plaintext,
+                                  uint8_t *ciphertext, size_t num_blocks) const {
+    while (num_blocks > 0) {
+        size_t batch = num_blocks < 8 ? num_blocks : 8;
+        Slice q[8];
+        load_blocks(plaintext, batch, q);
+        encrypt8(round_keys, nrounds, q);
+        store_blocks(q, ciphertext, batch);
+
+        plaintext += batch * 16;
+        ciphertext += batch * 16;
+        num_blocks -= batch;
+    }
+}
+
+void BitslicedAES::decrypt_blocks(const uint8_t *ciphertext,
+                                  uint8_t *plaintext, size_t num_blocks) const {
+    while (num_blocks > 0) {
+        size_t batch = num_blocks < 8 ? num_blocks : 8;
+        Slice q[8];
+        load_blocks(ciphertext, batch, q);
+        decrypt8(round_keys, nrounds, q);
+        store_blocks(q, plaintext, batch);
+
+        ciphertext += batch * 16;
+        plaintext += batch * 16;
+        num_blocks -= batch;
+    }
+}
+
+void BitslicedAES::counter_xor(const memslice iv, const memslice input,
+                               memslice output) const {
+    contract_assert(iv.size() == 16);
+    contract_assert(output.size() == input.size());
+
+    uint64_t hi, lo;
+    memcpy(&hi, iv.cptr(), 8);
+    memcpy(&lo, iv.cptr() + 8, 8);
+    hi = __builtin_bswap64(hi);
+    lo = __builtin_bswap64(lo);
+
+    for (size_t offset = 0; offset < input.size(); offset += 8 * 16) {
+        size_t len = input.size() - offset;
+        if (len > 8 * 16) {
+            len = 8 * 16;
+        }
+        size_t batch = (len + 15) / 16;
+
+        // Generate the next eight counter values
+        uint8_t keystream[8 * 16];
+        for (size_t i = 0; i < batch; i++) {
+            uint64_t be_hi = __builtin_bswap64(hi);
+            uint64_t be_lo = __builtin_bswap64(lo);
+            memcpy(keystream + i * 16, &be_hi, 8);
+            memcpy(keystream + i * 16 + 8, &be_lo, 8);
+            if (++lo == 0) {
+                hi++;
+            }
+        }
+
+        Slice q[8];
+        load_blocks(keystream, batch, q);
+        encrypt8(round_keys, nrounds, q);
+        store_blocks(q, keystream, batch);
+
+        const uint8_t *in = input.cptr() + offset;
+        uint8_t *out = output.ptr() + offset;
+        for (size_t j = 0; j < len; j++) {
+            out[j] = in[j] ^ keystream[j];
+        }
+    }
+}
+
+}
@@ -5,6 +5,7 @@
 #include "crypto/testutils/compat_tester.hh"
 
 #include <random>
+#include <vector>
 
 const crypto::bytestring nist_aes_pt_block =
     crypto::bytestring::from_hex("00112233445566778899aabbccddeeff");
@@ -466,6 +467,50 @@ void test_cbc_vectors(crypto::BlockCipherFactory impl) {
     }
 }
 
+// Test vectors from NIST SP 800-38A, F.5.1 and F.5.5
+const CAVSTestVector CTRVectors[] = {
+    CAVSTestVector(0, "2b7e151628aed2a6abf7158809cf4f3c",
+                   "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",
+                   "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45a"
+                   "f8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b41"
+                   "7be66c3710",
+                   "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9f"
+                   "ffdff5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170"
+                   "a0f3009cee"),
+    CAVSTestVector(1, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a"
+                      "30914dff4",
+                   "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",
+                   "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45a"
+                   "f8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b41"
+                   "7be66c3710",
+                   "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cac"
+                   "af5c52b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd"
+                   "08457941a6"),
+};
+
+/**
+ * Tests an implementation against CTR test vectors for AES-128 and AES-256
+ * provided by NIST, including truncated inputs.
+ */
+void test_ctr_vectors(crypto::BlockCipherFactory impl) {
+    crypto::bytestring output;
+
+    for (const CAVSTestVector &vec : CTRVectors) {
+        crypto::BlockCipher_u aes = impl(vec.key.cmem());
+        aes->counter_xor(vec.iv, vec.input, output);
+        EXPECT_EQ(vec.output, output);
+        aes->counter_xor(vec.iv, vec.output, output);
+        EXPECT_EQ(vec.input, output);
+
+        // CTR mode does not require input to be divisible by block size
+        for (size_t len : { 0, 1, 15, 17, 63 }) {
+            crypto::bytestring input = vec.input.substr(0, len);
+            aes->counter_xor(vec.iv, input, output);
+            EXPECT_EQ(vec.output.substr(0, len), output);
+        }
+    }
+}
+
 crypto::BlockCipher_u referenceAES(const crypto::memslice key) {
     return crypto::BlockCipher_u(new crypto::ReferenceAES(key));
 }
@@ -478,9 +523,15 @@ TEST(ReferenceAES, CBCVectors) {
     test_cbc_vectors(referenceAES);
 }
 
+TEST(ReferenceAES, CTRVectors) {
+    test_ctr_vectors(referenceAES);
+}
+
 TEST(ReferenceAES, SelfCompat) {
     crypto::test_randomized_compat(referenceAES, referenceAES, 16, 10000);
     crypto::test_randomized_compat(referenceAES, referenceAES, 32, 10000);
+    crypto::test_randomized_cbc_compat(referenceAES, referenceAES, 16, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, referenceAES, 32, 1000);
 }
 
 crypto::BlockCipher_u intelAES(const crypto::memslice key) {
@@ -504,12 +555,179 @@ TEST(IntelAES, SelfCompat) {
 TEST(IntelAES, ReferenceCompat) {
     crypto::test_randomized_compat(referenceAES, intelAES, 16, 10000);
     crypto::test_randomized_compat(referenceAES, intelAES, 32, 10000);
+    crypto::test_randomized_cbc_compat(referenceAES, intelAES, 16, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, intelAES, 32, 1000);
+}
+
+crypto::BlockCipher_u aesni(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::AESNI(key));
+}
+
+TEST(AESNI, NISTVectors) {
+    test_nist_vectors(aesni);
+}
+
+TEST(AESNI, CBCVectors) {
+    test_cbc_vectors(aesni);
+}
+
+TEST(AESNI, CTRVectors) {
+    test_ctr_vectors(aesni);
+}
+
+TEST(AESNI, SelfCompat) {
+    crypto::test_randomized_compat(aesni, aesni, 16, 10000);
+    crypto::test_randomized_compat(aesni, aesni, 32, 10000);
+}
+
+TEST(AESNI, ReferenceCompat) {
+    crypto::test_randomized_compat(referenceAES, aesni, 16, 10000);
+    crypto::test_randomized_compat(referenceAES, aesni, 32, 10000);
+    crypto::test_randomized_ctr_compat(referenceAES, aesni, 16, 1000);
+    crypto::test_randomized_ctr_compat(referenceAES, aesni, 32, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, aesni, 16, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, aesni, 32, 1000);
+}
+
+TEST(AESNI, MultiBufferCBC) {
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
+    std::uniform_int_distribution<size_t> block_counts(0, 40);
+
+    // Mix AES-128 and AES-256 jobs of different lengths, as well as jobs
+    // which have to go through the serial fallback
+    const size_t num_jobs = 37;
+    std::vector<crypto::AESBase_u> ciphers;
+    std::vector<crypto::bytestring> ivs, plaintexts, ciphertexts;
+    std::vector<crypto::AESCBCJob> jobs;
+    for (size_t i = 0; i < num_jobs; i++) {
+        crypto::bytestring key(i % 3 == 0 ? 32 : 16);
+        crypto::bytestring iv(16);
+        crypto::bytestring plaintext(block_counts(rng) * 16);
+        for (crypto::bytestring *str : { &key, &iv, &plaintext }) {
+            for (size_t j = 0; j < str->size(); j++) {
+                (*str)[j] = all_bytes(rng);
+            }
+        }
+
+        if (i % 7 == 6) {
+            ciphers.emplace_back(new crypto::ReferenceAES(key.cmem()));
+        } else {
+            ciphers.emplace_back(new crypto::AESNI(key.cmem()));
+        }
+        ivs.push_back(iv);
+        plaintexts.push_back(plaintext);
+        ciphertexts.emplace_back(plaintext.size());
+    }
+    for (size_t i = 0; i < num_jobs; i++) {
+        jobs.push_back({ ciphers[i].get(), ivs[i].cptr(), plaintexts[i].cptr(),
+                         ciphertexts[i].ptr(), plaintexts[i].size() });
+    }
+
+    crypto::aes_encrypt_cbc_multi(jobs.data(), jobs.size());
+
+    crypto::bytestring expected;
+    for (size_t i = 0; i < num_jobs; i++) {
+        ciphers[i]->encrypt_cbc(plaintexts[i], ivs[i], expected);
+        EXPECT_EQ(expected, ciphertexts[i]) << "Job " << i;
+    }
+}
+
+// The AES-NI backend does not check the contract on the job sizes; a job
+// shorter than a block has to be skipped rather than hold its lane forever
+TEST(AESNI, MultiBufferCBCShortJobs) {
+    crypto::bytestring key(16), iv(16), plaintext(64), short_input(8);
+    crypto::AESNI aes(key.cmem());
+    crypto::bytestring ciphertext(64), short_output(8), expected;
+
+    crypto::AESCBCJob jobs[] = {
+        { &aes, iv.cptr(), short_input.cptr(), short_output.ptr(), 8 },
+        { &aes, iv.cptr(), plaintext.cptr(), ciphertext.ptr(), 64 },
+        { &aes, iv.cptr(), short_input.cptr(), short_output.ptr(), 0 },
+    };
+    crypto::AESNI::encrypt_cbc_multi(jobs, 3);
+
+    aes.encrypt_cbc(plaintext, iv, expected);
+    EXPECT_EQ(expected, ciphertext);
+    EXPECT_EQ(crypto::bytestring(8), short_output);
+}
+
+crypto::BlockCipher_u bitslicedAES(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::BitslicedAES(key));
+}
+
+TEST(BitslicedAES, NISTVectors) {
+    test_nist_vectors(bitslicedAES);
+}
+
+TEST(BitslicedAES, CBCVectors) {
+    test_cbc_vectors(bitslicedAES);
+}
+
+TEST(BitslicedAES, CTRVectors) {
+    test_ctr_vectors(bitslicedAES);
+}
+
+TEST(BitslicedAES, ReferenceCompat) {
+    crypto::test_randomized_compat(referenceAES, bitslicedAES, 16, 10000);
+    crypto::test_randomized_compat(referenceAES, bitslicedAES, 32, 10000);
+    crypto::test_randomized_ctr_compat(referenceAES, bitslicedAES, 16, 1000);
+    crypto::test_randomized_ctr_compat(referenceAES, bitslicedAES, 32, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, bitslicedAES, 16, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, bitslicedAES, 32, 1000);
+}
+
+crypto::BlockCipher_u vpaes(const crypto::memslice key) {
+    return crypto::BlockCipher_u(new crypto::VPAES(key));
+}
+
+TEST(VPAES, NISTVectors) {
+    test_nist_vectors(vpaes);
+}
+
+TEST(VPAES, CBCVectors) {
+    test_cbc_vectors(vpaes);
+}
+
+TEST(VPAES, CTRVectors) {
+    test_ctr_vectors(vpaes);
+}
+
+TEST(VPAES, ReferenceCompat) {
+    crypto::test_randomized_compat(referenceAES, vpaes, 16, 10000);
+    crypto::test_randomized_compat(referenceAES, vpaes, 32, 10000);
+    crypto::test_randomized_ctr_compat(referenceAES, vpaes, 16, 1000);
+    crypto::test_randomized_ctr_compat(referenceAES, vpaes, 32, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, vpaes, 16, 1000);
+    crypto::test_randomized_cbc_compat(referenceAES, vpaes, 32, 1000);
 }
 
 TEST(AESInterface, ImplSelection) {
     test_nist_vectors(crypto::AES);
 }
 
+TEST(AESInterface, Emplace) {
+    const size_t num_keys = 16;
+    crypto::AESStorage storage[num_keys];
+    crypto::AESBase *ciphers[num_keys];
+    crypto::bytestring key(16), block(16), expected(16), actual(16);
+
+    for (size_t i = 0; i < num_keys; i++) {
+        key[0] = i;
+        ciphers[i] = crypto::AES_emplace(key.cmem(), &storage[i]);
+        EXPECT_EQ(static_cast<void *>(&storage[i]),
+                  static_cast<void *>(ciphers[i]));
+    }
+    for (size_t i = 0; i < num_keys; i++) {
+        key[0] = i;
+        crypto::AESBase_u heap_cipher = crypto::AES(key.cmem());
+        heap_cipher->encrypt_block(block.cptr(), expected.ptr());
+        ciphers[i]->encrypt_block(block.cptr(), actual.ptr());
+        EXPECT_EQ(expected, actual) << "Key " << i;
+        ciphers[i]->~AESBase();
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,508 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Constant-time AES using SSSE3 vector permutations, following the approach
+// of Mike Hamburg, "Accelerating AES with Vector Permute Instructions"
+// (CHES 2009).  Compiled with -mssse3.
+//
+// GF(2^8) is represented as a quadratic extension of GF(16), so that every
+// byte of the state splits into two elements of GF(16), its high nibble i
+// and its low nibble k.  The inverse is then computed with 16-entry table
+// lookups on nibbles, which pshufb performs on sixteen bytes at once:
+//
+//     j = i + k,  iak = 1/i + a/k,  jak = 1/j + a/k,
+//     io = 1/iak + j,  jo = 1/jak + i,
+//
+// after which the inverse, the affine transform of the S-box and
+// multiplication by MixColumns coefficients are all linear functions which
+// are computed as T_u[io] + T_t[jo].  The division by zero yields 0x80,
+// which pshufb maps to zero, and which makes the formulas above work out for
+// the zero nibbles as well.
+//
+// The state is kept in the tower field basis between the rounds; the round
+// keys are converted into it when the key is set, and the 0x63 constant of
+// the S-box is folded into them.  Decryption uses the equivalent inverse
+// cipher.
+//
+// The tables below were generated offline for the field
+// GF(16) = GF(2)[y]/(y^4 + y + 1) with the extension t^2 + 2t + 2 and a = 2,
+// and checked against the FIPS-197 test vectors.
+
+#include "crypto/cipher/aes.hh"
+
+#include <cstring>
+
+#include <tmmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+// 1/x in GF(16); 1/0 is represented by 0x80, for which pshufb yields 0
+alignas(16) const uint8_t k_inv[16] = {
+    0x80, 0x01, 0x09, 0x0e, 0x0d, 0x0b, 0x07, 0x06,
+    0x0f, 0x02, 0x0c, 0x05, 0x0a, 0x04, 0x03, 0x08
+};
+
+// a/x for the constant a of the tower field
+alignas(16) const uint8_t k_a_over_k[16] = {
+    0x80, 0x02, 0x01, 0x0f, 0x09, 0x05, 0x0e, 0x0c,
+    0x0d, 0x04, 0x0b, 0x0a, 0x07, 0x08, 0x06, 0x03
+};
+
+// Change of basis into the tower field, low and high nibble
+alignas(16) const uint8_t k_enc_input[2][16] = {
+    { 0x00, 0x01, 0x1c, 0x1d, 0x2d, 0x2c, 0x31, 0x30,
+      0x27, 0x26, 0x3b, 0x3a, 0x0a, 0x0b, 0x16, 0x17 },
+    { 0x00, 0x86, 0xfd, 0x7b, 0x8e, 0x08, 0x73, 0xf5,
+      0x77, 0xf1, 0x8a, 0x0c, 0xf9, 0x7f, 0x04, 0x82 }
+};
+
+// S-box output, without the 0x63 constant
+alignas(16) const uint8_t k_enc_sb1[2][16] = {
+    { 0x00, 0xc3, 0x4f, 0x0c, 0xfc, 0x7c, 0x43, 0x80,
+      0xcf, 0x33, 0x3f, 0x70, 0xbf, 0xb3, 0xf0, 0x8c },
+    { 0x00, 0xe6, 0x72, 0xb7, 0xe5, 0xc6, 0xc5, 0x23,
+      0x51, 0xb4, 0x03, 0x71, 0x20, 0x97, 0x52, 0x94 }
+};
+
+// S-box output multiplied by 2
+alignas(16) const uint8_t k_enc_sb2[2][16] = {
+    { 0x00, 0x7c, 0x20, 0xcf, 0x92, 0x01, 0xef, 0x93,
+      0xb3, 0x21, 0xee, 0xce, 0x7d, 0xb2, 0x5d, 0x5c },
+    { 0x00, 0xd1, 0xe5, 0xf7, 0xe6, 0x25, 0x12, 0xc3,
+      0x26, 0xc0, 0x37, 0xd2, 0xf4, 0x03, 0x11, 0x34 }
+};
+
+// S-box output of the last round, in the standard basis
+alignas(16) const uint8_t k_enc_sbo[2][16] = {
+    { 0x00, 0xcb, 0xd7, 0xb0, 0x21, 0x8d, 0x67, 0xac,
+      0x7b, 0x5a, 0xea, 0x3d, 0x46, 0xf6, 0x91, 0x1c },
+    { 0x00, 0x9f, 0x61, 0x16, 0xc2, 0x2a, 0x77, 0xe8,
+      0x89, 0x4b, 0x5d, 0x3c, 0xb5, 0xa3, 0xd4, 0xfe }
+};
+
+// Change of basis for decryption, including the inverse affine transform
+alignas(16) const uint8_t k_dec_input[2][16] = {
+    { 0x2c, 0x99, 0xf0, 0x45, 0xf7, 0x42, 0x2b, 0x9e,
+      0x38, 0x8d, 0xe4, 0x51, 0xe3, 0x56, 0x3f, 0x8a },
+    { 0x00, 0xa7, 0xa8, 0x0f, 0xed, 0x4a, 0x45, 0xe2,
+      0xd1, 0x76, 0x79, 0xde, 0x3c, 0x9b, 0x94, 0x33 }
+};
+
+// Inverse S-box output multiplied by 9
+alignas(16) const uint8_t k_dec_sb9[2][16] = {
+    { 0x00, 0x27, 0xbf, 0x47, 0xda, 0x05, 0xf8, 0xdf,
+      0x60, 0xba, 0xfd, 0x42, 0x22, 0x65, 0x9d, 0x98 },
+    { 0x00, 0x01, 0x8c, 0x2e, 0xa8, 0x0b, 0xa2, 0xa3,
+      0x2f, 0x87, 0xa9, 0x25, 0x0a, 0x24, 0x86, 0x8d }
+};
+
+// Inverse S-box output multiplied by 11
+alignas(16) const uint8_t k_dec_sb11[2][16] = {
+    { 0x00, 0xc2, 0x4d, 0xeb, 0xdd, 0xb9, 0xa6, 0x64,
+      0x29, 0xf4, 0x1f, 0x52, 0x7b, 0x90, 0x36, 0x8f },
+    { 0x00, 0xf8, 0x22, 0xfd, 0x42, 0x65, 0xdf, 0x27,
+      0x05, 0x47, 0xba, 0x98, 0x9d, 0x60, 0xbf, 0xda }
+};
+
+// Inverse S-box output multiplied by 13
+alignas(16) const uint8_t k_dec_sb13[2][16] = {
+    { 0x00, 0x7c, 0x1b, 0x3d, 0x15, 0x4f, 0x26, 0x5a,
+      0x41, 0x54, 0x69, 0x72, 0x33, 0x0e, 0x28, 0x67 },
+    { 0x00, 0x77, 0xb2, 0xb0, 0xb6, 0xc3, 0x02, 0x75,
+      0xc7, 0x71, 0xc1, 0x73, 0xb4, 0x04, 0x06, 0xc5 }
+};
+
+// Inverse S-box output multiplied by 14
+alignas(16) const uint8_t k_dec_sb14[2][16] = {
+    { 0x00, 0xeb, 0xa6, 0xb9, 0x7b, 0x8f, 0x1f, 0xf4,
+      0x52, 0x29, 0x90, 0x36, 0x64, 0xdd, 0xc2, 0x4d },
+    { 0x00, 0xfd, 0xdf, 0x65, 0x9d, 0xda, 0xba, 0x47,
+      0x98, 0x05, 0x60, 0xbf, 0x27, 0x42, 0xf8, 0x22 }
+};
+
+// Inverse S-box output of the last round, in the standard basis
+alignas(16) const uint8_t k_dec_sbo[2][16] = {
+    { 0x00, 0x3b, 0xe4, 0xc8, 0x03, 0x14, 0x2c, 0x17,
+      0xf3, 0xf0, 0x38, 0xdc, 0x2f, 0xe7, 0xcb, 0xdf },
+    { 0x00, 0x24, 0x91, 0x19, 0x23, 0x8f, 0x88, 0xac,
+      0x3d, 0x1e, 0x07, 0x96, 0xab, 0xb2, 0x3a, 0xb5 }
+};
+
+// Byte permutations: ShiftRows followed by the rotation of each column by
+// zero to three positions, for MixColumns
+alignas(16) const uint8_t k_enc_rotations[4][16] = {
+    { 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11 },
+    { 5, 10, 15, 0, 9, 14, 3, 4, 13, 2, 7, 8, 1, 6, 11, 12 },
+    { 10, 15, 0, 5, 14, 3, 4, 9, 2, 7, 8, 13, 6, 11, 12, 1 },
+    { 15, 0, 5, 10, 3, 4, 9, 14, 7, 8, 13, 2, 11, 12, 1, 6 }
+};
+
+// Same as above for InvShiftRows and InvMixColumns
+alignas(16) const uint8_t k_dec_rotations[4][16] = {
+    { 0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3 },
+    { 13, 10, 7, 0, 1, 14, 11, 4, 5, 2, 15, 8, 9, 6, 3, 12 },
+    { 10, 7, 0, 13, 14, 11, 4, 1, 2, 15, 8, 5, 6, 3, 12, 9 },
+    { 7, 0, 13, 10, 11, 4, 1, 14, 15, 8, 5, 2, 3, 12, 9, 6 }
+};
+
+inline __m128i load_block(const uint8_t *ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+
+inline void store_block(uint8_t *ptr, __m128i block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), block);
+}
+
+inline __m128i load_table(const uint8_t *table) {
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(table));
+}
+
+inline __m128i shuffle(__m128i x, const uint8_t *mask) {
+    return _mm_shuffle_epi8(x, load_table(mask));
+}
+
+inline void split(__m128i x, __m128i &hi, __m128i &lo) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    lo = _mm_and_si128(x, mask);
+    hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+}
+
+// Apply a linear transformation given as lookup tables of the low and the
+// high nibble
+inline __m128i transform(__m128i x, const uint8_t (*table)[16]) {
+    __m128i hi, lo;
+    split(x, hi, lo);
+    return _mm_xor_si128(_mm_shuffle_epi8(load_table(table[0]), lo),
+                         _mm_shuffle_epi8(load_table(table[1]), hi));
+}
+
+// Inversion in the tower field, see the comment at the top of the file
+inline void invert(__m128i x, __m128i &io, __m128i &jo) {
+    const __m128i inv = load_table(k_inv);
+    __m128i i, k;
+    split(x, i, k);
+
+    __m128i ak = _mm_shuffle_epi8(load_table(k_a_over_k), k);
+    __m128i j = _mm_xor_si128(i, k);
+    __m128i iak = _mm_xor_si128(_mm_shuffle_epi8(inv, i), ak);
+    __m128i jak = _mm_xor_si128(_mm_shuffle_epi8(inv, j), ak);
+    io = _mm_xor_si128(_mm_shuffle_epi8(inv, iak), j);
+    jo = _mm_xor_si128(_mm_shuffle_epi8(inv, jak), i);
+}
+
+inline __m128i output(const uint8_t (*table)[16], __m128i io, __m128i jo) {
+    return _mm_xor_si128(_mm_shuffle_epi8(load_table(table[0]), io),
+                         _mm_shuffle_epi8(load_table(table[1]), jo));
+}
+
+inline __m128i encrypt_first(__m128i block, const __m128i *rk) {
+    return transform(_mm_xor_si128(block, rk[0]), k_enc_input);
+}
+
+inline __m128i encrypt_round(__m128i x, __m128i rk) {
+    __m128i io, jo;
+    invert(x, io, jo);
+    __m128i s1 = output(k_enc_sb1, io, jo);
+    __m128i s2 = output(k_enc_sb2, io, jo);
+
+    // MixColumns: 2 * a[r] + 3 * a[r + 1] + a[r + 2] + a[r + 3]
+    __m128i out = shuffle(s2, k_enc_rotations[0]);
+    out = _mm_xor_si128(out, shuffle(_mm_xor_si128(s1, s2),
+                                     k_enc_rotations[1]));
+    out = _mm_xor_si128(out, shuffle(s1, k_enc_rotations[2]));
+    out = _mm_xor_si128(out, shuffle(s1, k_enc_rotations[3]));
+    return _mm_xor_si128(out, rk);
+}
+
+inline __m128i encrypt_last(__m128i x, __m128i rk) {
+    __m128i io, jo;
+    invert(x, io, jo);
+    __m128i out = shuffle(output(k_enc_sbo, io, jo), k_enc_rotations[0]);
+    return _mm_xor_si128(out, rk);
+}
+
+inline __m128i decrypt_first(__m128i block, const __m128i *rk) {
+    return transform(_mm_xor_si128(block, rk[0]), k_dec_input);
+}
+
+inline __m128i decrypt_round(__m128i x, __m128i rk) {
+    __m128i io, jo;
+    invert(x, io, jo);
+
+    // InvMixColumns: 14 * a[r] + 11 * a[r + 1] + 13 * a[r + 2] + 9 * a[r + 3]
+    __m128i out = shuffle(output(k_dec_sb14, io, jo), k_dec_rotations[0]);
+    out = _mm_xor_si128(out, shuffle(output(k_dec_sb11, io, jo),
+                                     k_dec_rotations[1]));
+    out = _mm_xor_si128(out, shuffle(output(k_dec_sb13, io, jo),
+                                     k_dec_rotations[2]));
+    out = _mm_xor_si128(out, shuffle(output(k_dec_sb9, io, jo),
+                                     k_dec_rotations[3]));
+    return _mm_xor_si128(out, rk);
+}
+
+inline __m128i decrypt_last(__m128i x, __m128i rk) {
+    __m128i io, jo;
+    invert(x, io, jo);
+    __m128i out = shuffle(output(k_dec_sbo, io, jo), k_dec_rotations[0]);
+    return _mm_xor_si128(out, rk);
+}
+
+inline __m128i encrypt(const __m128i *rk, size_t nrounds, __m128i block) {
+    block = encrypt_first(block, rk);
+    for (size_t i = 1; i < nrounds; i++) {
+        block = encrypt_round(block, rk[i]);
+    }
+    return encrypt_last(block, rk[nrounds]);
+}
+
+inline __m128i decrypt(const __m128i *rk, size_t nrounds, __m128i block) {
+    block = decrypt_first(block, rk);
+    for (size_t i = 1; i < nrounds; i++) {
+        block = decrypt_round(block, rk[i]);
+    }
+    return decrypt_last(block, rk[nrounds]);
+}
+
+// Process four independent blocks at once, so that the lookups of different
+// blocks can be executed in parallel
+inline void encrypt4(const __m128i *rk, size_t nrounds, __m128i *blocks) {
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = encrypt_first(blocks[j], rk);
+    }
+    for (size_t i = 1; i < nrounds; i++) {
+        for (size_t j = 0; j < 4; j++) {
+            blocks[j] = encrypt_round(blocks[j], rk[i]);
+        }
+    }
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = encrypt_last(blocks[j], rk[nrounds]);
+    }
+}
+
+inline void decrypt4(const __m128i *rk, size_t nrounds, __m128i *blocks) {
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = decrypt_first(blocks[j], rk);
+    }
+    for (size_t i = 1; i < nrounds; i++) {
+        for (size_t j = 0; j < 4; j++) {
+            blocks[j] = decrypt_round(blocks[j], rk[i]);
+        }
+    }
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = decrypt_last(blocks[j], rk[nrounds]);
+    }
+}
+
+// SubWord() of the key schedule, using the same constant-time S-box
+uint32_t sub_word(uint32_t x) {
+    __m128i io, jo;
+    invert(transform(_mm_cvtsi32_si128(x), k_enc_input), io, jo);
+    __m128i out = _mm_xor_si128(output(k_enc_sbo, io, jo),
+                                _mm_set1_epi8(0x63));
+    return _mm_cvtsi128_si32(out);
+}
+
+inline uint8_t xtime(uint8_t x) {
+    return (x << 1) ^ (0x1b & -(x >> 7));
+}
+
+// Multiplication by a public constant in GF(2^8)
+inline uint8_t mul(uint8_t x, uint8_t m) {
+    uint8_t result = 0;
+    for (; m != 0; m >>= 1) {
+        if (m & 1) {
+            result ^= x;
+        }
+        x = xtime(x);
+    }
+    return result;
+}
+
+// InvMixColumns of a round key, for the equivalent inverse cipher
+__m128i inv_mix_columns(const uint8_t *key) {
+    uint8_t out[16];
+    for (size_t c = 0; c < 4; c++) {
+        const uint8_t *a = key + c * 4;
+        for (size_t r = 0; r < 4; r++) {
+            out[c * 4 + r] = mul(a[r], 14) ^ mul(a[(r + 1) % 4], 11) ^
+                             mul(a[(r + 2) % 4], 13) ^ mul(a[(r + 3) % 4], 9);
+        }
+    }
+    return load_block(out);
+}
+
+}
+
+VPAES::VPAES(const memslice key) {
+    contract_assert(is_valid_key_size(key.size()));
+
+    size_t nk = key.size() / 4;
+    nrounds = nk + 6;
+
+    // Regular key expansion, on little-endian words
+    uint32_t w[60];
+    memcpy(w, key.cptr(), key.size());
+    uint32_t rcon = 0x01;
+    for (size_t i = nk; i < 4 * (nrounds + 1u); i++) {
+        uint32_t tmp = w[i - 1];
+        if (i % nk == 0) {
+            tmp = sub_word((tmp >> 8) | (tmp << 24)) ^ rcon;
+            rcon = (rcon << 1) ^ (0x11b & -(rcon >> 7));
+        } else if (nk > 6 && i % nk == 4) {
+            tmp = sub_word(tmp);
+        }
+        w[i] = w[i - nk] ^ tmp;
+    }
+
+    // Convert the keys of the inner rounds into the tower field basis, and
+    // fold the S-box constant into them.  The constant passes through
+    // MixColumns unchanged, since 2 + 3 + 1 + 1 = 1.
+    __m128i *enc_rk = reinterpret_cast<__m128i *>(enc_round_keys);
+    __m128i *dec_rk = reinterpret_cast<__m128i *>(dec_round_keys);
+    const uint8_t *rk = reinterpret_cast<const uint8_t *>(w);
+    const __m128i sbox_constant = _mm_set1_epi8(0x63);
+
+    enc_rk[0] = load_block(rk);
+    for (size_t i = 1; i < nrounds; i++) {
+        enc_rk[i] = transform(_mm_xor_si128(load_block(rk + i * 16),
+                                            sbox_constant),
+                              k_enc_input);
+    }
+    enc_rk[nrounds] = _mm_xor_si128(load_block(rk + nrounds * 16),
+                                    sbox_constant);
+
+    // For decryption, the constant is a part of the input transformation
+    dec_rk[0] = load_block(rk + nrounds * 16);
+    for (size_t i = 1; i < nrounds; i++) {
+        dec_rk[i] = transform(inv_mix_columns(rk + (nrounds - i) * 16),
+                              k_dec_input);
+    }
+    dec_rk[nrounds] = load_block(rk);
+}
+
+void VPAES::encrypt_block(const uint8_t *plaintext, uint8_t *ciphertext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+    store_block(ciphertext, encrypt(rk, nrounds, load_block(plaintext)));
+}
+
+void VPAES::decrypt_block(const uint8_t *ciphertext, uint8_t *plaintext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(dec_round_keys);
+    store_block(plaintext, decrypt(rk, nrounds, load_block(ciphertext)));
+}
+
+void VPAES::encrypt_blocks(const uint8_t *plaintext, uint8_t *ciphertext,
+                           size_t num_blocks) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+
+    size_t i = 0;
+    for (; i + 4 <= num_blocks; i += 4) {
+        __m128i blocks[4];
+        for (size_t j = 0; j < 4; j++) {
+            blocks[j] = load_block(plaintext + (i + j) * 16);
+        }
+        encrypt4(rk, nrounds, blocks);
+        for (size_t j = 0; j < 4; j++) {
+            store_block(ciphertext + (i + j) * 16, blocks[j]);
+        }
+    }
+    for (; i < num_blocks; i++) {
+        store_block(ciphertext + i * 16,
+                    encrypt(rk, nrounds, load_block(plaintext + i * 16)));
+    }
+}
+
+void VPAES::decrypt_blocks(const uint8_t *ciphertext, uint8_t *plaintext,
+                           size_t num_blocks) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(dec_round_keys);
+
+    size_t i = 0;
+    for (; i + 4 <= num_blocks; i += 4) {
+        __m128i blocks[4];
+        for (size_t j = 0; j < 4; j++) {
+            blocks[j] = load_block(ciphertext + (i + j) * 16);
+        }
+        decrypt4(rk, nrounds, blocks);
+        for (size_t j = 0; j < 4; j++) {
+            store_block(plaintext + (i + j) * 16, blocks[j]);
+        }
+    }
+    for (; i < num_blocks; i++) {
+        store_block(plaintext + i * 16,
+                    decrypt(rk, nrounds, load_block(ciphertext + i * 16)));
+    }
+}
+
+void VPAES::encrypt_cbc(const memslice plaintext, const memslice iv,
+                        memslice ciphertext) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+    contract_assert(iv.size() == 16);
+    contract_assert(plaintext.size() % 16 == 0);
+    contract_assert(ciphertext.size() == plaintext.size());
+    size_t num_blocks = plaintext.size() / 16;
+
+    const uint8_t *in = plaintext.cptr();
+    uint8_t *out = ciphertext.ptr();
+    __m128i chain = load_block(iv.cptr());
+    for (size_t i = 0; i < num_blocks; i++) {
+        chain = _mm_xor_si128(chain, load_block(in + i * 16));
+        chain = encrypt(rk, nrounds, chain);
+        store_block(out + i * 16, chain);
+    }
+}
+
+void VPAES::counter_xor(const memslice iv, const memslice input,
+                        memslice output) const {
+    const __m128i *rk = reinterpret_cast<const __m128i *>(enc_round_keys);
+    contract_assert(iv.size() == 16);
+    contract_assert(output.size() == input.size());
+
+    uint64_t hi, lo;
+    memcpy(&hi, iv.cptr(), 8);
+    memcpy(&lo, iv.cptr() + 8, 8);
+    hi = __builtin_bswap64(hi);
+    lo = __builtin_bswap64(lo);
+
+    const uint8_t *in = input.cptr();
+    uint8_t *out = output.ptr();
+    size_t remaining = input.size();
+    while (remaining > 0) {
+        __m128i blocks[4];
+        for (size_t j = 0; j < 4; j++) {
+            blocks[j] = _mm_set_epi64x(__builtin_bswap64(lo),
+                                       __builtin_bswap64(hi));
+            if (++lo == 0) {
+                hi++;
+            }
+        }
+        encrypt4(rk, nrounds, blocks);
+
+        if (remaining >= 4 * 16) {
+            for (size_t j = 0; j < 4; j++) {
+                store_block(out + j * 16,
+                            _mm_xor_si128(blocks[j], load_block(in + j * 16)));
+            }
+            in += 4 * 16;
+            out += 4 * 16;
+            remaining -= 4 * 16;
+            continue;
+        }
+
+        // Last, partial batch
+        uint8_t keystream[4 * 16];
+        for (size_t j = 0; j < 4; j++) {
+            store_block(keystream + j * 16, blocks[j]);
+        }
+        for (size_t j = 0; j < remaining; j++) {
+            out[j] = in[j] ^ keystream[j];
+        }
+        remaining = 0;
+    }
+}
+
+}
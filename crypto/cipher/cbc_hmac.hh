@@ -0,0 +1,216 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+#ifndef __CRYPTO_CIPHER_CBC_HMAC_HH
+#define __CRYPTO_CIPHER_CBC_HMAC_HH
+
+#include "crypto/cipher.hh"
+#include "crypto/cipher/aes.hh"
+#include "crypto/hash/sha1.hh"
+
+namespace crypto {
+
+/**
+ * Base class for implementations of the record protection used by the TLS
+ * CBC cipher suites with HMAC-SHA1 (RFC 5246, section 6.2.3.2).  The MAC is
+ * computed over |ad| followed by the 16-bit big-endian length of the
+ * plaintext and the plaintext itself.  The plaintext, MAC and padding are
+ * then encrypted together with AES-CBC, so the ciphertext is between 21 and
+ * 36 bytes longer than the plaintext.  For TLS, |ad| is the sequence number,
+ * the content type and the protocol version, and the nonce is the explicit
+ * per-record IV.
+ *
+ * The key is the 20-byte MAC key followed by the AES key, so it is 36 bytes
+ * for AES-128 and 52 bytes for AES-256.
+ *
+ * open() does not leak through its timing how much padding the record had or
+ * whether the padding or the MAC were wrong, so it is not vulnerable to the
+ * padding oracle attacks like Lucky Thirteen.
+ */
+class AESCBCHMACSHA1Base : public AEAD {
+  public:
+    /**
+     * Maximum size of |ad|, which is enough for TLS, and ensures that the
+     * MAC header fits into a single SHA-1 block.
+     */
+    static constexpr size_t max_ad_size = 62;
+
+    virtual ~AESCBCHMACSHA1Base() {};
+
+    virtual const char *get_name() const override {
+        return "AES-CBC-HMAC-SHA1";
+    }
+
+    virtual bool is_valid_key_size(size_t size) const override {
+        return (size == 36) || (size == 52);
+    }
+
+    virtual size_t get_nonce_size() const override {
+        return 16;
+    }
+
+    /**
+     * Returns the size of the MAC.  The ciphertext also contains between 1
+     * and 16 bytes of padding added by seal(), or up to 256 bytes accepted by
+     * open().
+     */
+    virtual size_t get_tag_size() const override {
+        return 20;
+    }
+
+  protected:
+    // SHA-1 states after the key XORed with ipad and opad was processed
+    uint32_t inner_state[5];
+    uint32_t outer_state[5];
+
+    AESCBCHMACSHA1Base(const memslice key);
+
+    /**
+     * Returns whether a ciphertext of size |size| may be a valid record.
+     * Only the size of the ciphertext is checked, which is public.
+     */
+    static bool is_valid_record_size(size_t size);
+
+    /**
+     * Incremental inner hash of the MAC, used where the timing does not
+     * depend on secret lengths.
+     */
+    struct MACState {
+        SHA1State hash;
+
+        // Number of bytes hashed, not counting the key block
+        size_t length;
+
+        /**
+         * Continue from inner hash |state| reached after the key block and
+         * |length| bytes, which have to be a whole number of blocks.
+         */
+        MACState(const uint32_t *state, size_t length);
+
+        /**
+         * Hash the rest of |header| followed by |data|, continuing from the
+         * |length| bytes which have been hashed already.
+         */
+        void update_record(const uint8_t *header, size_t header_len,
+                           const uint8_t *data, size_t data_len);
+    };
+
+    /**
+     * Write |ad| followed by the length of the plaintext into |header|, which
+     * has to hold 64 bytes, and return the size of the header.
+     */
+    static size_t make_header(const memslice ad, size_t data_len,
+                              uint8_t *header);
+
+    /**
+     * Return the 64-byte block |index| of the MAC input, which is |header|
+     * followed by |data|.  The block has to lie within the input.  |buffer|
+     * is used to assemble the first block; the others point into |data|.
+     */
+    static const uint8_t *mac_block(const uint8_t *header, size_t header_len,
+                                    const uint8_t *data, size_t index,
+                                    uint8_t *buffer);
+
+    MACState start_mac() const;
+
+    /**
+     * Pad the inner hash, compute the outer hash, and write the MAC into
+     * |mac|.
+     */
+    void finish_mac(MACState &state, uint8_t *mac) const;
+
+    /**
+     * Determine the length of the data in a record of size |record_len|
+     * which ends with |pad|, and set |good| to all ones if the record is long
+     * enough to hold the padding and the MAC, or to zero otherwise.  In the
+     * latter case, the returned length assumes no padding, so that the rest
+     * of the processing takes the same time.  Runs in constant time.
+     */
+    static size_t record_data_len(size_t record_len, uint8_t pad,
+                                  size_t &good);
+
+    /**
+     * Check in constant time that the last |pad| + 1 bytes of |record| are
+     * all equal to |pad|.  Returns all ones if they are, zero otherwise.
+     */
+    static size_t check_padding(const uint8_t *record, size_t record_len,
+                                uint8_t pad);
+
+    /**
+     * Return the number of the leading blocks of the MAC input which contain
+     * only the header and the data regardless of the padding length.  These
+     * may be hashed normally before the call to finish_open().
+     */
+    static size_t public_mac_blocks(size_t header_len, size_t record_len);
+
+    /**
+     * Finish the MAC check of decrypted |record|.  |state| is the inner hash
+     * state after first |num_hashed| blocks of the MAC input.  The remaining
+     * blocks are hashed, and the MAC compared against the one in the record,
+     * without branches or memory accesses depending on |data_len|.  Returns
+     * true if both the MAC and |good| are valid.
+     */
+    bool finish_open(uint32_t *state, size_t num_hashed,
+                     const uint8_t *header, size_t header_len,
+                     const uint8_t *record, size_t record_len,
+                     size_t data_len, size_t good) const;
+};
+
+typedef std::unique_ptr<AESCBCHMACSHA1Base> AESCBCHMACSHA1Base_u;
+AESCBCHMACSHA1Base_u AES_CBC_HMAC_SHA1(const memslice key);
+
+/**
+ * Portable implementation, which computes the MAC and then encrypts using
+ * whichever AES implementation AES() selects.
+ */
+class AESCBCHMACSHA1Impl : public AESCBCHMACSHA1Base {
+  private:
+    AESBase_u aes;
+
+  public:
+    AESCBCHMACSHA1Impl(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "CBC-HMAC-SHA1 (portable)";
+    }
+
+    virtual void seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext,
+                      bytestring &ciphertext) const override;
+    virtual bool open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext,
+                      bytestring &plaintext) const override;
+};
+
+/**
+ * Implementation using AES-NI, which makes a single pass over the data.  CBC
+ * encryption is serial, so the AES unit is idle most of the time waiting for
+ * the previous block; the SHA-1 rounds of the MAC are interleaved with the AES
+ * rounds to fill these gaps.  The decryption is interleaved with the hashing
+ * of the blocks which do not depend on the padding length.
+ */
+class AESNICBCHMACSHA1 : public AESCBCHMACSHA1Base {
+  private:
+    AESNI aes;
+
+  public:
+    AESNICBCHMACSHA1(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "CBC-HMAC-SHA1 (stitched AES-NI)";
+    }
+
+    virtual void seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext,
+                      bytestring &ciphertext) const override;
+    virtual bool open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext,
+                      bytestring &plaintext) const override;
+};
+
+}
+
+#endif /* __CRYPTO_CIPHER_CBC_HMAC_HH */
@@ -0,0 +1,69 @@
+#include "crypto/cipher/cbc_hmac.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+#include <cstdio>
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_impl(crypto::AEADFactory impl, size_t key_size) {
+    bytestring key(key_size);
+    bytestring nonce(16);
+    bytestring ad(13);
+    bytestring sealed;
+    bytestring output;
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = i;
+    }
+
+    crypto::AEAD_u aead = impl(key.cmem());
+    const char *desc = aead->get_impl_desc();
+    const char *name = key_size == 36 ? "AES-128-CBC-HMAC-SHA1" :
+                                        "AES-256-CBC-HMAC-SHA1";
+    char op[64];
+
+    for (size_t size : { 16, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        snprintf(op, sizeof(op), "%s seal", name);
+        crypto::report_benchmark(
+            desc, op, size,
+            crypto::cycles_per_byte([&]() {
+                aead->seal(nonce.cmem(), ad.cmem(), input.cmem(), sealed);
+            }, size, iterations));
+
+        snprintf(op, sizeof(op), "%s open", name);
+        crypto::report_benchmark(
+            desc, op, size,
+            crypto::cycles_per_byte([&]() {
+                aead->open(nonce.cmem(), ad.cmem(), sealed.cmem(), output);
+            }, size, iterations));
+    }
+}
+
+crypto::AEAD_u portableCBCHMAC(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESCBCHMACSHA1Impl(key));
+}
+
+crypto::AEAD_u aesniCBCHMAC(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESNICBCHMACSHA1(key));
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    for (size_t key_size : { 36, 52 }) {
+        benchmark_impl(portableCBCHMAC, key_size);
+        if (cpu.has_aesni()) {
+            benchmark_impl(aesniCBCHMAC, key_size);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,355 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/cipher/cbc_hmac.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+#include "crypto/hash/sha1.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace crypto {
+
+namespace {
+
+typedef AESCBCHMACSHA1Base *(*CBCHMACConstructor)(const memslice key);
+
+CBCHMACConstructor select_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_aesni()) {
+        return construct<AESCBCHMACSHA1Base, AESNICBCHMACSHA1>;
+    }
+
+    return construct<AESCBCHMACSHA1Base, AESCBCHMACSHA1Impl>;
+}
+
+}
+
+AESCBCHMACSHA1Base_u AES_CBC_HMAC_SHA1(const memslice key) {
+    static const CBCHMACConstructor constructor = select_implementation();
+    return AESCBCHMACSHA1Base_u(constructor(key));
+}
+
+constexpr size_t AESCBCHMACSHA1Base::max_ad_size;
+
+namespace {
+
+const size_t mac_size = 20;
+
+// The padding is at most 255 bytes, plus the byte with its length
+const size_t max_padding = 256;
+
+// The plaintext length is encoded in 16 bits in the MAC header
+const size_t max_data_len = 65535;
+
+inline void store_be32(uint8_t *p, uint32_t x) {
+    p[0] = x >> 24;
+    p[1] = x >> 16;
+    p[2] = x >> 8;
+    p[3] = x;
+}
+
+/*
+ * Constant-time helpers.  All of them return masks, which are either all
+ * ones or all zeros.
+ */
+inline size_t ct_msb(size_t x) {
+    return 0 - (x >> (sizeof(size_t) * 8 - 1));
+}
+
+inline size_t ct_lt(size_t a, size_t b) {
+    return ct_msb(a ^ ((a ^ b) | ((a - b) ^ b)));
+}
+
+inline size_t ct_ge(size_t a, size_t b) {
+    return ~ct_lt(a, b);
+}
+
+inline size_t ct_is_zero(size_t a) {
+    return ct_msb(~a & (a - 1));
+}
+
+inline size_t ct_eq(size_t a, size_t b) {
+    return ct_is_zero(a ^ b);
+}
+
+}
+
+AESCBCHMACSHA1Base::AESCBCHMACSHA1Base(const memslice key) {
+    contract_assert(is_valid_key_size(key.size()));
+
+    uint8_t ipad[64];
+    uint8_t opad[64];
+    for (size_t i = 0; i < 64; i++) {
+        uint8_t byte = i < mac_size ? key.cptr()[i] : 0;
+        ipad[i] = byte ^ 0x36;
+        opad[i] = byte ^ 0x5c;
+    }
+
+    std::copy(sha1_iv, sha1_iv + 5, inner_state);
+    std::copy(sha1_iv, sha1_iv + 5, outer_state);
+    sha1_compress(inner_state, ipad, 1);
+    sha1_compress(outer_state, opad, 1);
+}
+
+AESCBCHMACSHA1Base::MACState::MACState(const uint32_t *state, size_t length)
+    : hash(sha1_compress, state, 64 + length), length(length) {}
+
+void AESCBCHMACSHA1Base::MACState::update_record(const uint8_t *header,
+                                                 size_t header_len,
+                                                 const uint8_t *data,
+                                                 size_t data_len) {
+    size_t offset = length;
+    if (offset < header_len) {
+        hash.update(cmem(header + offset, header_len - offset));
+        offset = header_len;
+    }
+    offset -= header_len;
+    hash.update(cmem(data + offset, data_len - offset));
+    length = header_len + data_len;
+}
+
+bool AESCBCHMACSHA1Base::is_valid_record_size(size_t size) {
+    // The shortest record is an empty plaintext with the MAC and a single
+    // byte of padding
+    return (size % 16 == 0) && (size >= 32) &&
+           (size <= max_data_len + mac_size);
+}
+
+size_t AESCBCHMACSHA1Base::make_header(const memslice ad, size_t data_len,
+                                       uint8_t *header) {
+    contract_assert(ad.size() <= max_ad_size);
+    contract_assert(data_len <= max_data_len);
+
+    memcpy(header, ad.cptr(), ad.size());
+    header[ad.size()] = data_len >> 8;
+    header[ad.size() + 1] = data_len;
+    return ad.size() + 2;
+}
+
+const uint8_t *AESCBCHMACSHA1Base::mac_block(const uint8_t *header,
+                                             size_t header_len,
+                                             const uint8_t *data,
+                                             size_t index, uint8_t *buffer) {
+    if (index > 0) {
+        return data + 64 * index - header_len;
+    }
+
+    memcpy(buffer, header, header_len);
+    memcpy(buffer + header_len, data, 64 - header_len);
+    return buffer;
+}
+
+AESCBCHMACSHA1Base::MACState AESCBCHMACSHA1Base::start_mac() const {
+    return MACState(inner_state, 0);
+}
+
+void AESCBCHMACSHA1Base::finish_mac(MACState &state, uint8_t *mac) const {
+    // The inner hash is the start of the block hashed by the outer one, and
+    // the key block is included in its padded length
+    uint8_t block[64] = { 0 };
+    state.hash.finish(block, 5);
+    block[mac_size] = 0x80;
+    block[62] = ((64 + mac_size) * 8) >> 8;
+    block[63] = ((64 + mac_size) * 8) & 0xff;
+
+    uint32_t h[5];
+    std::copy(outer_state, outer_state + 5, h);
+    sha1_compress(h, block, 1);
+    for (size_t i = 0; i < 5; i++) {
+        store_be32(mac + 4 * i, h[i]);
+    }
+}
+
+size_t AESCBCHMACSHA1Base::record_data_len(size_t record_len, uint8_t pad,
+                                           size_t &good) {
+    size_t overhead = size_t(pad) + 1 + mac_size;
+    good = ct_ge(record_len, overhead);
+    return record_len - mac_size - (good & (size_t(pad) + 1));
+}
+
+size_t AESCBCHMACSHA1Base::check_padding(const uint8_t *record,
+                                         size_t record_len, uint8_t pad) {
+    // Check as many bytes as the longest possible padding, so that the
+    // number of iterations does not depend on |pad|
+    size_t to_check = std::min(max_padding, record_len);
+    size_t good = ~size_t(0);
+
+    for (size_t i = 0; i < to_check; i++) {
+        size_t in_padding = ct_ge(pad, i);
+        good &= ~(in_padding & (record[record_len - 1 - i] ^ pad));
+    }
+
+    return ct_eq(good & 0xff, 0xff);
+}
+
+size_t AESCBCHMACSHA1Base::public_mac_blocks(size_t header_len,
+                                             size_t record_len) {
+    size_t overhead = mac_size + max_padding;
+    size_t min_data_len = record_len > overhead ? record_len - overhead : 0;
+    return (header_len + min_data_len) / 64;
+}
+
+bool AESCBCHMACSHA1Base::finish_open(uint32_t *state, size_t num_hashed,
+                                     const uint8_t *header, size_t header_len,
+                                     const uint8_t *record, size_t record_len,
+                                     size_t data_len, size_t good) const {
+    // Length of the MAC input, and the block which will contain its length
+    // after padding.  If the padding is invalid, |data_len| assumes there is
+    // none, which is the longest possible input, so the loop below covers it
+    // as well.
+    size_t msg_len = header_len + data_len;
+    size_t max_msg_len = header_len + record_len - mac_size;
+    size_t last_block = (msg_len + 8) / 64;
+    uint64_t bit_length = (64 + uint64_t(msg_len)) * 8;
+
+    // Hash every block which may be a part of the padded input, and keep the
+    // state after the one which is actually the last
+    uint32_t inner[5] = { 0 };
+    for (size_t j = num_hashed; j <= (max_msg_len + 8) / 64; j++) {
+        size_t is_last = ct_eq(j, last_block);
+        uint8_t block[64];
+
+        for (size_t i = 0; i < 64; i++) {
+            size_t pos = 64 * j + i;
+            uint8_t byte = 0;
+            if (pos < header_len) {
+                byte = header[pos];
+            } else if (pos - header_len < record_len) {
+                byte = record[pos - header_len];
+            }
+
+            byte &= ct_lt(pos, msg_len);
+            byte |= 0x80 & ct_eq(pos, msg_len);
+            if (i >= 56) {
+                byte |= is_last & (bit_length >> (8 * (63 - i)));
+            }
+            block[i] = byte;
+        }
+
+        sha1_compress(state, block, 1);
+        for (size_t i = 0; i < 5; i++) {
+            inner[i] |= state[i] & uint32_t(is_last);
+        }
+    }
+
+    uint8_t block[64] = { 0 };
+    for (size_t i = 0; i < 5; i++) {
+        store_be32(block + 4 * i, inner[i]);
+    }
+    block[mac_size] = 0x80;
+    block[62] = ((64 + mac_size) * 8) >> 8;
+    block[63] = ((64 + mac_size) * 8) & 0xff;
+
+    uint32_t h[5];
+    uint8_t mac[mac_size];
+    std::copy(outer_state, outer_state + 5, h);
+    sha1_compress(h, block, 1);
+    for (size_t i = 0; i < 5; i++) {
+        store_be32(mac + 4 * i, h[i]);
+    }
+
+    // Copy out the MAC from the record.  Its position is secret, so all
+    // positions where it may start are scanned, and the MAC is collected
+    // rotated by the secret offset modulo its size.  Then it is rotated back
+    // by selecting every byte with a mask.
+    size_t scan_start = record_len > mac_size + max_padding ?
+                        record_len - mac_size - max_padding : 0;
+    uint8_t rotated[mac_size] = { 0 };
+    size_t mac_end = data_len + mac_size;
+    for (size_t i = scan_start, j = 0; i < record_len; i++) {
+        size_t in_mac = ct_ge(i, data_len) & ct_lt(i, mac_end);
+        rotated[j] |= record[i] & in_mac;
+        j = j + 1 < mac_size ? j + 1 : 0;
+    }
+
+    size_t rotate_offset = (data_len - scan_start) % mac_size;
+    size_t diff = 0;
+    for (size_t i = 0; i < mac_size; i++) {
+        size_t source = (rotate_offset + i) % mac_size;
+        uint8_t byte = 0;
+        for (size_t j = 0; j < mac_size; j++) {
+            byte |= rotated[j] & ct_eq(j, source);
+        }
+        diff |= byte ^ mac[i];
+    }
+
+    good &= ct_is_zero(diff);
+    return good != 0;
+}
+
+AESCBCHMACSHA1Impl::AESCBCHMACSHA1Impl(const memslice key)
+    : AESCBCHMACSHA1Base(key),
+      aes(AES(cmem(key.cptr() + mac_size, key.size() - mac_size))) {
+}
+
+void AESCBCHMACSHA1Impl::seal(const memslice nonce, const memslice ad,
+                              const memslice plaintext,
+                              bytestring &ciphertext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+
+    size_t len = plaintext.size();
+    size_t padding_len = 16 - (len + mac_size) % 16;
+    uint8_t header[64];
+    size_t header_len = make_header(ad, len, header);
+
+    MACState mac = start_mac();
+    mac.update_record(header, header_len, plaintext.cptr(), len);
+
+    ciphertext.resize(len + mac_size + padding_len);
+    std::copy(plaintext.cptr(), plaintext.cptr() + len, ciphertext.ptr());
+    finish_mac(mac, ciphertext.ptr() + len);
+    std::fill(ciphertext.ptr() + len + mac_size,
+              ciphertext.ptr() + ciphertext.size(), padding_len - 1);
+
+    aes->encrypt_cbc(ciphertext.cmem(), nonce, ciphertext.mem());
+}
+
+bool AESCBCHMACSHA1Impl::open(const memslice nonce, const memslice ad,
+                              const memslice ciphertext,
+                              bytestring &plaintext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+    plaintext.clear();
+
+    size_t record_len = ciphertext.size();
+    if (!is_valid_record_size(record_len)) {
+        return false;
+    }
+
+    bytestring record(record_len);
+    aes->decrypt_cbc(ciphertext, nonce, record.mem());
+
+    uint8_t pad = record[record_len - 1];
+    size_t good;
+    size_t data_len = record_data_len(record_len, pad, good);
+    good &= check_padding(record.cptr(), record_len, pad);
+
+    uint8_t header[64];
+    size_t header_len = make_header(ad, data_len, header);
+
+    uint32_t state[5];
+    uint8_t buffer[64];
+    std::copy(inner_state, inner_state + 5, state);
+    size_t num_hashed = public_mac_blocks(header_len, record_len);
+    for (size_t i = 0; i < num_hashed; i++) {
+        sha1_compress(state, mac_block(header, header_len, record.cptr(), i,
+                                       buffer), 1);
+    }
+
+    if (!finish_open(state, num_hashed, header, header_len, record.cptr(),
+                     record_len, data_len, good)) {
+        return false;
+    }
+
+    record.resize(data_len);
+    plaintext = std::move(record);
+    return true;
+}
+
+}
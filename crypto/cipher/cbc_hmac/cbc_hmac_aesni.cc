@@ -0,0 +1,347 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Stitched AES-CBC-HMAC-SHA1 using AES-NI, compiled with -maes.
+
+#include "crypto/cipher/cbc_hmac.hh"
+#include "crypto/hash/sha1.hh"
+#include "crypto/hash/sha1/sha1_rounds.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <wmmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+const size_t mac_size = 20;
+
+inline __m128i load_block(const uint8_t *ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+
+inline void store_block(uint8_t *ptr, __m128i block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), block);
+}
+
+/**
+ * SHA-1 compression of a single block, which can be advanced by a few rounds
+ * at a time.  The message schedule is computed on the fly in a rolling window
+ * of 16 words, and W + K is handed to the rounds of sha1_rounds.hh.  The
+ * round number is a template parameter, so that the selection of the round
+ * function and the schedule folds away.
+ */
+struct SHA1Block {
+    uint32_t v[5];
+    uint32_t w[16];
+    uint32_t wk[80];
+
+    inline void start(const uint32_t *state, const uint8_t *block) {
+        for (size_t i = 0; i < 5; i++) {
+            v[i] = state[i];
+        }
+        for (size_t i = 0; i < 16; i++) {
+            const uint8_t *p = block + 4 * i;
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+                   (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+    }
+
+    template <int t>
+    inline void round() {
+        uint32_t wt = w[t & 15];
+        if (t >= 16) {
+            wt = sha1_rol(w[(t + 13) & 15] ^ w[(t + 8) & 15] ^
+                          w[(t + 2) & 15] ^ wt, 1);
+            w[t & 15] = wt;
+        }
+        wk[t] = wt + sha1_k[t / 20];
+        sha1_round<t, 4>(v, wk);
+    }
+
+    template <int t>
+    inline void rounds2() {
+        round<t>();
+        round<t + 1>();
+    }
+
+    template <int t>
+    inline void rounds8() {
+        rounds2<t>();
+        rounds2<t + 2>();
+        rounds2<t + 4>();
+        rounds2<t + 6>();
+    }
+
+    inline void finish(uint32_t *state) const {
+        for (size_t i = 0; i < 5; i++) {
+            state[i] += v[i];
+        }
+    }
+};
+
+/**
+ * Encrypt a single block, and run the SHA-1 rounds from |first| to |first| +
+ * 19 in the shadow of its latency, two after each of the first nine AES
+ * rounds and the last two after the final one.
+ */
+template <int first>
+inline __m128i encrypt_stitched(__m128i block, const __m128i *rk,
+                                size_t nrounds, SHA1Block &sha) {
+    block = _mm_xor_si128(block, rk[0]);
+    block = _mm_aesenc_si128(block, rk[1]);
+    sha.rounds2<first>();
+    block = _mm_aesenc_si128(block, rk[2]);
+    sha.rounds2<first + 2>();
+    block = _mm_aesenc_si128(block, rk[3]);
+    sha.rounds2<first + 4>();
+    block = _mm_aesenc_si128(block, rk[4]);
+    sha.rounds2<first + 6>();
+    block = _mm_aesenc_si128(block, rk[5]);
+    sha.rounds2<first + 8>();
+    block = _mm_aesenc_si128(block, rk[6]);
+    sha.rounds2<first + 10>();
+    block = _mm_aesenc_si128(block, rk[7]);
+    sha.rounds2<first + 12>();
+    block = _mm_aesenc_si128(block, rk[8]);
+    sha.rounds2<first + 14>();
+    block = _mm_aesenc_si128(block, rk[9]);
+    sha.rounds2<first + 16>();
+    for (size_t r = 10; r < nrounds; r++) {
+        block = _mm_aesenc_si128(block, rk[r]);
+    }
+    block = _mm_aesenclast_si128(block, rk[nrounds]);
+    sha.rounds2<first + 18>();
+    return block;
+}
+
+inline void decrypt_round4(__m128i *blocks, __m128i rk) {
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = _mm_aesdec_si128(blocks[j], rk);
+    }
+}
+
+/**
+ * Decrypt four independent blocks, and run all 80 SHA-1 rounds alongside,
+ * eight after each of the first nine AES rounds and the last eight after the
+ * final one.
+ */
+inline void decrypt4_stitched(__m128i *blocks, const __m128i *rk,
+                              size_t nrounds, SHA1Block &sha) {
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = _mm_xor_si128(blocks[j], rk[0]);
+    }
+    decrypt_round4(blocks, rk[1]);
+    sha.rounds8<0>();
+    decrypt_round4(blocks, rk[2]);
+    sha.rounds8<8>();
+    decrypt_round4(blocks, rk[3]);
+    sha.rounds8<16>();
+    decrypt_round4(blocks, rk[4]);
+    sha.rounds8<24>();
+    decrypt_round4(blocks, rk[5]);
+    sha.rounds8<32>();
+    decrypt_round4(blocks, rk[6]);
+    sha.rounds8<40>();
+    decrypt_round4(blocks, rk[7]);
+    sha.rounds8<48>();
+    decrypt_round4(blocks, rk[8]);
+    sha.rounds8<56>();
+    decrypt_round4(blocks, rk[9]);
+    sha.rounds8<64>();
+    for (size_t r = 10; r < nrounds; r++) {
+        decrypt_round4(blocks, rk[r]);
+    }
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = _mm_aesdeclast_si128(blocks[j], rk[nrounds]);
+    }
+    sha.rounds8<72>();
+}
+
+inline void decrypt4(__m128i *blocks, const __m128i *rk, size_t nrounds) {
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = _mm_xor_si128(blocks[j], rk[0]);
+    }
+    for (size_t r = 1; r < nrounds; r++) {
+        decrypt_round4(blocks, rk[r]);
+    }
+    for (size_t j = 0; j < 4; j++) {
+        blocks[j] = _mm_aesdeclast_si128(blocks[j], rk[nrounds]);
+    }
+}
+
+}
+
+AESNICBCHMACSHA1::AESNICBCHMACSHA1(const memslice key)
+    : AESCBCHMACSHA1Base(key),
+      aes(cmem(key.cptr() + mac_size, key.size() - mac_size)) {
+}
+
+void AESNICBCHMACSHA1::seal(const memslice nonce, const memslice ad,
+                            const memslice plaintext,
+                            bytestring &ciphertext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+
+    size_t len = plaintext.size();
+    size_t padding_len = 16 - (len + mac_size) % 16;
+    uint8_t header[64];
+    size_t header_len = make_header(ad, len, header);
+
+    ciphertext.resize(len + mac_size + padding_len);
+    const uint8_t *in = plaintext.cptr();
+    uint8_t *out = ciphertext.ptr();
+
+    const __m128i *rk = reinterpret_cast<const __m128i *>(aes.enc_round_keys);
+    size_t nrounds = aes.nrounds;
+    __m128i chain = load_block(nonce.cptr());
+
+    // Every 64 bytes of plaintext are encrypted while one block of the MAC
+    // input is hashed.  Each CBC block depends on the previous one, so the
+    // 80 SHA-1 rounds are split evenly between the four blocks.  The MAC
+    // input is ahead of the plaintext by the size of the header, so it runs
+    // out later.
+    uint32_t state[5];
+    std::copy(inner_state, inner_state + 5, state);
+    SHA1Block sha;
+    uint8_t buffer[64];
+    size_t num_chunks = len / 64;
+    for (size_t i = 0; i < num_chunks; i++) {
+        sha.start(state, mac_block(header, header_len, plaintext.cptr(), i,
+                                   buffer));
+
+        chain = _mm_xor_si128(load_block(in), chain);
+        chain = encrypt_stitched<0>(chain, rk, nrounds, sha);
+        store_block(out, chain);
+        chain = _mm_xor_si128(load_block(in + 16), chain);
+        chain = encrypt_stitched<20>(chain, rk, nrounds, sha);
+        store_block(out + 16, chain);
+        chain = _mm_xor_si128(load_block(in + 32), chain);
+        chain = encrypt_stitched<40>(chain, rk, nrounds, sha);
+        store_block(out + 32, chain);
+        chain = _mm_xor_si128(load_block(in + 48), chain);
+        chain = encrypt_stitched<60>(chain, rk, nrounds, sha);
+        store_block(out + 48, chain);
+
+        sha.finish(state);
+        in += 64;
+        out += 64;
+    }
+
+    // The rest of the MAC input is hashed separately, and the rest of the
+    // record is assembled in the output and encrypted in place
+    size_t tail_len = len - 64 * num_chunks;
+    MACState mac(state, 64 * num_chunks);
+    mac.update_record(header, header_len, plaintext.cptr(), len);
+    memcpy(out, in, tail_len);
+    finish_mac(mac, out + tail_len);
+    memset(out + tail_len + mac_size, padding_len - 1, padding_len);
+
+    uint8_t iv[16];
+    store_block(iv, chain);
+    size_t rest = tail_len + mac_size + padding_len;
+    aes.encrypt_cbc(cmem(out, rest), cmem(iv, 16), memslice(out, rest));
+}
+
+bool AESNICBCHMACSHA1::open(const memslice nonce, const memslice ad,
+                            const memslice ciphertext,
+                            bytestring &plaintext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+    plaintext.clear();
+
+    size_t record_len = ciphertext.size();
+    if (!is_valid_record_size(record_len)) {
+        return false;
+    }
+
+    const __m128i *rk = reinterpret_cast<const __m128i *>(aes.dec_round_keys);
+    size_t nrounds = aes.nrounds;
+    const uint8_t *in = ciphertext.cptr();
+
+    // The last block is decrypted first, since the length of the padding is
+    // needed for the MAC header, which is hashed together with the data
+    uint8_t last[16];
+    aes.decrypt_block(in + record_len - 16, last);
+    for (size_t i = 0; i < 16; i++) {
+        last[i] ^= in[record_len - 32 + i];
+    }
+    uint8_t pad = last[15];
+    size_t good;
+    size_t data_len = record_data_len(record_len, pad, good);
+
+    uint8_t header[64];
+    size_t header_len = make_header(ad, data_len, header);
+    size_t num_public = public_mac_blocks(header_len, record_len);
+
+    // Four blocks are decrypted in parallel while the previous block of the
+    // MAC input is hashed, as long as it is one of the blocks which do not
+    // depend on the padding
+    bytestring record(record_len);
+    uint8_t *out = record.ptr();
+    uint32_t state[5];
+    std::copy(inner_state, inner_state + 5, state);
+    SHA1Block sha = SHA1Block();
+    uint8_t buffer[64];
+    size_t num_hashed = 0;
+    __m128i chain = load_block(nonce.cptr());
+
+    size_t num_chunks = record_len / 64;
+    for (size_t i = 0; i < num_chunks; i++) {
+        const uint8_t *chunk_in = in + 64 * i;
+        uint8_t *chunk_out = out + 64 * i;
+        bool hash = i > 0 && num_hashed < num_public;
+        if (hash) {
+            sha.start(state, mac_block(header, header_len, out, num_hashed,
+                                       buffer));
+        }
+
+        __m128i blocks[4];
+        for (size_t j = 0; j < 4; j++) {
+            blocks[j] = load_block(chunk_in + 16 * j);
+        }
+        if (hash) {
+            decrypt4_stitched(blocks, rk, nrounds, sha);
+        } else {
+            decrypt4(blocks, rk, nrounds);
+        }
+
+        for (size_t j = 0; j < 4; j++) {
+            store_block(chunk_out + 16 * j, _mm_xor_si128(blocks[j], chain));
+            chain = load_block(chunk_in + 16 * j);
+        }
+
+        if (hash) {
+            sha.finish(state);
+            num_hashed++;
+        }
+    }
+
+    size_t rest = record_len - 64 * num_chunks;
+    if (rest > 0) {
+        uint8_t iv[16];
+        store_block(iv, chain);
+        aes.decrypt_cbc(cmem(in + 64 * num_chunks, rest), cmem(iv, 16),
+                        memslice(out + 64 * num_chunks, rest));
+    }
+    for (; num_hashed < num_public; num_hashed++) {
+        sha1_compress(state, mac_block(header, header_len, out, num_hashed,
+                                       buffer), 1);
+    }
+
+    good &= check_padding(out, record_len, pad);
+    if (!finish_open(state, num_hashed, header, header_len, out, record_len,
+                     data_len, good)) {
+        return false;
+    }
+
+    record.resize(data_len);
+    plaintext = std::move(record);
+    return true;
+}
+
+}
@@ -0,0 +1,249 @@
+#include "gtest/gtest.h"
+
+#include "crypto/cipher/cbc_hmac.hh"
+#include "crypto/cpu.hh"
+#include "crypto/hash.hh"
+#include "crypto/hash/sha1.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include <random>
+
+namespace {
+
+const size_t mac_size = 20;
+
+/**
+ * Build a record the way RFC 5246 describes it, using the generic HMAC and
+ * the reference AES, with |padding_len| bytes of padding not counting the
+ * length byte.
+ */
+crypto::bytestring reference_record(const crypto::bytestring &key,
+                                    const crypto::bytestring &iv,
+                                    const crypto::bytestring &ad,
+                                    const crypto::bytestring &plaintext,
+                                    size_t padding_len) {
+    crypto::bytestring mac_input = ad;
+    mac_input.push_back(plaintext.size() >> 8);
+    mac_input.push_back(plaintext.size() & 0xff);
+    mac_input += plaintext;
+
+    crypto::bytestring mac_key(key.cptr(), mac_size);
+    crypto::HashFunctionFactory sha1 = []() {
+        return crypto::HashFunction_u(crypto::SHA1());
+    };
+    crypto::bytestring_u mac =
+        crypto::hmac(sha1, mac_key.cmem(), mac_input.cmem());
+
+    crypto::bytestring record = plaintext;
+    record += *mac;
+    record.append(padding_len + 1, padding_len);
+
+    crypto::ReferenceAES aes(
+        crypto::cmem(key.cptr() + mac_size, key.size() - mac_size));
+    crypto::bytestring ciphertext;
+    aes.encrypt_cbc(record.cmem(), iv.cmem(), ciphertext);
+    return ciphertext;
+}
+
+/**
+ * Check seal() against the reference construction, and open() on the
+ * result, for all plaintext lengths around the block boundaries of both AES
+ * and SHA-1.
+ */
+void test_against_reference(crypto::AEADFactory impl, size_t key_size) {
+    std::mt19937 rng(key_size);
+    crypto::bytestring key = crypto::random_bytes(rng, key_size);
+    crypto::bytestring iv = crypto::random_bytes(rng, 16);
+    crypto::bytestring ad = crypto::random_bytes(rng, 13);
+    crypto::AEAD_u aead = impl(key.cmem());
+
+    for (size_t len = 0; len < 600; len++) {
+        crypto::bytestring plaintext = crypto::random_bytes(rng, len);
+        size_t padding_len = 15 - (len + mac_size) % 16;
+        crypto::bytestring expected =
+            reference_record(key, iv, ad, plaintext, padding_len);
+
+        crypto::bytestring ciphertext;
+        aead->seal(iv.cmem(), ad.cmem(), plaintext.cmem(), ciphertext);
+        ASSERT_EQ(expected, ciphertext) << "Length " << len;
+
+        crypto::bytestring output;
+        ASSERT_TRUE(aead->open(iv.cmem(), ad.cmem(), ciphertext.cmem(),
+                               output)) << "Length " << len;
+        ASSERT_EQ(plaintext, output) << "Length " << len;
+    }
+}
+
+/**
+ * open() has to accept any valid padding, not just the minimal one which
+ * seal() produces, up to the maximum of 255 bytes.
+ */
+void test_long_padding(crypto::AEADFactory impl) {
+    std::mt19937 rng(1);
+    crypto::bytestring key = crypto::random_bytes(rng, 36);
+    crypto::bytestring iv = crypto::random_bytes(rng, 16);
+    crypto::bytestring ad = crypto::random_bytes(rng, 13);
+    crypto::AEAD_u aead = impl(key.cmem());
+
+    for (size_t len : { 0, 1, 11, 64, 100, 1000, 4096 }) {
+        crypto::bytestring plaintext = crypto::random_bytes(rng, len);
+        size_t min_padding = 15 - (len + mac_size) % 16;
+        for (size_t padding_len = min_padding; padding_len < 256;
+             padding_len += 16) {
+            crypto::bytestring ciphertext =
+                reference_record(key, iv, ad, plaintext, padding_len);
+
+            crypto::bytestring output;
+            ASSERT_TRUE(aead->open(iv.cmem(), ad.cmem(), ciphertext.cmem(),
+                                   output))
+                << "Length " << len << ", padding " << padding_len;
+            ASSERT_EQ(plaintext, output);
+        }
+    }
+}
+
+void test_rejects_forgeries(crypto::AEADFactory impl) {
+    std::mt19937 rng(2);
+    crypto::bytestring key = crypto::random_bytes(rng, 52);
+    crypto::bytestring iv = crypto::random_bytes(rng, 16);
+    crypto::bytestring ad = crypto::random_bytes(rng, 13);
+    crypto::AEAD_u aead = impl(key.cmem());
+    crypto::bytestring output;
+
+    for (size_t len : { 0, 5, 44, 300, 2000 }) {
+        crypto::bytestring plaintext = crypto::random_bytes(rng, len);
+        crypto::bytestring ciphertext;
+        aead->seal(iv.cmem(), ad.cmem(), plaintext.cmem(), ciphertext);
+
+        // Any modified bit breaks either the MAC or the padding
+        for (size_t i = 0; i < ciphertext.size(); i += 7) {
+            crypto::bytestring modified = ciphertext;
+            modified[i] ^= 1 << (i % 8);
+            EXPECT_FALSE(aead->open(iv.cmem(), ad.cmem(), modified.cmem(),
+                                    output)) << "Length " << len;
+            EXPECT_TRUE(output.empty());
+        }
+
+        crypto::bytestring modified_iv = iv;
+        modified_iv[3] ^= 0x40;
+        EXPECT_FALSE(aead->open(modified_iv.cmem(), ad.cmem(),
+                                ciphertext.cmem(), output));
+
+        crypto::bytestring modified_ad = ad;
+        modified_ad[12] ^= 0x01;
+        EXPECT_FALSE(aead->open(iv.cmem(), modified_ad.cmem(),
+                                ciphertext.cmem(), output));
+
+        // Truncated records
+        for (size_t truncated : { 1, 16 }) {
+            size_t size = ciphertext.size() - truncated;
+            EXPECT_FALSE(aead->open(iv.cmem(), ad.cmem(),
+                                    crypto::cmem(ciphertext.cptr(), size),
+                                    output));
+        }
+    }
+
+    // Records with correct MAC but malformed padding
+    crypto::bytestring plaintext = crypto::random_bytes(rng, 50);
+    crypto::bytestring valid = reference_record(key, iv, ad, plaintext, 9);
+    ASSERT_TRUE(aead->open(iv.cmem(), ad.cmem(), valid.cmem(), output));
+
+    crypto::bytestring mac_input = ad;
+    mac_input.push_back(0);
+    mac_input.push_back(50);
+    mac_input += plaintext;
+    crypto::HashFunctionFactory sha1 = []() {
+        return crypto::HashFunction_u(crypto::SHA1());
+    };
+    crypto::bytestring_u mac = crypto::hmac(
+        sha1, crypto::cmem(key.cptr(), mac_size), mac_input.cmem());
+    crypto::ReferenceAES aes(crypto::cmem(key.cptr() + mac_size, 32));
+
+    for (size_t i = 0; i < 10; i++) {
+        crypto::bytestring record = plaintext + *mac;
+        record.append(10, 9);
+        record[50 + mac_size + i] ^= 0x80;
+
+        crypto::bytestring ciphertext;
+        aes.encrypt_cbc(record.cmem(), iv.cmem(), ciphertext);
+        EXPECT_FALSE(aead->open(iv.cmem(), ad.cmem(), ciphertext.cmem(),
+                                output)) << "Padding byte " << i;
+    }
+
+    // Padding longer than the record
+    crypto::bytestring record;
+    record.assign(32, 0xff);
+    crypto::bytestring ciphertext;
+    aes.encrypt_cbc(record.cmem(), iv.cmem(), ciphertext);
+    EXPECT_FALSE(aead->open(iv.cmem(), ad.cmem(), ciphertext.cmem(), output));
+
+    // Sizes which cannot be valid at all
+    for (size_t size : { 0, 16, 31, 33, 47 }) {
+        crypto::bytestring junk(size);
+        EXPECT_FALSE(aead->open(iv.cmem(), ad.cmem(), junk.cmem(), output));
+    }
+}
+
+crypto::AEAD_u portableCBCHMAC(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESCBCHMACSHA1Impl(key));
+}
+
+crypto::AEAD_u aesniCBCHMAC(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESNICBCHMACSHA1(key));
+}
+
+crypto::AEAD_u defaultCBCHMAC(const crypto::memslice key) {
+    return crypto::AEAD_u(crypto::AES_CBC_HMAC_SHA1(key));
+}
+
+}
+
+TEST(AESCBCHMACSHA1Impl, Reference) {
+    test_against_reference(portableCBCHMAC, 36);
+    test_against_reference(portableCBCHMAC, 52);
+}
+
+TEST(AESCBCHMACSHA1Impl, LongPadding) {
+    test_long_padding(portableCBCHMAC);
+}
+
+TEST(AESCBCHMACSHA1Impl, Forgeries) {
+    test_rejects_forgeries(portableCBCHMAC);
+}
+
+TEST(AESNICBCHMACSHA1, Reference) {
+    crypto::CPU cpu;
+    if (!cpu.has_aesni()) {
+        return;
+    }
+
+    test_against_reference(aesniCBCHMAC, 36);
+    test_against_reference(aesniCBCHMAC, 52);
+}
+
+TEST(AESNICBCHMACSHA1, LongPadding) {
+    crypto::CPU cpu;
+    if (!cpu.has_aesni()) {
+        return;
+    }
+
+    test_long_padding(aesniCBCHMAC);
+}
+
+TEST(AESNICBCHMACSHA1, Forgeries) {
+    crypto::CPU cpu;
+    if (!cpu.has_aesni()) {
+        return;
+    }
+
+    test_rejects_forgeries(aesniCBCHMAC);
+}
+
+TEST(CBCHMACInterface, ImplSelection) {
+    test_against_reference(defaultCBCHMAC, 36);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,193 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+#ifndef __CRYPTO_CIPHER_CHACHA20_HH
+#define __CRYPTO_CIPHER_CHACHA20_HH
+
+#include "crypto/cipher.hh"
+
+namespace crypto {
+
+/**
+ * Base class for implementations of the ChaCha20 stream cipher, as specified
+ * in RFC 8439, with a 256-bit key, a 96-bit nonce (passed as the IV) and a
+ * 32-bit block counter starting at zero.
+ *
+ * The implementations only provide the kernel which XORs whole blocks with
+ * the keystream; the base class keeps track of the position in the stream.
+ */
+class ChaCha20Base : public StreamCipher {
+  private:
+    uint32_t state[16];
+
+    // Keystream of the last partial block which has not been used yet
+    uint8_t leftover[64];
+    size_t leftover_len;
+
+  protected:
+    ChaCha20Base(const memslice key, const memslice nonce);
+
+    /**
+     * Portable kernel, one block at a time.  The vectorized implementations
+     * use it for a single block, which is all the AEAD needs for its MAC key.
+     */
+    static void xor_blocks_generic(const uint32_t *state, const uint8_t *input,
+                                   uint8_t *output, size_t num_blocks);
+
+  public:
+    virtual ~ChaCha20Base() {};
+
+    virtual const char *get_name() const override {
+        return "ChaCha20";
+    }
+
+    virtual bool is_valid_key_size(size_t size) const override {
+        return size == 32;
+    }
+
+    static size_t get_nonce_size() {
+        return 12;
+    }
+
+    /**
+     * Fill |state| with the input block for |key|, |nonce| and the block
+     * |counter|.
+     */
+    static void init_state(const memslice key, const memslice nonce,
+                           uint32_t counter, uint32_t *state);
+
+    /**
+     * XOR |num_blocks| 64-byte blocks of |input| with the keystream starting
+     * at the input block |state|, and put the result into |output|, which may
+     * point to the same memory.  The block counter is incremented for every
+     * block, but |state| itself is not modified.
+     */
+    virtual void xor_blocks(const uint32_t *state, const uint8_t *input,
+                            uint8_t *output, size_t num_blocks) const = 0;
+
+    /**
+     * XOR |len| bytes of |input| with the keystream starting at |state|, and
+     * advance the block counter in |state| past the blocks used.  The
+     * keystream of the last partial block is discarded.
+     */
+    void counter_xor(uint32_t *state, const uint8_t *input, uint8_t *output,
+                     size_t len) const;
+
+    virtual void xor_to(const memslice input, memslice output) override;
+};
+
+typedef std::unique_ptr<ChaCha20Base> ChaCha20Base_u;
+ChaCha20Base_u ChaCha20(const memslice key, const memslice nonce);
+
+/**
+ * Portable implementation, one block at a time.
+ */
+class ChaCha20Impl : public ChaCha20Base {
+  public:
+    ChaCha20Impl(const memslice key, const memslice nonce)
+        : ChaCha20Base(key, nonce) {}
+
+    virtual const char *get_impl_desc() const override {
+        return "ChaCha20 (portable)";
+    }
+
+    virtual void xor_blocks(const uint32_t *state, const uint8_t *input,
+                            uint8_t *output, size_t num_blocks) const override {
+        xor_blocks_generic(state, input, output, num_blocks);
+    }
+};
+
+/**
+ * SSE2 implementation which computes four blocks at once, each word of the
+ * state in a separate register with one block per lane.
+ */
+class ChaCha20SSE2 : public ChaCha20Base {
+  public:
+    ChaCha20SSE2(const memslice key, const memslice nonce)
+        : ChaCha20Base(key, nonce) {}
+
+    virtual const char *get_impl_desc() const override {
+        return "ChaCha20 (SSE2, 4 blocks)";
+    }
+
+    virtual void xor_blocks(const uint32_t *state, const uint8_t *input,
+                            uint8_t *output, size_t num_blocks) const override;
+};
+
+/**
+ * AVX2 implementation which computes eight blocks at once in the same layout
+ * as the SSE2 one.
+ */
+class ChaCha20AVX2 : public ChaCha20Base {
+  public:
+    ChaCha20AVX2(const memslice key, const memslice nonce)
+        : ChaCha20Base(key, nonce) {}
+
+    virtual const char *get_impl_desc() const override {
+        return "ChaCha20 (AVX2, 8 blocks)";
+    }
+
+    virtual void xor_blocks(const uint32_t *state, const uint8_t *input,
+                            uint8_t *output, size_t num_blocks) const override;
+};
+
+/**
+ * The ChaCha20-Poly1305 AEAD from RFC 8439, as used by TLS.  The Poly1305 key
+ * is taken from the first keystream block, and the data is encrypted with the
+ * following ones.  The ChaCha20 kernel is the one ChaCha20() selects.
+ */
+class ChaCha20Poly1305 : public AEAD {
+  private:
+    uint8_t key[32];
+    ChaCha20Base_u chacha;
+
+    void compute_tag(const uint32_t *state, const memslice ad,
+                     const uint8_t *ciphertext, size_t len,
+                     uint8_t *tag) const;
+
+  public:
+    ChaCha20Poly1305(const memslice key);
+
+    /**
+     * Use the kernel of |chacha| instead of the one ChaCha20() selects.  Only
+     * its implementation matters, not its key or position in the stream.
+     */
+    ChaCha20Poly1305(const memslice key, ChaCha20Base_u chacha);
+
+    virtual const char *get_name() const override {
+        return "ChaCha20-Poly1305";
+    }
+
+    virtual const char *get_impl_desc() const override {
+        return chacha->get_impl_desc();
+    }
+
+    virtual bool is_valid_key_size(size_t size) const override {
+        return size == 32;
+    }
+
+    virtual size_t get_nonce_size() const override {
+        return 12;
+    }
+
+    virtual size_t get_tag_size() const override {
+        return 16;
+    }
+
+    virtual void seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext,
+                      bytestring &ciphertext) const override;
+    virtual bool open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext,
+                      bytestring &plaintext) const override;
+};
+
+typedef std::unique_ptr<ChaCha20Poly1305> ChaCha20Poly1305_u;
+ChaCha20Poly1305_u ChaCha20_Poly1305(const memslice key);
+
+}
+
+#endif /* __CRYPTO_CIPHER_CHACHA20_HH */
@@ -0,0 +1,78 @@
+#include "crypto/cipher/chacha20.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_stream(crypto::ChaCha20Base_u chacha) {
+    const char *desc = chacha->get_impl_desc();
+
+    for (size_t size : { 64, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            desc, "ChaCha20 stream", size,
+            crypto::cycles_per_byte([&]() {
+                chacha->stream_xor(input.mem());
+            }, size, iterations));
+    }
+}
+
+void benchmark_aead(crypto::ChaCha20Base_u chacha, const bytestring &key) {
+    crypto::ChaCha20Poly1305 aead(key.cmem(), std::move(chacha));
+    const char *desc = aead.get_impl_desc();
+    bytestring nonce(12);
+    bytestring ad(13);
+    bytestring sealed;
+    bytestring output;
+
+    for (size_t size : { 16, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            desc, "ChaCha20-Poly1305 seal", size,
+            crypto::cycles_per_byte([&]() {
+                aead.seal(nonce.cmem(), ad.cmem(), input.cmem(), sealed);
+            }, size, iterations));
+
+        crypto::report_benchmark(
+            desc, "ChaCha20-Poly1305 open", size,
+            crypto::cycles_per_byte([&]() {
+                aead.open(nonce.cmem(), ad.cmem(), sealed.cmem(), output);
+            }, size, iterations));
+    }
+}
+
+template <class Impl>
+void benchmark_impl(const bytestring &key, const bytestring &nonce) {
+    benchmark_stream(crypto::ChaCha20Base_u(new Impl(key.cmem(),
+                                                     nonce.cmem())));
+    benchmark_aead(crypto::ChaCha20Base_u(new Impl(key.cmem(), nonce.cmem())),
+                   key);
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+    bytestring key(32);
+    bytestring nonce(12);
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = i;
+    }
+
+    benchmark_impl<crypto::ChaCha20Impl>(key, nonce);
+    if (cpu.has_sse2()) {
+        benchmark_impl<crypto::ChaCha20SSE2>(key, nonce);
+    }
+    if (cpu.has_avx2()) {
+        benchmark_impl<crypto::ChaCha20AVX2>(key, nonce);
+    }
+
+    return 0;
+}
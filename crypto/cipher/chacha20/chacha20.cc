@@ -0,0 +1,274 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/cipher/chacha20.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+#include "crypto/hash/poly1305.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace crypto {
+
+namespace {
+
+typedef ChaCha20Base *(*ChaCha20Constructor)(const memslice key,
+                                             const memslice nonce);
+
+ChaCha20Constructor select_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_avx2()) {
+        return construct<ChaCha20Base, ChaCha20AVX2>;
+    }
+    if (cpu.has_sse2()) {
+        return construct<ChaCha20Base, ChaCha20SSE2>;
+    }
+
+    return construct<ChaCha20Base, ChaCha20Impl>;
+}
+
+}
+
+ChaCha20Base_u ChaCha20(const memslice key, const memslice nonce) {
+    static const ChaCha20Constructor constructor = select_implementation();
+    return ChaCha20Base_u(constructor(key, nonce));
+}
+
+ChaCha20Poly1305_u ChaCha20_Poly1305(const memslice key) {
+    return ChaCha20Poly1305_u(new ChaCha20Poly1305(key));
+}
+
+namespace {
+
+inline uint32_t load_le32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+           (uint32_t(p[3]) << 24);
+}
+
+inline void store_le32(uint8_t *p, uint32_t x) {
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+inline void store_le64(uint8_t *p, uint64_t x) {
+    store_le32(p, x);
+    store_le32(p + 4, x >> 32);
+}
+
+// The AEAD only uses the kernel of its ChaCha20 object, not its stream
+const uint8_t zero_nonce[12] = { 0 };
+
+inline uint32_t rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+inline void quarter_round(uint32_t *x, size_t a, size_t b, size_t c,
+                          size_t d) {
+    x[a] += x[b]; x[d] = rol(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = rol(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = rol(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = rol(x[b] ^ x[c], 7);
+}
+
+}
+
+ChaCha20Base::ChaCha20Base(const memslice key, const memslice nonce) {
+    contract_assert(is_valid_key_size(key.size()));
+    contract_assert(nonce.size() == get_nonce_size());
+
+    init_state(key, nonce, 0, state);
+    leftover_len = 0;
+}
+
+void ChaCha20Base::init_state(const memslice key, const memslice nonce,
+                              uint32_t counter, uint32_t *state) {
+    // "expand 32-byte k"
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (size_t i = 0; i < 8; i++) {
+        state[4 + i] = load_le32(key.cptr() + 4 * i);
+    }
+    state[12] = counter;
+    for (size_t i = 0; i < 3; i++) {
+        state[13 + i] = load_le32(nonce.cptr() + 4 * i);
+    }
+}
+
+void ChaCha20Base::counter_xor(uint32_t *state, const uint8_t *input,
+                               uint8_t *output, size_t len) const {
+    size_t num_blocks = len / 64;
+    if (num_blocks > 0) {
+        xor_blocks(state, input, output, num_blocks);
+        state[12] += num_blocks;
+    }
+
+    size_t tail = len % 64;
+    if (tail > 0) {
+        uint8_t block[64] = { 0 };
+        memcpy(block, input + len - tail, tail);
+        xor_blocks(state, block, block, 1);
+        memcpy(output + len - tail, block, tail);
+        state[12]++;
+    }
+}
+
+void ChaCha20Base::xor_to(const memslice input, memslice output) {
+    contract_assert(output.size() == input.size());
+
+    const uint8_t *in = input.cptr();
+    uint8_t *out = output.ptr();
+    size_t len = input.size();
+
+    // Use up the keystream left from the previous call first
+    size_t used = std::min(len, leftover_len);
+    const uint8_t *keystream = leftover + 64 - leftover_len;
+    for (size_t i = 0; i < used; i++) {
+        out[i] = in[i] ^ keystream[i];
+    }
+    in += used;
+    out += used;
+    len -= used;
+    leftover_len -= used;
+
+    size_t num_blocks = len / 64;
+    if (num_blocks > 0) {
+        xor_blocks(state, in, out, num_blocks);
+        state[12] += num_blocks;
+        in += 64 * num_blocks;
+        out += 64 * num_blocks;
+        len %= 64;
+    }
+
+    if (len > 0) {
+        std::fill(leftover, leftover + 64, 0);
+        xor_blocks(state, leftover, leftover, 1);
+        state[12]++;
+        for (size_t i = 0; i < len; i++) {
+            out[i] = in[i] ^ leftover[i];
+        }
+        leftover_len = 64 - len;
+    }
+}
+
+void ChaCha20Base::xor_blocks_generic(const uint32_t *state,
+                                      const uint8_t *input, uint8_t *output,
+                                      size_t num_blocks) {
+    uint32_t counter = state[12];
+
+    for (size_t i = 0; i < num_blocks; i++) {
+        uint32_t x[16];
+        std::copy(state, state + 16, x);
+        x[12] = counter;
+
+        for (size_t round = 0; round < 10; round++) {
+            quarter_round(x, 0, 4, 8, 12);
+            quarter_round(x, 1, 5, 9, 13);
+            quarter_round(x, 2, 6, 10, 14);
+            quarter_round(x, 3, 7, 11, 15);
+            quarter_round(x, 0, 5, 10, 15);
+            quarter_round(x, 1, 6, 11, 12);
+            quarter_round(x, 2, 7, 8, 13);
+            quarter_round(x, 3, 4, 9, 14);
+        }
+
+        for (size_t j = 0; j < 16; j++) {
+            uint32_t word = x[j] + (j == 12 ? counter : state[j]);
+            store_le32(output + 4 * j, load_le32(input + 4 * j) ^ word);
+        }
+
+        counter++;
+        input += 64;
+        output += 64;
+    }
+}
+
+ChaCha20Poly1305::ChaCha20Poly1305(const memslice key)
+    : ChaCha20Poly1305(key, ChaCha20(key, cmem(zero_nonce, 12))) {
+}
+
+ChaCha20Poly1305::ChaCha20Poly1305(const memslice key, ChaCha20Base_u chacha)
+    : chacha(std::move(chacha)) {
+    contract_assert(is_valid_key_size(key.size()));
+    memcpy(this->key, key.cptr(), 32);
+}
+
+void ChaCha20Poly1305::compute_tag(const uint32_t *state, const memslice ad,
+                                   const uint8_t *ciphertext, size_t len,
+                                   uint8_t *tag) const {
+    // The one-time key is the beginning of the first keystream block
+    uint8_t mac_key[64] = { 0 };
+    chacha->xor_blocks(state, mac_key, mac_key, 1);
+    Poly1305Native mac(cmem(mac_key, 32));
+
+    const uint8_t zeros[16] = { 0 };
+    mac.update(ad);
+    mac.update(cmem(zeros, (16 - ad.size() % 16) % 16));
+    mac.update(cmem(ciphertext, len));
+    mac.update(cmem(zeros, (16 - len % 16) % 16));
+
+    uint8_t lengths[16];
+    store_le64(lengths, ad.size());
+    store_le64(lengths + 8, len);
+    mac.update(cmem(lengths, 16));
+    mac.finish(tag);
+}
+
+void ChaCha20Poly1305::seal(const memslice nonce, const memslice ad,
+                            const memslice plaintext,
+                            bytestring &ciphertext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+
+    size_t len = plaintext.size();
+    ciphertext.resize(len + 16);
+
+    uint32_t state[16];
+    ChaCha20Base::init_state(cmem(key, 32), nonce, 1, state);
+    chacha->counter_xor(state, plaintext.cptr(), ciphertext.ptr(), len);
+
+    state[12] = 0;
+    compute_tag(state, ad, ciphertext.cptr(), len, ciphertext.ptr() + len);
+}
+
+bool ChaCha20Poly1305::open(const memslice nonce, const memslice ad,
+                            const memslice ciphertext,
+                            bytestring &plaintext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+    plaintext.clear();
+
+    if (ciphertext.size() < 16) {
+        return false;
+    }
+    size_t len = ciphertext.size() - 16;
+
+    uint32_t state[16];
+    uint8_t tag[16];
+    ChaCha20Base::init_state(cmem(key, 32), nonce, 0, state);
+    compute_tag(state, ad, ciphertext.cptr(), len, tag);
+
+    // Compare the tags in constant time
+    const uint8_t *expected_tag = ciphertext.cptr() + len;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 16; i++) {
+        diff |= tag[i] ^ expected_tag[i];
+    }
+    if (diff != 0) {
+        return false;
+    }
+
+    plaintext.resize(len);
+    state[12] = 1;
+    chacha->counter_xor(state, ciphertext.cptr(), plaintext.ptr(), len);
+    return true;
+}
+
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Eight-way ChaCha20 using AVX2, compiled with -mavx2.
+//
+// The layout is the same as in the SSE2 version, with blocks 0-3 in the low
+// 128-bit lanes and blocks 4-7 in the high ones.  The rotations by 16 and 8
+// bits are byte shuffles.
+
+#include "crypto/cipher/chacha20.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+template <int n>
+inline __m256i rol(__m256i x) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, n),
+                           _mm256_srli_epi32(x, 32 - n));
+}
+
+inline void quarter_round(__m256i &a, __m256i &b, __m256i &c, __m256i &d,
+                          __m256i rol16, __m256i rol8) {
+    a = _mm256_add_epi32(a, b);
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rol16);
+    c = _mm256_add_epi32(c, d);
+    b = rol<12>(_mm256_xor_si256(b, c));
+    a = _mm256_add_epi32(a, b);
+    d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rol8);
+    c = _mm256_add_epi32(c, d);
+    b = rol<7>(_mm256_xor_si256(b, c));
+}
+
+/**
+ * Transpose four words of four blocks within each 128-bit lane, as in the
+ * SSE2 version.
+ */
+inline void transpose(__m256i &a, __m256i &b, __m256i &c, __m256i &d) {
+    __m256i t0 = _mm256_unpacklo_epi32(a, b);
+    __m256i t1 = _mm256_unpacklo_epi32(c, d);
+    __m256i t2 = _mm256_unpackhi_epi32(a, b);
+    __m256i t3 = _mm256_unpackhi_epi32(c, d);
+    a = _mm256_unpacklo_epi64(t0, t1);
+    b = _mm256_unpackhi_epi64(t0, t1);
+    c = _mm256_unpacklo_epi64(t2, t3);
+    d = _mm256_unpackhi_epi64(t2, t3);
+}
+
+inline void xor_store(const uint8_t *input, uint8_t *output, __m256i x) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(output),
+                        _mm256_xor_si256(in, x));
+}
+
+/**
+ * Compute eight consecutive keystream blocks starting at |state| with the
+ * block counter |counter|, and XOR them with 512 bytes of |input|.
+ */
+void xor_8blocks(const uint32_t *state, uint32_t counter,
+                 const uint8_t *input, uint8_t *output) {
+    const __m256i rol16 = _mm256_set_epi8(
+        13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+        13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+    const __m256i rol8 = _mm256_set_epi8(
+        14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+        14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+
+    __m256i initial[16];
+    for (size_t i = 0; i < 16; i++) {
+        initial[i] = _mm256_set1_epi32(state[i]);
+    }
+    initial[12] = _mm256_add_epi32(_mm256_set1_epi32(counter),
+                                   _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+    __m256i x[16];
+    for (size_t i = 0; i < 16; i++) {
+        x[i] = initial[i];
+    }
+
+    for (size_t round = 0; round < 10; round++) {
+        quarter_round(x[0], x[4], x[8], x[12], rol16, rol8);
+        quarter_round(x[1], x[5], x[9], x[13], rol16, rol8);
+        quarter_round(x[2], x[6], x[10], x[14], rol16, rol8);
+        quarter_round(x[3], x[7], x[11], x[15], rol16, rol8);
+        quarter_round(x[0], x[5], x[10], x[15], rol16, rol8);
+        quarter_round(x[1], x[6], x[11], x[12], rol16, rol8);
+        quarter_round(x[2], x[7], x[8], x[13], rol16, rol8);
+        quarter_round(x[3], x[4], x[9], x[14], rol16, rol8);
+    }
+
+    for (size_t i = 0; i < 16; i++) {
+        x[i] = _mm256_add_epi32(x[i], initial[i]);
+    }
+    for (size_t i = 0; i < 16; i += 4) {
+        transpose(x[i], x[i + 1], x[i + 2], x[i + 3]);
+    }
+
+    // Register i + j now holds words i..i+3 of blocks j and j + 4, so each
+    // half of a block is put together from two registers
+    for (size_t j = 0; j < 4; j++) {
+        const uint8_t *in_lo = input + 64 * j;
+        const uint8_t *in_hi = input + 64 * (j + 4);
+        uint8_t *out_lo = output + 64 * j;
+        uint8_t *out_hi = output + 64 * (j + 4);
+
+        xor_store(in_lo, out_lo,
+                  _mm256_permute2x128_si256(x[j], x[4 + j], 0x20));
+        xor_store(in_lo + 32, out_lo + 32,
+                  _mm256_permute2x128_si256(x[8 + j], x[12 + j], 0x20));
+        xor_store(in_hi, out_hi,
+                  _mm256_permute2x128_si256(x[j], x[4 + j], 0x31));
+        xor_store(in_hi + 32, out_hi + 32,
+                  _mm256_permute2x128_si256(x[8 + j], x[12 + j], 0x31));
+    }
+}
+
+}
+
+void ChaCha20AVX2::xor_blocks(const uint32_t *state, const uint8_t *input,
+                              uint8_t *output, size_t num_blocks) const {
+    uint32_t counter = state[12];
+
+    for (; num_blocks >= 8; num_blocks -= 8) {
+        xor_8blocks(state, counter, input, output);
+        counter += 8;
+        input += 512;
+        output += 512;
+    }
+
+    // A single block is cheaper in scalar code, and otherwise the last
+    // blocks are computed in a buffer and only the ones needed are used
+    if (num_blocks == 1) {
+        uint32_t last[16];
+        std::copy(state, state + 16, last);
+        last[12] = counter;
+        xor_blocks_generic(last, input, output, 1);
+    } else if (num_blocks > 0) {
+        uint8_t buffer[512] = { 0 };
+        memcpy(buffer, input, 64 * num_blocks);
+        xor_8blocks(state, counter, buffer, buffer);
+        memcpy(output, buffer, 64 * num_blocks);
+    }
+}
+
+}
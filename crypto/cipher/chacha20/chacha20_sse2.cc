@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Four-way ChaCha20 using SSE2.  Register x[i] holds word i of the state of
+// four consecutive blocks, one per 32-bit lane, so that the rounds are the
+// same as in the scalar code.  SSE2 has no byte shuffle and no rotation, so
+// all the rotations are done with two shifts.
+
+#include "crypto/cipher/chacha20.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <emmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+template <int n>
+inline __m128i rol(__m128i x) {
+    return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+inline void quarter_round(__m128i &a, __m128i &b, __m128i &c, __m128i &d) {
+    a = _mm_add_epi32(a, b); d = rol<16>(_mm_xor_si128(d, a));
+    c = _mm_add_epi32(c, d); b = rol<12>(_mm_xor_si128(b, c));
+    a = _mm_add_epi32(a, b); d = rol<8>(_mm_xor_si128(d, a));
+    c = _mm_add_epi32(c, d); b = rol<7>(_mm_xor_si128(b, c));
+}
+
+/**
+ * Turn four registers holding word i..i+3 of four blocks into four registers
+ * holding words i..i+3 of a single block each.
+ */
+inline void transpose(__m128i &a, __m128i &b, __m128i &c, __m128i &d) {
+    __m128i t0 = _mm_unpacklo_epi32(a, b);
+    __m128i t1 = _mm_unpacklo_epi32(c, d);
+    __m128i t2 = _mm_unpackhi_epi32(a, b);
+    __m128i t3 = _mm_unpackhi_epi32(c, d);
+    a = _mm_unpacklo_epi64(t0, t1);
+    b = _mm_unpackhi_epi64(t0, t1);
+    c = _mm_unpacklo_epi64(t2, t3);
+    d = _mm_unpackhi_epi64(t2, t3);
+}
+
+inline void xor_store(const uint8_t *input, uint8_t *output, __m128i x) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output),
+                     _mm_xor_si128(in, x));
+}
+
+/**
+ * Compute four consecutive keystream blocks starting at |state| with the
+ * block counter |counter|, and XOR them with 256 bytes of |input|.
+ */
+void xor_4blocks(const uint32_t *state, uint32_t counter,
+                 const uint8_t *input, uint8_t *output) {
+    __m128i initial[16];
+    for (size_t i = 0; i < 16; i++) {
+        initial[i] = _mm_set1_epi32(state[i]);
+    }
+    initial[12] = _mm_add_epi32(_mm_set1_epi32(counter),
+                                _mm_set_epi32(3, 2, 1, 0));
+
+    __m128i x[16];
+    for (size_t i = 0; i < 16; i++) {
+        x[i] = initial[i];
+    }
+
+    for (size_t round = 0; round < 10; round++) {
+        quarter_round(x[0], x[4], x[8], x[12]);
+        quarter_round(x[1], x[5], x[9], x[13]);
+        quarter_round(x[2], x[6], x[10], x[14]);
+        quarter_round(x[3], x[7], x[11], x[15]);
+        quarter_round(x[0], x[5], x[10], x[15]);
+        quarter_round(x[1], x[6], x[11], x[12]);
+        quarter_round(x[2], x[7], x[8], x[13]);
+        quarter_round(x[3], x[4], x[9], x[14]);
+    }
+
+    for (size_t i = 0; i < 16; i++) {
+        x[i] = _mm_add_epi32(x[i], initial[i]);
+    }
+
+    // After the transposition of each group of four words, register j of the
+    // group holds those words of block j
+    for (size_t i = 0; i < 16; i += 4) {
+        transpose(x[i], x[i + 1], x[i + 2], x[i + 3]);
+        for (size_t j = 0; j < 4; j++) {
+            xor_store(input + 64 * j + 4 * i, output + 64 * j + 4 * i,
+                      x[i + j]);
+        }
+    }
+}
+
+}
+
+void ChaCha20SSE2::xor_blocks(const uint32_t *state, const uint8_t *input,
+                              uint8_t *output, size_t num_blocks) const {
+    uint32_t counter = state[12];
+
+    for (; num_blocks >= 4; num_blocks -= 4) {
+        xor_4blocks(state, counter, input, output);
+        counter += 4;
+        input += 256;
+        output += 256;
+    }
+
+    // A single block is cheaper in scalar code, and otherwise the last
+    // blocks are computed in a buffer and only the ones needed are used
+    if (num_blocks == 1) {
+        uint32_t last[16];
+        std::copy(state, state + 16, last);
+        last[12] = counter;
+        xor_blocks_generic(last, input, output, 1);
+    } else if (num_blocks > 0) {
+        uint8_t buffer[256] = { 0 };
+        memcpy(buffer, input, 64 * num_blocks);
+        xor_4blocks(state, counter, buffer, buffer);
+        memcpy(output, buffer, 64 * num_blocks);
+    }
+}
+
+}
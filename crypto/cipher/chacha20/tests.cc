@@ -0,0 +1,284 @@
+#include "gtest/gtest.h"
+
+#include "crypto/cipher/chacha20.hh"
+#include "crypto/cpu.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include <random>
+
+namespace {
+
+template <class Impl>
+crypto::ChaCha20Base_u make_chacha(const crypto::memslice key,
+                                   const crypto::memslice nonce) {
+    return crypto::ChaCha20Base_u(new Impl(key, nonce));
+}
+
+typedef crypto::ChaCha20Base_u (*ChaCha20Factory)(const crypto::memslice,
+                                                  const crypto::memslice);
+
+// All the kernels the CPU can run
+std::vector<ChaCha20Factory> implementations() {
+    crypto::CPU cpu;
+    std::vector<ChaCha20Factory> result{ make_chacha<crypto::ChaCha20Impl> };
+    if (cpu.has_sse2()) {
+        result.push_back(make_chacha<crypto::ChaCha20SSE2>);
+    }
+    if (cpu.has_avx2()) {
+        result.push_back(make_chacha<crypto::ChaCha20AVX2>);
+    }
+    return result;
+}
+
+const char *sunscreen =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one "
+    "tip for the future, sunscreen would be it.";
+
+}
+
+// RFC 8439, appendix A.1, test vector 1
+TEST(ChaCha20, KeystreamVector) {
+    crypto::bytestring key(32);
+    crypto::bytestring nonce(12);
+    crypto::bytestring expected = crypto::bytestring::from_hex(
+        "76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+        "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586"
+        "9f07e7be5551387a98ba977c732d080dcb0f29a048e3656912c6533e32ee7aed"
+        "29b721769ce64e43d57133b074d839d531ed1f28510afb45ace10a1f4b794d6f");
+
+    for (ChaCha20Factory impl : implementations()) {
+        crypto::ChaCha20Base_u chacha = impl(key.cmem(), nonce.cmem());
+        crypto::bytestring stream(expected.size());
+        chacha->stream_xor(stream.mem());
+        EXPECT_EQ(expected, stream) << chacha->get_impl_desc();
+    }
+}
+
+// RFC 8439, section 2.4.2, which starts at block counter 1
+TEST(ChaCha20, SunscreenVector) {
+    crypto::bytestring key = crypto::bytestring::from_hex(
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    crypto::bytestring nonce =
+        crypto::bytestring::from_hex("000000000000004a00000000");
+    crypto::bytestring plaintext(
+        reinterpret_cast<const uint8_t *>(sunscreen), strlen(sunscreen));
+    crypto::bytestring expected = crypto::bytestring::from_hex(
+        "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b"
+        "f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8"
+        "07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+        "5af90bbf74a35be6b40b8eedf2785e42874d");
+
+    for (ChaCha20Factory impl : implementations()) {
+        crypto::ChaCha20Base_u chacha = impl(key.cmem(), nonce.cmem());
+        uint32_t state[16];
+        crypto::ChaCha20Base::init_state(key.cmem(), nonce.cmem(), 1, state);
+
+        crypto::bytestring ciphertext(plaintext.size());
+        chacha->counter_xor(state, plaintext.cptr(), ciphertext.ptr(),
+                            plaintext.size());
+        EXPECT_EQ(expected, ciphertext) << chacha->get_impl_desc();
+        EXPECT_EQ(3u, state[12]);
+    }
+}
+
+// The vectorized kernels must produce the same keystream as the portable one
+// for any number of blocks, and in place
+TEST(ChaCha20, ImplementationsCompat) {
+    std::mt19937 rng(20);
+    crypto::bytestring key = crypto::random_bytes(rng, 32);
+    crypto::bytestring nonce = crypto::random_bytes(rng, 12);
+    crypto::ChaCha20Impl reference(key.cmem(), nonce.cmem());
+
+    uint32_t state[16];
+    crypto::ChaCha20Base::init_state(key.cmem(), nonce.cmem(), 0, state);
+
+    for (size_t num_blocks = 0; num_blocks <= 20; num_blocks++) {
+        crypto::bytestring input = crypto::random_bytes(rng, 64 * num_blocks);
+        crypto::bytestring expected(input.size());
+        reference.xor_blocks(state, input.cptr(), expected.ptr(), num_blocks);
+
+        for (ChaCha20Factory impl : implementations()) {
+            crypto::ChaCha20Base_u chacha = impl(key.cmem(), nonce.cmem());
+            crypto::bytestring output = input;
+            chacha->xor_blocks(state, output.cptr(), output.ptr(),
+                               num_blocks);
+            EXPECT_EQ(expected, output)
+                << chacha->get_impl_desc() << ", " << num_blocks << " blocks";
+        }
+    }
+}
+
+// The block counter wraps around to zero after 2^32 blocks
+TEST(ChaCha20, CounterWraps) {
+    std::mt19937 rng(32);
+    crypto::bytestring key = crypto::random_bytes(rng, 32);
+    crypto::bytestring nonce = crypto::random_bytes(rng, 12);
+    crypto::ChaCha20Impl reference(key.cmem(), nonce.cmem());
+
+    uint32_t state[16];
+    crypto::ChaCha20Base::init_state(key.cmem(), nonce.cmem(), 0xfffffffe,
+                                     state);
+    crypto::bytestring expected(64 * 9);
+    reference.xor_blocks(state, expected.cptr(), expected.ptr(), 2);
+    state[12] = 0;
+    reference.xor_blocks(state, expected.cptr() + 128, expected.ptr() + 128,
+                         7);
+
+    for (ChaCha20Factory impl : implementations()) {
+        crypto::ChaCha20Base_u chacha = impl(key.cmem(), nonce.cmem());
+        crypto::ChaCha20Base::init_state(key.cmem(), nonce.cmem(), 0xfffffffe,
+                                         state);
+        crypto::bytestring output(64 * 9);
+        chacha->xor_blocks(state, output.cptr(), output.ptr(), 9);
+        EXPECT_EQ(expected, output) << chacha->get_impl_desc();
+    }
+}
+
+// Splitting the stream into calls of any size must not change the output,
+// and neither may writing it to a separate buffer
+TEST(ChaCha20, StreamChunks) {
+    std::mt19937 rng(8439);
+    crypto::bytestring key = crypto::random_bytes(rng, 32);
+    crypto::bytestring nonce = crypto::random_bytes(rng, 12);
+    crypto::bytestring input = crypto::random_bytes(rng, 1500);
+
+    crypto::bytestring expected = input;
+    crypto::ChaCha20Impl(key.cmem(), nonce.cmem()).stream_xor(expected.mem());
+
+    std::uniform_int_distribution<size_t> chunk_sizes(0, 300);
+    for (ChaCha20Factory impl : implementations()) {
+        crypto::ChaCha20Base_u chacha = impl(key.cmem(), nonce.cmem());
+        crypto::bytestring output = input;
+        for (size_t i = 0; i < output.size();) {
+            size_t len = std::min(chunk_sizes(rng), output.size() - i);
+            chacha->stream_xor(crypto::memslice(output.ptr() + i, len));
+            i += len;
+        }
+        EXPECT_EQ(expected, output) << chacha->get_impl_desc();
+
+        chacha = impl(key.cmem(), nonce.cmem());
+        output.assign(input.size(), 0);
+        for (size_t i = 0; i < output.size();) {
+            size_t len = std::min(chunk_sizes(rng), output.size() - i);
+            chacha->xor_to(crypto::cmem(input.cptr() + i, len),
+                           crypto::memslice(output.ptr() + i, len));
+            i += len;
+        }
+        EXPECT_EQ(expected, output) << chacha->get_impl_desc();
+    }
+}
+
+// RFC 8439, section 2.8.2
+TEST(ChaCha20Poly1305, RFCVector) {
+    crypto::bytestring key = crypto::bytestring::from_hex(
+        "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f");
+    crypto::bytestring nonce =
+        crypto::bytestring::from_hex("070000004041424344454647");
+    crypto::bytestring ad =
+        crypto::bytestring::from_hex("50515253c0c1c2c3c4c5c6c7");
+    crypto::bytestring plaintext(
+        reinterpret_cast<const uint8_t *>(sunscreen), strlen(sunscreen));
+    crypto::bytestring expected = crypto::bytestring::from_hex(
+        "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+        "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+        "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+        "3ff4def08e4b7a9de576d26586cec64b6116"
+        "1ae10b594f09e26a7e902ecbd0600691");
+
+    for (ChaCha20Factory impl : implementations()) {
+        crypto::ChaCha20Poly1305 aead(key.cmem(),
+                                      impl(key.cmem(), nonce.cmem()));
+        crypto::bytestring ciphertext;
+        aead.seal(nonce.cmem(), ad.cmem(), plaintext.cmem(), ciphertext);
+        EXPECT_EQ(expected, ciphertext) << aead.get_impl_desc();
+
+        crypto::bytestring output;
+        EXPECT_TRUE(aead.open(nonce.cmem(), ad.cmem(), ciphertext.cmem(),
+                              output));
+        EXPECT_EQ(plaintext, output);
+    }
+}
+
+TEST(ChaCha20Poly1305, EmptyMessage) {
+    crypto::bytestring key = crypto::bytestring::from_hex(
+        "1c9240a5eb55d38af333888604f6b5f0473917c1402b80099dca5cbc207075c0");
+    crypto::bytestring nonce =
+        crypto::bytestring::from_hex("000000000102030405060708");
+    crypto::bytestring expected =
+        crypto::bytestring::from_hex("11f42c5c33f24b70d45e8126aec859be");
+
+    crypto::ChaCha20Poly1305_u aead = crypto::ChaCha20_Poly1305(key.cmem());
+    crypto::bytestring ciphertext;
+    aead->seal(nonce.cmem(), crypto::bytestring().cmem(),
+               crypto::bytestring().cmem(), ciphertext);
+    EXPECT_EQ(expected, ciphertext);
+}
+
+// Any modified bit of the ciphertext, tag or additional data is rejected,
+// and so is a truncated input
+TEST(ChaCha20Poly1305, Forgeries) {
+    std::mt19937 rng(1305);
+    crypto::bytestring key = crypto::random_bytes(rng, 32);
+    crypto::bytestring nonce = crypto::random_bytes(rng, 12);
+    crypto::bytestring ad = crypto::random_bytes(rng, 13);
+    crypto::bytestring plaintext = crypto::random_bytes(rng, 70);
+
+    crypto::ChaCha20Poly1305_u aead = crypto::ChaCha20_Poly1305(key.cmem());
+    crypto::bytestring ciphertext;
+    aead->seal(nonce.cmem(), ad.cmem(), plaintext.cmem(), ciphertext);
+
+    crypto::bytestring output;
+    for (size_t i = 0; i < ciphertext.size(); i++) {
+        crypto::bytestring forged = ciphertext;
+        forged[i] ^= 1 << (i % 8);
+        EXPECT_FALSE(aead->open(nonce.cmem(), ad.cmem(), forged.cmem(),
+                                output)) << "Byte " << i;
+        EXPECT_TRUE(output.empty());
+    }
+    for (size_t i = 0; i < ad.size(); i++) {
+        crypto::bytestring forged = ad;
+        forged[i] ^= 0x80;
+        EXPECT_FALSE(aead->open(nonce.cmem(), forged.cmem(),
+                                ciphertext.cmem(), output));
+    }
+    EXPECT_FALSE(aead->open(nonce.cmem(), ad.cmem(),
+                            crypto::cmem(ciphertext.cptr(), 15), output));
+}
+
+// Seal with one kernel and open with another, for lengths around the block
+// boundaries of the vectorized kernels
+TEST(ChaCha20Poly1305, ImplementationsCompat) {
+    std::mt19937 rng(8);
+    crypto::bytestring key = crypto::random_bytes(rng, 32);
+    crypto::bytestring nonce = crypto::random_bytes(rng, 12);
+    std::vector<ChaCha20Factory> impls = implementations();
+
+    for (size_t len = 0; len < 1100; len += 7) {
+        crypto::bytestring ad = crypto::random_bytes(rng, len % 40);
+        crypto::bytestring plaintext = crypto::random_bytes(rng, len);
+
+        crypto::ChaCha20Poly1305 reference(key.cmem(),
+                                           impls[0](key.cmem(), nonce.cmem()));
+        crypto::bytestring expected;
+        reference.seal(nonce.cmem(), ad.cmem(), plaintext.cmem(), expected);
+
+        for (ChaCha20Factory impl : impls) {
+            crypto::ChaCha20Poly1305 aead(key.cmem(),
+                                          impl(key.cmem(), nonce.cmem()));
+            crypto::bytestring ciphertext;
+            aead.seal(nonce.cmem(), ad.cmem(), plaintext.cmem(), ciphertext);
+            EXPECT_EQ(expected, ciphertext)
+                << aead.get_impl_desc() << ", length " << len;
+
+            crypto::bytestring output;
+            EXPECT_TRUE(reference.open(nonce.cmem(), ad.cmem(),
+                                       ciphertext.cmem(), output));
+            EXPECT_EQ(plaintext, output);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+#ifndef __CRYPTO_CIPHER_GCM_HH
+#define __CRYPTO_CIPHER_GCM_HH
+
+#include "crypto/cipher.hh"
+#include "crypto/cipher/aes.hh"
+
+namespace crypto {
+
+/**
+ * Base class for implementations of AES in Galois/Counter Mode, as specified
+ * in NIST SP 800-38D.  Only 96-bit nonces and full 128-bit tags are
+ * supported, since that is what TLS uses.
+ */
+class AESGCMBase : public AEAD {
+  public:
+    virtual ~AESGCMBase() {};
+
+    virtual const char *get_name() const override {
+        return "AES-GCM";
+    }
+
+    virtual bool is_valid_key_size(size_t size) const override {
+        return (size == 16) || (size == 32);
+    }
+
+    virtual size_t get_nonce_size() const override {
+        return 12;
+    }
+
+    virtual size_t get_tag_size() const override {
+        return 16;
+    }
+};
+
+typedef std::unique_ptr<AESGCMBase> AESGCMBase_u;
+AESGCMBase_u AES_GCM(const memslice key);
+
+/**
+ * Portable implementation of GCM on top of whichever AES implementation AES()
+ * selects.  GHASH is computed by emulating carry-less multiplication with
+ * integer multiplications of sparse operands, so it does not use any lookup
+ * tables and runs in constant time.
+ */
+class AESGCMImpl : public AESGCMBase {
+  private:
+    AESBase_u aes;
+
+    // The hash key H, most significant half first
+    uint64_t h_hi;
+    uint64_t h_lo;
+
+    void ghash(uint64_t *y, const memslice data) const;
+    void compute_tag(const uint8_t *j0, const memslice ad,
+                     const memslice ciphertext, uint8_t *tag) const;
+    void ctr_xor(const uint8_t *j0, const uint8_t *input, uint8_t *output,
+                 size_t len) const;
+
+  public:
+    AESGCMImpl(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "GCM (constant-time portable GHASH)";
+    }
+
+    virtual void seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext,
+                      bytestring &ciphertext) const override;
+    virtual bool open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext,
+                      bytestring &plaintext) const override;
+};
+
+/**
+ * GCM implementation using AES-NI, PCLMULQDQ and SSSE3.  The bulk of the
+ * data is processed eight blocks at a time: GHASH multiplications are
+ * interleaved with AES rounds so that both execution units are busy, and all
+ * eight products are reduced modulo the GCM polynomial at once using
+ * precomputed powers of H.
+ */
+class AESNIGCM : public AESGCMBase {
+  private:
+    AESNI aes;
+
+    // H^1 ... H^8 in the byte-reflected form used by the PCLMULQDQ code, and
+    // XOR of the upper and lower halves of each, used for Karatsuba
+    // multiplication.
+    alignas(16) uint8_t h_powers[8 * 16];
+    alignas(16) uint8_t h_karatsuba[8 * 16];
+
+  public:
+    AESNIGCM(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "GCM (AES-NI + PCLMULQDQ)";
+    }
+
+    virtual void seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext,
+                      bytestring &ciphertext) const override;
+    virtual bool open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext,
+                      bytestring &plaintext) const override;
+};
+
+}
+
+#endif /* __CRYPTO_CIPHER_GCM_HH */
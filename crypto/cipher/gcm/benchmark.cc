@@ -0,0 +1,68 @@
+#include "crypto/cipher/gcm.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+#include <cstdio>
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_impl(crypto::AEADFactory impl, size_t key_size) {
+    bytestring key(key_size);
+    bytestring nonce(12);
+    bytestring ad(13);
+    bytestring sealed;
+    bytestring output;
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = i;
+    }
+
+    crypto::AEAD_u gcm = impl(key.cmem());
+    const char *desc = gcm->get_impl_desc();
+    const char *name = key_size == 16 ? "AES-128-GCM" : "AES-256-GCM";
+    char op[64];
+
+    for (size_t size : { 16, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        snprintf(op, sizeof(op), "%s seal", name);
+        crypto::report_benchmark(
+            desc, op, size,
+            crypto::cycles_per_byte([&]() {
+                gcm->seal(nonce.cmem(), ad.cmem(), input.cmem(), sealed);
+            }, size, iterations));
+
+        snprintf(op, sizeof(op), "%s open", name);
+        crypto::report_benchmark(
+            desc, op, size,
+            crypto::cycles_per_byte([&]() {
+                gcm->open(nonce.cmem(), ad.cmem(), sealed.cmem(), output);
+            }, size, iterations));
+    }
+}
+
+crypto::AEAD_u portableGCM(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESGCMImpl(key));
+}
+
+crypto::AEAD_u aesniGCM(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESNIGCM(key));
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    for (size_t key_size : { 16, 32 }) {
+        benchmark_impl(portableGCM, key_size);
+        if (cpu.has_aesni() && cpu.has_pclmulqdq() && cpu.has_ssse3()) {
+            benchmark_impl(aesniGCM, key_size);
+        }
+    }
+
+    return 0;
+}
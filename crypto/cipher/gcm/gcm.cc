@@ -0,0 +1,254 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/cipher/gcm.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+
+#include <algorithm>
+
+namespace crypto {
+
+namespace {
+
+typedef AESGCMBase *(*GCMConstructor)(const memslice key);
+
+GCMConstructor select_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_aesni() && cpu.has_pclmulqdq() && cpu.has_ssse3()) {
+        return construct<AESGCMBase, AESNIGCM>;
+    }
+
+    return construct<AESGCMBase, AESGCMImpl>;
+}
+
+}
+
+AESGCMBase_u AES_GCM(const memslice key) {
+    static const GCMConstructor constructor = select_implementation();
+    return AESGCMBase_u(constructor(key));
+}
+
+namespace {
+
+inline uint64_t load_be64(const uint8_t *p) {
+    return (uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) |
+           (uint64_t(p[2]) << 40) | (uint64_t(p[3]) << 32) |
+           (uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) |
+           (uint64_t(p[6]) << 8) | uint64_t(p[7]);
+}
+
+inline void store_be64(uint8_t *p, uint64_t x) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = x & 0xff;
+        x >>= 8;
+    }
+}
+
+inline uint64_t rev64(uint64_t x) {
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+    x = ((x & 0x0f0f0f0f0f0f0f0fULL) << 4) | ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL);
+    return __builtin_bswap64(x);
+}
+
+/**
+ * Lower 64 bits of the carry-less product of |x| and |y|.  The operands are
+ * split into four sparse parts in which only every fourth bit is set, so that
+ * the carries of the integer multiplications land in the bits which are
+ * masked out afterwards.  This is the "ctmul64" technique from BearSSL.
+ */
+inline uint64_t bmul64(uint64_t x, uint64_t y) {
+    const uint64_t m0 = 0x1111111111111111ULL;
+    const uint64_t m1 = 0x2222222222222222ULL;
+    const uint64_t m2 = 0x4444444444444444ULL;
+    const uint64_t m3 = 0x8888888888888888ULL;
+
+    uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+
+    uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+
+    return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+/**
+ * Compute y = y * h in GF(2^128) as defined by GCM.  The high half of the
+ * product is obtained by multiplying bit-reversed operands.
+ */
+inline void gf128_mul(uint64_t *y, uint64_t h_hi, uint64_t h_lo) {
+    uint64_t y1 = y[0], y0 = y[1];
+    uint64_t h1 = h_hi, h0 = h_lo;
+    uint64_t h2 = h0 ^ h1;
+    uint64_t h0r = rev64(h0), h1r = rev64(h1), h2r = h0r ^ h1r;
+    uint64_t y2 = y0 ^ y1;
+    uint64_t y0r = rev64(y0), y1r = rev64(y1), y2r = y0r ^ y1r;
+
+    // Karatsuba multiplication
+    uint64_t z0 = bmul64(y0, h0);
+    uint64_t z1 = bmul64(y1, h1);
+    uint64_t z2 = bmul64(y2, h2);
+    uint64_t z0h = bmul64(y0r, h0r);
+    uint64_t z1h = bmul64(y1r, h1r);
+    uint64_t z2h = bmul64(y2r, h2r);
+    z2 ^= z0 ^ z1;
+    z2h ^= z0h ^ z1h;
+    z0h = rev64(z0h) >> 1;
+    z1h = rev64(z1h) >> 1;
+    z2h = rev64(z2h) >> 1;
+
+    uint64_t v0 = z0;
+    uint64_t v1 = z0h ^ z2;
+    uint64_t v2 = z1 ^ z2h;
+    uint64_t v3 = z1h;
+
+    // GCM uses the reflected bit order, so the product has to be shifted by
+    // one bit before the reduction
+    v3 = (v3 << 1) | (v2 >> 63);
+    v2 = (v2 << 1) | (v1 >> 63);
+    v1 = (v1 << 1) | (v0 >> 63);
+    v0 = (v0 << 1);
+
+    // Reduce modulo x^128 + x^7 + x^2 + x + 1
+    v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+    v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+    v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+    v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+    y[0] = v3;
+    y[1] = v2;
+}
+
+inline void inc32(uint8_t *counter) {
+    for (size_t i = 16; i > 12; i--) {
+        if (++counter[i - 1] != 0) {
+            break;
+        }
+    }
+}
+
+}
+
+AESGCMImpl::AESGCMImpl(const memslice key) : aes(AES(key)) {
+    uint8_t h[16] = { 0 };
+    aes->encrypt_block(h, h);
+    h_hi = load_be64(h);
+    h_lo = load_be64(h + 8);
+}
+
+void AESGCMImpl::ghash(uint64_t *y, const memslice data) const {
+    const uint8_t *p = data.cptr();
+    size_t len = data.size();
+
+    while (len > 0) {
+        uint8_t block[16] = { 0 };
+        size_t block_len = std::min(len, size_t(16));
+        memcpy(block, p, block_len);
+
+        y[0] ^= load_be64(block);
+        y[1] ^= load_be64(block + 8);
+        gf128_mul(y, h_hi, h_lo);
+
+        p += block_len;
+        len -= block_len;
+    }
+}
+
+void AESGCMImpl::compute_tag(const uint8_t *j0, const memslice ad,
+                             const memslice ciphertext, uint8_t *tag) const {
+    uint64_t y[2] = { 0, 0 };
+    ghash(y, ad);
+    ghash(y, ciphertext);
+
+    y[0] ^= uint64_t(ad.size()) * 8;
+    y[1] ^= uint64_t(ciphertext.size()) * 8;
+    gf128_mul(y, h_hi, h_lo);
+
+    aes->encrypt_block(j0, tag);
+    uint8_t s[16];
+    store_be64(s, y[0]);
+    store_be64(s + 8, y[1]);
+    for (size_t i = 0; i < 16; i++) {
+        tag[i] ^= s[i];
+    }
+}
+
+void AESGCMImpl::ctr_xor(const uint8_t *j0, const uint8_t *input,
+                         uint8_t *output, size_t len) const {
+    uint8_t counter[16];
+    uint8_t counters[8 * 16];
+    uint8_t keystream[8 * 16];
+    memcpy(counter, j0, 16);
+
+    // Hand the counter blocks to the cipher eight at a time, so that
+    // implementations which encrypt several blocks in parallel can do so
+    for (size_t offset = 0; offset < len; offset += 8 * 16) {
+        size_t batch_len = std::min(len - offset, size_t(8 * 16));
+        size_t batch = (batch_len + 15) / 16;
+        for (size_t i = 0; i < batch; i++) {
+            inc32(counter);
+            memcpy(counters + i * 16, counter, 16);
+        }
+        aes->encrypt_blocks(counters, keystream, batch);
+
+        for (size_t j = 0; j < batch_len; j++) {
+            output[offset + j] = input[offset + j] ^ keystream[j];
+        }
+    }
+}
+
+void AESGCMImpl::seal(const memslice nonce, const memslice ad,
+                      const memslice plaintext, bytestring &ciphertext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+
+    uint8_t j0[16] = { 0 };
+    memcpy(j0, nonce.cptr(), 12);
+    j0[15] = 1;
+
+    size_t len = plaintext.size();
+    ciphertext.resize(len + 16);
+    ctr_xor(j0, plaintext.cptr(), ciphertext.ptr(), len);
+    compute_tag(j0, ad, cmem(ciphertext.cptr(), len), ciphertext.ptr() + len);
+}
+
+bool AESGCMImpl::open(const memslice nonce, const memslice ad,
+                      const memslice ciphertext, bytestring &plaintext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+    plaintext.clear();
+
+    if (ciphertext.size() < 16) {
+        return false;
+    }
+    size_t len = ciphertext.size() - 16;
+
+    uint8_t j0[16] = { 0 };
+    memcpy(j0, nonce.cptr(), 12);
+    j0[15] = 1;
+
+    uint8_t tag[16];
+    compute_tag(j0, ad, cmem(ciphertext.cptr(), len), tag);
+
+    // Compare the tags in constant time
+    const uint8_t *expected_tag = ciphertext.cptr() + len;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 16; i++) {
+        diff |= tag[i] ^ expected_tag[i];
+    }
+    if (diff != 0) {
+        return false;
+    }
+
+    plaintext.resize(len);
+    ctr_xor(j0, ciphertext.cptr(), plaintext.ptr(), len);
+    return true;
+}
+
+}
@@ -0,0 +1,403 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// AES-GCM using AES-NI and PCLMULQDQ, compiled with -maes -mpclmul -mssse3;
+// SSSE3 provides pshufb for the byte reflection of GHASH.
+//
+// GHASH is computed in the byte-reflected representation described in the
+// Intel white paper "Intel Carry-Less Multiplication Instruction and its
+// Usage for Computing the GCM Mode": every block is byte-swapped before the
+// multiplication, and the 256-bit product is shifted left by one bit before
+// it is reduced.
+
+#include "crypto/cipher/gcm.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+inline __m128i load_block(const uint8_t *ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+
+inline void store_block(uint8_t *ptr, __m128i block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), block);
+}
+
+inline __m128i byte_swap(__m128i x) {
+    const __m128i mask =
+        _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(x, mask);
+}
+
+/**
+ * Add the product |a| * |h| to the unreduced 256-bit accumulator, using
+ * Karatsuba multiplication.  |hk| holds XOR of the halves of |h| in its lower
+ * half.
+ */
+inline void clmul_accumulate(__m128i a, __m128i h, __m128i hk, __m128i &lo,
+                             __m128i &mid, __m128i &hi) {
+    __m128i ak = _mm_xor_si128(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+    lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, h, 0x00));
+    hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, h, 0x11));
+    mid = _mm_xor_si128(mid, _mm_clmulepi64_si128(ak, hk, 0x00));
+}
+
+/**
+ * Reduce the accumulated 256-bit product modulo the GCM polynomial.
+ */
+inline __m128i reduce(__m128i lo, __m128i mid, __m128i hi) {
+    // Finish Karatsuba multiplication
+    mid = _mm_xor_si128(mid, _mm_xor_si128(lo, hi));
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    // Shift [hi:lo] left by one bit
+    __m128i t7 = _mm_srli_epi32(lo, 31);
+    __m128i t8 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    __m128i t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    lo = _mm_or_si128(lo, t7);
+    hi = _mm_or_si128(hi, _mm_or_si128(t8, t9));
+
+    // First phase of the reduction
+    t7 = _mm_slli_epi32(lo, 31);
+    t8 = _mm_slli_epi32(lo, 30);
+    t9 = _mm_slli_epi32(lo, 25);
+    t7 = _mm_xor_si128(t7, _mm_xor_si128(t8, t9));
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    lo = _mm_xor_si128(lo, t7);
+
+    // Second phase of the reduction
+    __m128i t2 = _mm_srli_epi32(lo, 1);
+    __m128i t4 = _mm_srli_epi32(lo, 2);
+    __m128i t5 = _mm_srli_epi32(lo, 7);
+    t2 = _mm_xor_si128(_mm_xor_si128(t2, t4), _mm_xor_si128(t5, t8));
+    lo = _mm_xor_si128(lo, t2);
+    return _mm_xor_si128(hi, lo);
+}
+
+inline __m128i karatsuba_key(__m128i h) {
+    return _mm_xor_si128(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+inline __m128i gfmul(__m128i a, __m128i h, __m128i hk) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i mid = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    clmul_accumulate(a, h, hk, lo, mid, hi);
+    return reduce(lo, mid, hi);
+}
+
+/**
+ * The state shared by the encryption and decryption routines.
+ */
+struct GCMContext {
+    const __m128i *rk;
+    size_t nrounds;
+    const __m128i *h;
+    const __m128i *hk;
+
+    // Counter in the byte-reflected form, so that the 32-bit counter field
+    // is in the lowest lane and can be incremented with a single addition
+    __m128i counter;
+    // GHASH accumulator, byte-reflected
+    __m128i y;
+
+    inline __m128i next_counter() {
+        counter = _mm_add_epi32(counter, _mm_set_epi32(0, 0, 0, 1));
+        return byte_swap(counter);
+    }
+
+    inline __m128i encrypt(__m128i block) const {
+        block = _mm_xor_si128(block, rk[0]);
+        for (size_t i = 1; i < nrounds; i++) {
+            block = _mm_aesenc_si128(block, rk[i]);
+        }
+        return _mm_aesenclast_si128(block, rk[nrounds]);
+    }
+
+    // Hash a single (possibly partial) block
+    inline void ghash_block(const uint8_t *data, size_t len) {
+        uint8_t buffer[16] = { 0 };
+        memcpy(buffer, data, len);
+        y = gfmul(_mm_xor_si128(y, byte_swap(load_block(buffer))), h[0],
+                  hk[0]);
+    }
+
+    // Hash eight consecutive blocks, reducing only once
+    inline void ghash8(const uint8_t *data) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i mid = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (size_t j = 0; j < 8; j++) {
+            __m128i block = byte_swap(load_block(data + j * 16));
+            if (j == 0) {
+                block = _mm_xor_si128(block, y);
+            }
+            clmul_accumulate(block, h[7 - j], hk[7 - j], lo, mid, hi);
+        }
+        y = reduce(lo, mid, hi);
+    }
+
+    void ghash(const uint8_t *data, size_t len) {
+        while (len >= 8 * 16) {
+            ghash8(data);
+            data += 8 * 16;
+            len -= 8 * 16;
+        }
+        while (len > 0) {
+            size_t block_len = len < 16 ? len : 16;
+            ghash_block(data, block_len);
+            data += block_len;
+            len -= block_len;
+        }
+    }
+
+    // CTR-encrypt the tail (fewer than eight blocks) of the message.  If
+    // |hash_output| is set, the output is hashed, otherwise the input is.
+    void ctr_tail(const uint8_t *in, uint8_t *out, size_t len,
+                  bool hash_output) {
+        while (len > 0) {
+            size_t block_len = len < 16 ? len : 16;
+            uint8_t keystream[16];
+            store_block(keystream, encrypt(next_counter()));
+            if (!hash_output) {
+                ghash_block(in, block_len);
+            }
+            for (size_t j = 0; j < block_len; j++) {
+                out[j] = in[j] ^ keystream[j];
+            }
+            if (hash_output) {
+                ghash_block(out, block_len);
+            }
+            in += block_len;
+            out += block_len;
+            len -= block_len;
+        }
+    }
+
+    void finish(size_t ad_len, size_t ct_len, __m128i j0, uint8_t *tag) {
+        __m128i lengths = _mm_set_epi64x(uint64_t(ad_len) * 8,
+                                         uint64_t(ct_len) * 8);
+        y = gfmul(_mm_xor_si128(y, lengths), h[0], hk[0]);
+        store_block(tag, _mm_xor_si128(byte_swap(y), encrypt(j0)));
+    }
+};
+
+}
+
+AESNIGCM::AESNIGCM(const memslice key) : aes(key) {
+    __m128i *h = reinterpret_cast<__m128i *>(h_powers);
+    __m128i *hk = reinterpret_cast<__m128i *>(h_karatsuba);
+
+    uint8_t zero[16] = { 0 };
+    uint8_t h_bytes[16];
+    aes.encrypt_block(zero, h_bytes);
+
+    h[0] = byte_swap(load_block(h_bytes));
+    hk[0] = karatsuba_key(h[0]);
+    for (size_t i = 1; i < 8; i++) {
+        h[i] = gfmul(h[i - 1], h[0], hk[0]);
+        hk[i] = karatsuba_key(h[i]);
+    }
+}
+
+void AESNIGCM::seal(const memslice nonce, const memslice ad,
+                    const memslice plaintext, bytestring &ciphertext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+
+    uint8_t j0_bytes[16] = { 0 };
+    memcpy(j0_bytes, nonce.cptr(), 12);
+    j0_bytes[15] = 1;
+    __m128i j0 = load_block(j0_bytes);
+
+    GCMContext ctx;
+    ctx.rk = reinterpret_cast<const __m128i *>(aes.enc_round_keys);
+    ctx.nrounds = aes.nrounds;
+    ctx.h = reinterpret_cast<const __m128i *>(h_powers);
+    ctx.hk = reinterpret_cast<const __m128i *>(h_karatsuba);
+    ctx.counter = byte_swap(j0);
+    ctx.y = _mm_setzero_si128();
+    ctx.ghash(ad.cptr(), ad.size());
+
+    size_t len = plaintext.size();
+    ciphertext.resize(len + 16);
+    const uint8_t *in = plaintext.cptr();
+    uint8_t *out = ciphertext.ptr();
+    size_t remaining = len;
+
+    if (remaining >= 8 * 16) {
+        const __m128i *rk = ctx.rk;
+        size_t nrounds = ctx.nrounds;
+
+        // Encrypt the first eight blocks; their GHASH is computed in the
+        // next iteration, interleaved with the encryption of the blocks
+        // that follow them.
+        __m128i blocks[8];
+        __m128i prev[8];
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = ctx.encrypt(ctx.next_counter());
+            blocks[j] = _mm_xor_si128(blocks[j], load_block(in + j * 16));
+            store_block(out + j * 16, blocks[j]);
+            prev[j] = byte_swap(blocks[j]);
+        }
+        prev[0] = _mm_xor_si128(prev[0], ctx.y);
+        in += 8 * 16;
+        out += 8 * 16;
+        remaining -= 8 * 16;
+
+        while (remaining >= 8 * 16) {
+            __m128i lo = _mm_setzero_si128();
+            __m128i mid = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+
+            for (size_t j = 0; j < 8; j++) {
+                blocks[j] = _mm_xor_si128(ctx.next_counter(), rk[0]);
+            }
+            // The first eight rounds each carry one GHASH multiplication
+            for (size_t i = 1; i <= 8; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    blocks[j] = _mm_aesenc_si128(blocks[j], rk[i]);
+                }
+                clmul_accumulate(prev[i - 1], ctx.h[8 - i], ctx.hk[8 - i],
+                                 lo, mid, hi);
+            }
+            for (size_t i = 9; i < nrounds; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    blocks[j] = _mm_aesenc_si128(blocks[j], rk[i]);
+                }
+            }
+            for (size_t j = 0; j < 8; j++) {
+                blocks[j] = _mm_aesenclast_si128(blocks[j], rk[nrounds]);
+                blocks[j] = _mm_xor_si128(blocks[j], load_block(in + j * 16));
+                store_block(out + j * 16, blocks[j]);
+                prev[j] = byte_swap(blocks[j]);
+            }
+
+            ctx.y = reduce(lo, mid, hi);
+            prev[0] = _mm_xor_si128(prev[0], ctx.y);
+            in += 8 * 16;
+            out += 8 * 16;
+            remaining -= 8 * 16;
+        }
+
+        // Hash the last batch of eight blocks
+        __m128i lo = _mm_setzero_si128();
+        __m128i mid = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (size_t j = 0; j < 8; j++) {
+            clmul_accumulate(prev[j], ctx.h[7 - j], ctx.hk[7 - j], lo, mid,
+                             hi);
+        }
+        ctx.y = reduce(lo, mid, hi);
+    }
+
+    ctx.ctr_tail(in, out, remaining, true);
+    ctx.finish(ad.size(), len, j0, ciphertext.ptr() + len);
+}
+
+bool AESNIGCM::open(const memslice nonce, const memslice ad,
+                    const memslice ciphertext, bytestring &plaintext) const {
+    contract_assert(nonce.size() == get_nonce_size());
+    plaintext.clear();
+
+    if (ciphertext.size() < 16) {
+        return false;
+    }
+    size_t len = ciphertext.size() - 16;
+
+    uint8_t j0_bytes[16] = { 0 };
+    memcpy(j0_bytes, nonce.cptr(), 12);
+    j0_bytes[15] = 1;
+    __m128i j0 = load_block(j0_bytes);
+
+    GCMContext ctx;
+    ctx.rk = reinterpret_cast<const __m128i *>(aes.enc_round_keys);
+    ctx.nrounds = aes.nrounds;
+    ctx.h = reinterpret_cast<const __m128i *>(h_powers);
+    ctx.hk = reinterpret_cast<const __m128i *>(h_karatsuba);
+    ctx.counter = byte_swap(j0);
+    ctx.y = _mm_setzero_si128();
+    ctx.ghash(ad.cptr(), ad.size());
+
+    plaintext.resize(len);
+    const uint8_t *in = ciphertext.cptr();
+    uint8_t *out = plaintext.ptr();
+    size_t remaining = len;
+
+    // When decrypting, the ciphertext is already known, so each batch of
+    // eight blocks is hashed while the same blocks are being decrypted.
+    const __m128i *rk = ctx.rk;
+    size_t nrounds = ctx.nrounds;
+    while (remaining >= 8 * 16) {
+        __m128i blocks[8];
+        __m128i lo = _mm_setzero_si128();
+        __m128i mid = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = _mm_xor_si128(ctx.next_counter(), rk[0]);
+        }
+        for (size_t i = 1; i <= 8; i++) {
+            for (size_t j = 0; j < 8; j++) {
+                blocks[j] = _mm_aesenc_si128(blocks[j], rk[i]);
+            }
+            __m128i c = byte_swap(load_block(in + (i - 1) * 16));
+            if (i == 1) {
+                c = _mm_xor_si128(c, ctx.y);
+            }
+            clmul_accumulate(c, ctx.h[8 - i], ctx.hk[8 - i], lo, mid, hi);
+        }
+        for (size_t i = 9; i < nrounds; i++) {
+            for (size_t j = 0; j < 8; j++) {
+                blocks[j] = _mm_aesenc_si128(blocks[j], rk[i]);
+            }
+        }
+        for (size_t j = 0; j < 8; j++) {
+            blocks[j] = _mm_aesenclast_si128(blocks[j], rk[nrounds]);
+            store_block(out + j * 16,
+                        _mm_xor_si128(blocks[j], load_block(in + j * 16)));
+        }
+
+        ctx.y = reduce(lo, mid, hi);
+        in += 8 * 16;
+        out += 8 * 16;
+        remaining -= 8 * 16;
+    }
+    ctx.ctr_tail(in, out, remaining, false);
+
+    uint8_t tag[16];
+    ctx.finish(ad.size(), len, j0, tag);
+
+    // Compare the tags in constant time
+    const uint8_t *expected_tag = ciphertext.cptr() + len;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 16; i++) {
+        diff |= tag[i] ^ expected_tag[i];
+    }
+    if (diff != 0) {
+        // Do not release unauthenticated plaintext
+        std::fill(plaintext.begin(), plaintext.end(), 0);
+        plaintext.clear();
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+
+#include "crypto/cipher/gcm.hh"
+#include "crypto/cpu.hh"
+
+#include <random>
+
+/**
+ * GCM test vector.  The expected output is the ciphertext followed by the
+ * authentication tag.
+ */
+struct GCMTestVector {
+    int count;
+    crypto::bytestring key;
+    crypto::bytestring nonce;
+    crypto::bytestring ad;
+    crypto::bytestring plaintext;
+    crypto::bytestring output;
+
+    GCMTestVector(int no, const char *key_hex, const char *nonce_hex,
+                  const char *ad_hex, const char *pt_hex, const char *ct_hex,
+                  const char *tag_hex) {
+        count = no;
+        key = crypto::bytestring::from_hex(key_hex);
+        nonce = crypto::bytestring::from_hex(nonce_hex);
+        ad = crypto::bytestring::from_hex(ad_hex);
+        plaintext = crypto::bytestring::from_hex(pt_hex);
+        output = crypto::bytestring::from_hex(ct_hex);
+        output += crypto::bytestring::from_hex(tag_hex);
+    }
+};
+
+// Test cases 1-4 and 13-16 from "The Galois/Counter Mode of Operation (GCM)"
+// by McGrew and Viega
+const GCMTestVector GCMVectors[] = {
+    GCMTestVector(1, "00000000000000000000000000000000",
+                  "000000000000000000000000", "", "", "",
+                  "58e2fccefa7e3061367f1d57a4e7455a"),
+    GCMTestVector(2, "00000000000000000000000000000000",
+                  "000000000000000000000000", "",
+                  "00000000000000000000000000000000",
+                  "0388dace60b6a392f328c2b971b2fe78",
+                  "ab6e47d42cec13bdf53a67b21257bddf"),
+    GCMTestVector(3, "feffe9928665731c6d6a8f9467308308",
+                  "cafebabefacedbaddecaf888", "",
+                  "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a3"
+                  "18a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b"
+                  "391aafd255",
+                  "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329a"
+                  "ca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e0"
+                  "91473f5985",
+                  "4d5c2af327cd64a62cf35abd2ba6fab4"),
+    GCMTestVector(4, "feffe9928665731c6d6a8f9467308308",
+                  "cafebabefacedbaddecaf888",
+                  "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+                  "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a3"
+                  "18a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b"
+                  "39",
+                  "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329a"
+                  "ca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e0"
+                  "91",
+                  "5bc94fbc3221a5db94fae95ae7121a47"),
+    GCMTestVector(13, "0000000000000000000000000000000000000000000000000000000000000000",
+                  "000000000000000000000000", "", "", "",
+                  "530f8afbc74536b9a963b4f1c4cb738b"),
+    GCMTestVector(14, "0000000000000000000000000000000000000000000000000000000000000000",
+                  "000000000000000000000000", "",
+                  "00000000000000000000000000000000",
+                  "cea7403d4d606b6e074ec5d3baf39d18",
+                  "d0d1c8a799996bf0265b98b5d48ab919"),
+    GCMTestVector(15, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308",
+                  "cafebabefacedbaddecaf888", "",
+                  "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a3"
+                  "18a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b"
+                  "391aafd255",
+                  "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd255"
+                  "5d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f6"
+                  "62898015ad",
+                  "b094dac5d93471bdec1a502270e3cc6c"),
+    GCMTestVector(16, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308",
+                  "cafebabefacedbaddecaf888",
+                  "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+                  "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a3"
+                  "18a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b"
+                  "39",
+                  "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd255"
+                  "5d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f6"
+                  "62",
+                  "76fc6ece0f4e1768cddf8853bb2d551b"),
+};
+
+/**
+ * Tests an implementation against the published test vectors, and checks
+ * that any modification of the ciphertext, the tag or the associated data is
+ * detected.
+ */
+void test_gcm_vectors(crypto::AEADFactory impl) {
+    crypto::bytestring output;
+    crypto::bytestring plaintext;
+
+    for (const GCMTestVector &vec : GCMVectors) {
+        crypto::AEAD_u gcm = impl(vec.key.cmem());
+        gcm->seal(vec.nonce.cmem(), vec.ad.cmem(), vec.plaintext.cmem(),
+                  output);
+        EXPECT_EQ(vec.output, output) << "Test case " << vec.count;
+
+        EXPECT_TRUE(gcm->open(vec.nonce.cmem(), vec.ad.cmem(),
+                              vec.output.cmem(), plaintext));
+        EXPECT_EQ(vec.plaintext, plaintext) << "Test case " << vec.count;
+
+        for (size_t i = 0; i < vec.output.size(); i++) {
+            crypto::bytestring tampered = vec.output;
+            tampered[i] ^= 0x01;
+            EXPECT_FALSE(gcm->open(vec.nonce.cmem(), vec.ad.cmem(),
+                                   tampered.cmem(), plaintext));
+            EXPECT_EQ(0u, plaintext.size());
+        }
+
+        crypto::bytestring ad = vec.ad;
+        ad += crypto::bytestring::from_hex("00");
+        EXPECT_FALSE(gcm->open(vec.nonce.cmem(), ad.cmem(), vec.output.cmem(),
+                               plaintext));
+
+        crypto::bytestring truncated = vec.output.substr(0, 15);
+        EXPECT_FALSE(gcm->open(vec.nonce.cmem(), vec.ad.cmem(),
+                               truncated.cmem(), plaintext));
+    }
+}
+
+/**
+ * Check that implementations A and B produce the same output for random keys,
+ * nonces, associated data and plaintexts of random length.
+ */
+void test_randomized_gcm_compat(crypto::AEADFactory implA,
+                                crypto::AEADFactory implB, size_t key_size,
+                                uint32_t iters) {
+    std::mt19937 rng(key_size * iters);
+    std::uniform_int_distribution<size_t> len_dist(0, 1024);
+    crypto::bytestring key(key_size), nonce(12);
+    crypto::bytestring outputA, outputB, plaintext;
+
+    for (uint32_t iter = 0; iter < iters; iter++) {
+        crypto::bytestring ad(len_dist(rng) / 4);
+        crypto::bytestring input(len_dist(rng));
+        for (crypto::bytestring *str : { &key, &nonce, &ad, &input }) {
+            for (size_t i = 0; i < str->size(); i++) {
+                (*str)[i] = rng();
+            }
+        }
+
+        crypto::AEAD_u a = implA(key.cmem());
+        crypto::AEAD_u b = implB(key.cmem());
+        a->seal(nonce.cmem(), ad.cmem(), input.cmem(), outputA);
+        b->seal(nonce.cmem(), ad.cmem(), input.cmem(), outputB);
+        ASSERT_EQ(outputA, outputB);
+
+        ASSERT_TRUE(b->open(nonce.cmem(), ad.cmem(), outputA.cmem(),
+                            plaintext));
+        ASSERT_EQ(input, plaintext);
+    }
+}
+
+crypto::AEAD_u portableGCM(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESGCMImpl(key));
+}
+
+TEST(AESGCMImpl, Vectors) {
+    test_gcm_vectors(portableGCM);
+}
+
+crypto::AEAD_u aesniGCM(const crypto::memslice key) {
+    return crypto::AEAD_u(new crypto::AESNIGCM(key));
+}
+
+TEST(AESNIGCM, Vectors) {
+    crypto::CPU cpu;
+    if (!cpu.has_aesni() || !cpu.has_pclmulqdq() || !cpu.has_ssse3()) {
+        return;
+    }
+
+    test_gcm_vectors(aesniGCM);
+}
+
+TEST(AESNIGCM, PortableCompat) {
+    crypto::CPU cpu;
+    if (!cpu.has_aesni() || !cpu.has_pclmulqdq() || !cpu.has_ssse3()) {
+        return;
+    }
+
+    test_randomized_gcm_compat(portableGCM, aesniGCM, 16, 1000);
+    test_randomized_gcm_compat(portableGCM, aesniGCM, 32, 1000);
+}
+
+TEST(GCMInterface, ImplSelection) {
+    test_gcm_vectors(crypto::AES_GCM);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
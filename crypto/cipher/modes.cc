@@ -1,66 +1,155 @@
 #include "crypto/cipher.hh"
 
+#include <algorithm>
+
 namespace crypto {
 
-void BlockCipher::encrypt_cbc(const bytestring &plaintext, const bytestring &iv,
-                              bytestring &ciphertext) const {
-    // FIXME: assert the right size of IV
-    // FIXME: assert that block size is proportional
-    size_t block_size = get_block_size();
-    size_t num_blocks = plaintext.size() / block_size;
-    ciphertext.resize(num_blocks * block_size);
+namespace {
+
+// The largest block size among the implemented ciphers; lets the generic
+// modes keep their chaining state on the stack instead of allocating it.
+const size_t max_block_size = 16;
 
-    if (num_blocks == 0) {
-        return;
+// Increment the counter block as a big-endian integer
+inline void increment_counter(uint8_t *counter, size_t block_size) {
+    for (size_t j = block_size; j > 0; j--) {
+        if (++counter[j - 1] != 0) {
+            break;
+        }
     }
+}
+
+}
 
-    bytestring buffer(iv);
+void BlockCipher::encrypt_cbc(const memslice plaintext, const memslice iv,
+                              memslice ciphertext) const {
+    size_t block_size = get_block_size();
+    contract_assert(iv.size() == block_size);
+    contract_assert(plaintext.size() % block_size == 0);
+    contract_assert(ciphertext.size() == plaintext.size());
+
+    size_t num_blocks = plaintext.size() / block_size;
+    const uint8_t *prev_ciphertext = iv.cptr();
     for (size_t i = 0; i < num_blocks; i++) {
-        // XOR previous ciphertext or IV with new plaintext
+        const uint8_t *current_plaintext = plaintext.cptr() + i * block_size;
+        uint8_t *current_ciphertext = ciphertext.ptr() + i * block_size;
+
+        // XOR previous ciphertext or IV with new plaintext directly in the
+        // output, so that in-place encryption needs no extra buffer
         for (size_t j = 0; j < block_size; j++) {
-            buffer[j] ^= plaintext[i * block_size + j];
+            current_ciphertext[j] = current_plaintext[j] ^ prev_ciphertext[j];
         }
 
         // Actually encrypt the block
-        uint8_t *current_ciphertext = ciphertext.ptr() + i * block_size;
-        encrypt_block(buffer.ptr(), current_ciphertext);
-
-        // Copy ciphertext to the next buffer
-        buffer.copy_from(mem(current_ciphertext, block_size));
+        encrypt_block(current_ciphertext, current_ciphertext);
+        prev_ciphertext = current_ciphertext;
     }
 }
 
-void BlockCipher::decrypt_cbc(const bytestring &ciphertext, const bytestring &iv,
-                              bytestring &plaintext) const {
-    // FIXME: assert the right size of IV
-    // FIXME: assert that block size is proportional
+void BlockCipher::encrypt_blocks(const uint8_t *plaintext,
+                                 uint8_t *ciphertext, size_t num_blocks) const {
     size_t block_size = get_block_size();
-    size_t num_blocks = ciphertext.size() / block_size;
-    plaintext.resize(num_blocks * block_size);
-
-    if (num_blocks == 0) {
-        return;
+    for (size_t i = 0; i < num_blocks; i++) {
+        encrypt_block(plaintext + i * block_size, ciphertext + i * block_size);
     }
+}
 
+void BlockCipher::decrypt_blocks(const uint8_t *ciphertext,
+                                 uint8_t *plaintext, size_t num_blocks) const {
+    size_t block_size = get_block_size();
     for (size_t i = 0; i < num_blocks; i++) {
-        const uint8_t *prev_ciphertext;
-        uint8_t *target_plaintext = plaintext.ptr() + i * block_size;
+        decrypt_block(ciphertext + i * block_size, plaintext + i * block_size);
+    }
+}
 
-        // Select previous ciphertext or IV to XOR with
-        if (i > 0) {
-            prev_ciphertext = ciphertext.cptr() + (i - 1) * block_size;
-        } else {
-            prev_ciphertext = iv.cptr();
-        }
+void BlockCipher::decrypt_cbc(const memslice ciphertext, const memslice iv,
+                              memslice plaintext) const {
+    size_t block_size = get_block_size();
+    contract_assert(block_size <= max_block_size);
+    contract_assert(iv.size() == block_size);
+    contract_assert(ciphertext.size() % block_size == 0);
+    contract_assert(plaintext.size() == ciphertext.size());
+
+    // Unlike encryption, CBC decryption of different blocks is independent,
+    // so the blocks are handed to the cipher in batches which it may decrypt
+    // in parallel.  Each batch of ciphertext is copied first, since it is
+    // still needed for chaining after in-place decryption overwrites it.
+    const size_t batch_size = 8;
+    uint8_t batch_ciphertext[batch_size * max_block_size];
+    uint8_t prev_ciphertext[max_block_size];
+    memcpy(prev_ciphertext, iv.cptr(), block_size);
+
+    size_t num_blocks = ciphertext.size() / block_size;
+    for (size_t i = 0; i < num_blocks; i += batch_size) {
+        size_t batch = std::min(batch_size, num_blocks - i);
+        uint8_t *target_plaintext = plaintext.ptr() + i * block_size;
+        memcpy(batch_ciphertext, ciphertext.cptr() + i * block_size,
+               batch * block_size);
 
         // Decrypt
-        decrypt_block(ciphertext.cptr() + i * block_size, target_plaintext);
+        decrypt_blocks(batch_ciphertext, target_plaintext, batch);
 
         // XOR previous ciphertext or IV with the plaintext
         for (size_t j = 0; j < block_size; j++) {
             target_plaintext[j] ^= prev_ciphertext[j];
         }
+        for (size_t j = block_size; j < batch * block_size; j++) {
+            target_plaintext[j] ^= batch_ciphertext[j - block_size];
+        }
+        memcpy(prev_ciphertext,
+               batch_ciphertext + (batch - 1) * block_size, block_size);
+    }
+}
+
+void BlockCipher::counter_xor(const memslice iv, const memslice input,
+                              memslice output) const {
+    size_t block_size = get_block_size();
+    contract_assert(block_size <= max_block_size);
+    contract_assert(iv.size() == block_size);
+    contract_assert(output.size() == input.size());
+
+    // The counter blocks are independent, so a batch of them is prepared
+    // and encrypted with a single call to encrypt_blocks()
+    const size_t batch_size = 8;
+    uint8_t counter[max_block_size];
+    uint8_t counters[batch_size * max_block_size];
+    uint8_t keystream[batch_size * max_block_size];
+    memcpy(counter, iv.cptr(), block_size);
+    for (size_t offset = 0; offset < input.size();
+         offset += batch_size * block_size) {
+        // The last batch may be shorter and end with a partial block
+        size_t len = std::min(batch_size * block_size, input.size() - offset);
+        size_t batch = (len + block_size - 1) / block_size;
+        for (size_t i = 0; i < batch; i++) {
+            memcpy(counters + i * block_size, counter, block_size);
+            increment_counter(counter, block_size);
+        }
+        encrypt_blocks(counters, keystream, batch);
+
+        const uint8_t *in = input.cptr() + offset;
+        uint8_t *out = output.ptr() + offset;
+        for (size_t j = 0; j < len; j++) {
+            out[j] = in[j] ^ keystream[j];
+        }
     }
 }
 
+void BlockCipher::encrypt_cbc(const bytestring &plaintext, const bytestring &iv,
+                              bytestring &ciphertext) const {
+    ciphertext.resize(plaintext.size());
+    encrypt_cbc(plaintext.cmem(), iv.cmem(), ciphertext.mem());
+}
+
+void BlockCipher::decrypt_cbc(const bytestring &ciphertext, const bytestring &iv,
+                              bytestring &plaintext) const {
+    plaintext.resize(ciphertext.size());
+    decrypt_cbc(ciphertext.cmem(), iv.cmem(), plaintext.mem());
+}
+
+void BlockCipher::counter_xor(const bytestring &iv, const bytestring &input,
+                              bytestring &output) const {
+    output.resize(input.size());
+    counter_xor(iv.cmem(), input.cmem(), output.mem());
+}
+
 }
@@ -6,9 +6,10 @@
 namespace crypto {
 
 /**
- * Base class for various implementations of RC4.
+ * Base class for various implementations of RC4.  The implementations only
+ * generate the keystream, which is buffered by BufferedStreamCipher.
  */
-class RC4Base : public StreamCipher {
+class RC4Base : public BufferedStreamCipher {
   public:
     virtual ~RC4Base() {};
 
@@ -36,7 +37,54 @@ class RC4Impl : public RC4Base {
     virtual const char *get_impl_desc() const override { return "RC4 (standard)"; }
 
     RC4Impl(const memslice key, const memslice iv);
-    virtual void stream_xor(memslice stream) override;
+
+  protected:
+    virtual void generate(uint8_t *output, size_t len) override;
+};
+
+/**
+ * RC4 with the S-box widened to 32-bit words, so that the loads and stores
+ * of the swap are full-register ones and do not stall on partial register
+ * writes.  The keystream bytes are collected into words before they are
+ * stored.  Several streams can also be advanced together with xor_batch(),
+ * which interleaves their steps so that their dependency chains overlap.
+ *
+ * The keystream is only generated in whole buffers, a multiple of 256 bytes,
+ * so the index i is always zero at the start of a buffer and is not stored.
+ */
+class RC4Wide : public RC4Base {
+  private:
+    uint32_t j;
+    uint32_t S[256];
+
+    template <size_t count>
+    static void generate_interleaved(RC4Wide *const *ciphers,
+                                     uint8_t *const *output);
+
+  public:
+    virtual const char *get_impl_desc() const override {
+        return "RC4 (32-bit S-box)";
+    }
+
+    RC4Wide(const memslice key, const memslice iv);
+
+    /**
+     * The number of streams whose keystream is generated together.  Beyond
+     * two, the state of the streams no longer fits in the registers of
+     * x86-64, and the interleaving becomes slower.
+     */
+    static constexpr size_t max_interleave = 2;
+
+    /**
+     * Do what calling xor_to() with |inputs[k]| and |outputs[k]| on each of
+     * |count| |ciphers| would, generating the keystreams of up to
+     * max_interleave of them at once.  The ciphers MUST be distinct objects.
+     */
+    static void xor_batch(RC4Wide *const *ciphers, const memslice *inputs,
+                          memslice *outputs, size_t count);
+
+  protected:
+    virtual void generate(uint8_t *output, size_t len) override;
 };
 
 };
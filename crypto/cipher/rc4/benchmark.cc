@@ -0,0 +1,88 @@
+#include "crypto/cipher/rc4.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+#include <vector>
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_impl(crypto::StreamCipherFactory impl) {
+    bytestring key(16);
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = i;
+    }
+
+    crypto::StreamCipher_u rc4 = impl(key.cmem(), crypto::nullmem);
+    const char *desc = rc4->get_impl_desc();
+
+    // Short sizes are the ones of small TLS records, which are served from
+    // the keystream buffer
+    for (size_t size : { 5, 16, 1024, 16384 }) {
+        bytestring input(size);
+        bytestring output(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            desc, "RC4 in place", size,
+            crypto::cycles_per_byte([&]() {
+                rc4->stream_xor(input.mem());
+            }, size, iterations));
+
+        crypto::report_benchmark(
+            desc, "RC4 to buffer", size,
+            crypto::cycles_per_byte([&]() {
+                rc4->xor_to(input.cmem(), output.mem());
+            }, size, iterations));
+    }
+}
+
+// Four streams at once through the batch interface
+void benchmark_batch() {
+    const size_t count = 4;
+    std::unique_ptr<crypto::RC4Wide> streams[count];
+    crypto::RC4Wide *ciphers[count];
+    for (size_t k = 0; k < count; k++) {
+        bytestring key(16);
+        key[0] = k;
+        streams[k].reset(new crypto::RC4Wide(key.cmem(), crypto::nullmem));
+        ciphers[k] = streams[k].get();
+    }
+
+    for (size_t size : { 5, 16, 1024, 16384 }) {
+        bytestring data[count];
+        std::vector<crypto::memslice> slices;
+        for (size_t k = 0; k < count; k++) {
+            data[k].resize(size);
+            slices.push_back(data[k].mem());
+        }
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            "RC4 (32-bit S-box)", "RC4 batch of 4", count * size,
+            crypto::cycles_per_byte([&]() {
+                crypto::RC4Wide::xor_batch(ciphers, slices.data(),
+                                           slices.data(), count);
+            }, count * size, iterations));
+    }
+}
+
+crypto::StreamCipher_u defaultRC4(const crypto::memslice key,
+                                  const crypto::memslice iv) {
+    return crypto::StreamCipher_u(new crypto::RC4Impl(key, iv));
+}
+
+crypto::StreamCipher_u wideRC4(const crypto::memslice key,
+                               const crypto::memslice iv) {
+    return crypto::StreamCipher_u(new crypto::RC4Wide(key, iv));
+}
+
+}
+
+int main(int argc, char **argv) {
+    benchmark_impl(defaultRC4);
+    benchmark_impl(wideRC4);
+    benchmark_batch();
+    return 0;
+}
@@ -1,9 +1,24 @@
 #include "crypto/cipher/rc4.hh"
+#include "crypto/dispatch.hh"
+
+#include <algorithm>
 
 namespace crypto {
 
+namespace {
+
+typedef RC4Base *(*RC4Constructor)(const memslice key, const memslice iv);
+
+RC4Constructor select_implementation() {
+    // The widened S-box is the faster one wherever it was measured
+    return construct<RC4Base, RC4Wide>;
+}
+
+}
+
 RC4Base_u RC4(const memslice key, const memslice iv) {
-    return RC4Base_u(new RC4Impl(key, iv));
+    static const RC4Constructor constructor = select_implementation();
+    return RC4Base_u(constructor(key, iv));
 }
 
 static inline void swap_bytes(uint8_t &a, uint8_t &b) {
@@ -30,14 +45,131 @@ RC4Impl::RC4Impl(const memslice key_mem, const memslice iv_mem) {
     j = 0;
 }
 
-void RC4Impl::stream_xor(memslice stream) {
-    for (size_t k = 0; k < stream.size(); k++) {
+void RC4Impl::generate(uint8_t *output, size_t len) {
+    // The output may alias the state, so keep the indices in locals
+    uint8_t i = this->i;
+    uint8_t j = this->j;
+
+    for (size_t k = 0; k < len; k++) {
         uint8_t idx;
         i++;
         j += S[i];
         swap_bytes(S[i], S[j]);
         idx = S[i] + S[j];
-        stream.ptr()[k] ^= S[idx];
+        output[k] = S[idx];
+    }
+
+    this->i = i;
+    this->j = j;
+}
+
+constexpr size_t RC4Wide::max_interleave;
+
+static_assert(RC4Wide::buffer_size % 256 == 0,
+              "RC4Wide relies on i wrapping around at the end of a buffer");
+
+RC4Wide::RC4Wide(const memslice key_mem, const memslice iv_mem) {
+    const uint8_t *key = key_mem.cptr();
+    size_t key_len = key_mem.size();
+
+    for (size_t k = 0; k < 256; k++) {
+        S[k] = k;
+    }
+
+    uint32_t l = 0;
+    for (size_t k = 0; k < 256; k++) {
+        l = (l + S[k] + key[k % key_len]) & 0xff;
+        std::swap(S[k], S[l]);
+    }
+
+    j = 0;
+}
+
+void RC4Wide::generate(uint8_t *output, size_t len) {
+    contract_assert(len == buffer_size);
+    RC4Wide *self = this;
+    generate_interleaved<1>(&self, &output);
+}
+
+template <size_t count>
+void RC4Wide::generate_interleaved(RC4Wide *const *ciphers,
+                                   uint8_t *const *output) {
+    uint32_t *S[count];
+    uint32_t j[count];
+    for (size_t n = 0; n < count; n++) {
+        S[n] = ciphers[n]->S;
+        j[n] = ciphers[n]->j;
+    }
+
+    // The loops over the streams are unrolled, and their steps do not
+    // depend on each other.  Every stream has the same i.
+    uint32_t i = 0;
+    for (size_t k = 0; k < buffer_size; k += 4) {
+        uint32_t word[count] = { 0 };
+        for (size_t b = 0; b < 4; b++) {
+            i = (i + 1) & 0xff;
+            for (size_t n = 0; n < count; n++) {
+                uint32_t x = S[n][i];
+                j[n] = (j[n] + x) & 0xff;
+                uint32_t y = S[n][j[n]];
+                S[n][i] = y;
+                S[n][j[n]] = x;
+                word[n] |= S[n][(x + y) & 0xff] << (8 * b);
+            }
+        }
+
+        // The compiler merges these into a single store
+        for (size_t n = 0; n < count; n++) {
+            for (size_t b = 0; b < 4; b++) {
+                output[n][k + b] = word[n] >> (8 * b);
+            }
+        }
+    }
+
+    for (size_t n = 0; n < count; n++) {
+        ciphers[n]->j = j[n];
+    }
+}
+
+void RC4Wide::xor_batch(RC4Wide *const *ciphers, const memslice *inputs,
+                        memslice *outputs, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        contract_assert(outputs[k].size() == inputs[k].size());
+    }
+
+    for (size_t first = 0; first < count; first += max_interleave) {
+        size_t group = std::min(max_interleave, count - first);
+        size_t done[max_interleave] = { 0 };
+
+        // Use up the buffered keystream of every stream, then refill the
+        // buffers of the ones which need more at the same time
+        while (true) {
+            RC4Wide *empty[max_interleave];
+            uint8_t *buffers[max_interleave];
+            size_t num_empty = 0;
+            for (size_t n = 0; n < group; n++) {
+                RC4Wide *cipher = ciphers[first + n];
+                const memslice &input = inputs[first + n];
+                memslice &output = outputs[first + n];
+
+                done[n] += cipher->xor_buffered(input.cptr() + done[n],
+                                                output.ptr() + done[n],
+                                                input.size() - done[n]);
+                if (done[n] < input.size()) {
+                    empty[num_empty] = cipher;
+                    buffers[num_empty] = cipher->refill_buffer();
+                    num_empty++;
+                }
+            }
+
+            if (num_empty == 0) {
+                break;
+            } else if (num_empty == 1) {
+                generate_interleaved<1>(empty, buffers);
+            } else {
+                generate_interleaved<2>(empty, buffers);
+            }
+        }
     }
 }
 
@@ -2,6 +2,8 @@
 
 #include "crypto/cipher/rc4.hh"
 
+#include <random>
+
 struct RC4TestVector {
     const char *key;
     const char *output;
@@ -321,6 +323,108 @@ TEST(RC4, IETFVectors) {
     test_ietf_vectors(defaultRC4);
 }
 
+// Splitting the stream into calls of any size, including ones that cross the
+// boundaries of the keystream buffer, must not change the output, and
+// neither may writing it to a separate buffer
+void test_chunks(crypto::StreamCipherFactory impl) {
+    std::mt19937 rng(6229);
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
+    crypto::bytestring key(16);
+    crypto::bytestring input(5000);
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = all_bytes(rng);
+    }
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = all_bytes(rng);
+    }
+
+    crypto::bytestring expected = input;
+    impl(key.cmem(), crypto::nullmem)->stream_xor(expected.mem());
+
+    std::uniform_int_distribution<size_t> chunk_sizes(0, 700);
+    crypto::StreamCipher_u rc4 = impl(key.cmem(), crypto::nullmem);
+    crypto::bytestring output(input.size());
+    for (size_t i = 0; i < input.size();) {
+        size_t len = std::min(chunk_sizes(rng), input.size() - i);
+        rc4->xor_to(crypto::cmem(input.cptr() + i, len),
+                    crypto::memslice(output.ptr() + i, len));
+        i += len;
+    }
+    EXPECT_EQ(expected, output);
+}
+
+crypto::StreamCipher_u wideRC4(const crypto::memslice key, const crypto::memslice iv) {
+    return crypto::StreamCipher_u(new crypto::RC4Wide(key, iv));
+}
+
+TEST(RC4, Chunks) {
+    test_chunks(defaultRC4);
+}
+
+TEST(RC4Wide, IETFVectors) {
+    test_ietf_vectors(wideRC4);
+}
+
+TEST(RC4Wide, Chunks) {
+    test_chunks(wideRC4);
+}
+
+// A batch must give the same result as separate calls, for any number of
+// streams of different lengths, with some keystream already buffered
+TEST(RC4Wide, Batch) {
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
+    std::uniform_int_distribution<size_t> lengths(0, 2000);
+
+    for (size_t count = 1; count <= 9; count++) {
+        std::vector<std::unique_ptr<crypto::RC4Wide>> batch, reference;
+        std::vector<crypto::RC4Wide *> ciphers;
+        std::vector<crypto::bytestring> inputs, outputs, expected;
+        for (size_t k = 0; k < count; k++) {
+            crypto::bytestring key(5 + k);
+            for (size_t i = 0; i < key.size(); i++) {
+                key[i] = all_bytes(rng);
+            }
+            batch.emplace_back(new crypto::RC4Wide(key.cmem(), crypto::nullmem));
+            reference.emplace_back(new crypto::RC4Wide(key.cmem(), crypto::nullmem));
+            ciphers.push_back(batch.back().get());
+
+            // Leave a different part of the first buffer unused in each
+            crypto::bytestring prefix(k * 37);
+            batch.back()->stream_xor(prefix.mem());
+            reference.back()->stream_xor(prefix.mem());
+
+            inputs.emplace_back(lengths(rng));
+            for (size_t i = 0; i < inputs.back().size(); i++) {
+                inputs.back()[i] = all_bytes(rng);
+            }
+            outputs.emplace_back(inputs.back().size());
+            expected.emplace_back(inputs.back().size());
+            reference.back()->xor_to(inputs.back().cmem(), expected.back().mem());
+        }
+
+        std::vector<crypto::memslice> input_mems, output_mems;
+        for (size_t k = 0; k < count; k++) {
+            input_mems.push_back(inputs[k].cmem());
+            output_mems.push_back(outputs[k].mem());
+        }
+        crypto::RC4Wide::xor_batch(ciphers.data(), input_mems.data(),
+                                   output_mems.data(), count);
+
+        for (size_t k = 0; k < count; k++) {
+            EXPECT_EQ(expected[k], outputs[k]) << count << " streams, stream " << k;
+        }
+
+        // The streams must carry on from where the batch left them
+        for (size_t k = 0; k < count; k++) {
+            crypto::bytestring next(100), next_expected(100);
+            batch[k]->stream_xor(next.mem());
+            reference[k]->stream_xor(next_expected.mem());
+            EXPECT_EQ(next_expected, next);
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
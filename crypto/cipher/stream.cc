@@ -0,0 +1,41 @@
+#include "crypto/cipher.hh"
+
+#include <algorithm>
+
+namespace crypto {
+
+constexpr size_t BufferedStreamCipher::buffer_size;
+
+size_t BufferedStreamCipher::xor_buffered(const uint8_t *input,
+                                          uint8_t *output, size_t len) {
+    // A plain loop, which the compiler vectorizes
+    size_t chunk = std::min(len, buffer_size - keystream_pos);
+    const uint8_t *key = keystream + keystream_pos;
+    for (size_t i = 0; i < chunk; i++) {
+        output[i] = input[i] ^ key[i];
+    }
+
+    keystream_pos += chunk;
+    return chunk;
+}
+
+void BufferedStreamCipher::xor_to(const memslice input, memslice output) {
+    contract_assert(output.size() == input.size());
+
+    const uint8_t *in = input.cptr();
+    uint8_t *out = output.ptr();
+    size_t len = input.size();
+
+    while (len > 0) {
+        if (keystream_pos == buffer_size) {
+            generate(refill_buffer(), buffer_size);
+        }
+
+        size_t done = xor_buffered(in, out, len);
+        in += done;
+        out += done;
+        len -= done;
+    }
+}
+
+}
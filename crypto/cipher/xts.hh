@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+#ifndef __CRYPTO_CIPHER_XTS_HH
+#define __CRYPTO_CIPHER_XTS_HH
+
+#include "crypto/cipher.hh"
+#include "crypto/cipher/aes.hh"
+
+namespace crypto {
+
+/**
+ * Base class for implementations of AES in XTS mode, as specified in IEEE
+ * 1619 and NIST SP 800-38E, which is meant for encrypting storage.  Each data
+ * unit (like a disk sector) is encrypted independently under its own tweak,
+ * and the ciphertext has the same size as the plaintext.
+ *
+ * The key is the concatenation of the data key and the tweak key, so it is
+ * 32 bytes for AES-128-XTS and 64 bytes for AES-256-XTS.
+ */
+class AESXTSBase : public CipherBase {
+  public:
+    virtual ~AESXTSBase() {};
+
+    virtual const char *get_name() const override {
+        return "AES-XTS";
+    }
+
+    virtual bool is_valid_key_size(size_t size) const override {
+        return (size == 32) || (size == 64);
+    }
+
+    /**
+     * Encrypt a single data unit.  |tweak| is 16 bytes long; IEEE 1619
+     * defines it as the data unit sequence number in little-endian.  |input|
+     * has to be at least 16 bytes long, but does not have to be divisible by
+     * the block size, in which case ciphertext stealing is used.  |output|
+     * MUST be of the same size as |input|, and may point to the same memory.
+     */
+    virtual void encrypt(const memslice tweak, const memslice input,
+                         memslice output) const = 0;
+
+    /**
+     * Decrypt a single data unit.  The requirements on the arguments are the
+     * same as for encrypt().
+     */
+    virtual void decrypt(const memslice tweak, const memslice input,
+                         memslice output) const = 0;
+};
+
+typedef std::unique_ptr<AESXTSBase> AESXTSBase_u;
+typedef std::function<AESXTSBase_u(const memslice)> AESXTSFactory;
+AESXTSBase_u AES_XTS(const memslice key);
+
+/**
+ * Portable implementation of XTS on top of whichever AES implementation AES()
+ * selects.  Tweaks for eight blocks are computed ahead, and the blocks are
+ * passed to the cipher together using encrypt_blocks()/decrypt_blocks().
+ */
+class AESXTSImpl : public AESXTSBase {
+  private:
+    AESBase_u data_cipher;
+    AESBase_u tweak_cipher;
+
+    void crypt(const memslice tweak, const memslice input, memslice output,
+               bool encrypt) const;
+
+  public:
+    AESXTSImpl(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "XTS (portable)";
+    }
+
+    virtual void encrypt(const memslice tweak, const memslice input,
+                         memslice output) const override;
+    virtual void decrypt(const memslice tweak, const memslice input,
+                         memslice output) const override;
+};
+
+/**
+ * XTS implementation using AES-NI.  Eight blocks are processed at once, and
+ * the sequence of tweaks is computed in SIMD registers alongside the AES
+ * rounds.
+ */
+class AESNIXTS : public AESXTSBase {
+  private:
+    AESNI data_cipher;
+    AESNI tweak_cipher;
+
+  public:
+    AESNIXTS(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "XTS (AES-NI)";
+    }
+
+    virtual void encrypt(const memslice tweak, const memslice input,
+                         memslice output) const override;
+    virtual void decrypt(const memslice tweak, const memslice input,
+                         memslice output) const override;
+};
+
+}
+
+#endif /* __CRYPTO_CIPHER_XTS_HH */
@@ -0,0 +1,67 @@
+#include "crypto/cipher/xts.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+#include <cstdio>
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_impl(crypto::AESXTSFactory impl, size_t key_size) {
+    bytestring key(key_size);
+    bytestring tweak(16);
+    bytestring output;
+    for (size_t i = 0; i < key.size(); i++) {
+        key[i] = i;
+    }
+
+    crypto::AESXTSBase_u xts = impl(key.cmem());
+    const char *desc = xts->get_impl_desc();
+    const char *name = key_size == 32 ? "AES-128-XTS" : "AES-256-XTS";
+    char op[64];
+
+    // Typical sector sizes
+    for (size_t size : { 512, 4096 }) {
+        bytestring input(size);
+        output.resize(size);
+
+        snprintf(op, sizeof(op), "%s encrypt", name);
+        crypto::report_benchmark(
+            desc, op, size,
+            crypto::cycles_per_byte([&]() {
+                xts->encrypt(tweak.cmem(), input.cmem(), output.mem());
+            }, size, 1000));
+
+        snprintf(op, sizeof(op), "%s decrypt", name);
+        crypto::report_benchmark(
+            desc, op, size,
+            crypto::cycles_per_byte([&]() {
+                xts->decrypt(tweak.cmem(), input.cmem(), output.mem());
+            }, size, 1000));
+    }
+}
+
+crypto::AESXTSBase_u portableXTS(const crypto::memslice key) {
+    return crypto::AESXTSBase_u(new crypto::AESXTSImpl(key));
+}
+
+crypto::AESXTSBase_u aesniXTS(const crypto::memslice key) {
+    return crypto::AESXTSBase_u(new crypto::AESNIXTS(key));
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    for (size_t key_size : { 32, 64 }) {
+        benchmark_impl(portableXTS, key_size);
+        if (cpu.has_aesni()) {
+            benchmark_impl(aesniXTS, key_size);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/cipher/xts.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+
+#include <algorithm>
+
+namespace crypto {
+
+namespace {
+
+typedef AESXTSBase *(*XTSConstructor)(const memslice key);
+
+XTSConstructor select_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_aesni()) {
+        return construct<AESXTSBase, AESNIXTS>;
+    }
+
+    return construct<AESXTSBase, AESXTSImpl>;
+}
+
+}
+
+AESXTSBase_u AES_XTS(const memslice key) {
+    static const XTSConstructor constructor = select_implementation();
+    return AESXTSBase_u(constructor(key));
+}
+
+namespace {
+
+inline uint64_t load_le64(const uint8_t *p) {
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; i--) {
+        x = (x << 8) | p[i];
+    }
+    return x;
+}
+
+inline void store_le64(uint8_t *p, uint64_t x) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = x & 0xff;
+        x >>= 8;
+    }
+}
+
+/**
+ * Multiply the tweak by x in GF(2^128) modulo x^128 + x^7 + x^2 + x + 1.  The
+ * tweak is a little-endian 128-bit integer held as two 64-bit halves, lower
+ * half first.  The reduction is applied using a mask rather than a branch, so
+ * that the timing does not depend on the tweak.
+ */
+inline void mul_x(uint64_t *t) {
+    uint64_t carry = t[1] >> 63;
+    t[1] = (t[1] << 1) | (t[0] >> 63);
+    t[0] = (t[0] << 1) ^ (0x87 & (0 - carry));
+}
+
+inline void store_tweak(uint8_t *p, const uint64_t *t) {
+    store_le64(p, t[0]);
+    store_le64(p + 8, t[1]);
+}
+
+}
+
+AESXTSImpl::AESXTSImpl(const memslice key) {
+    contract_assert(is_valid_key_size(key.size()));
+
+    size_t half = key.size() / 2;
+    data_cipher = AES(cmem(key.cptr(), half));
+    tweak_cipher = AES(cmem(key.cptr() + half, half));
+}
+
+void AESXTSImpl::crypt(const memslice tweak, const memslice input,
+                       memslice output, bool encrypt) const {
+    contract_assert(tweak.size() == 16);
+    contract_assert(input.size() >= 16);
+    contract_assert(output.size() == input.size());
+
+    size_t num_blocks = input.size() / 16;
+    size_t tail = input.size() % 16;
+
+    // With ciphertext stealing, the last full block is processed together
+    // with the partial one
+    size_t bulk_blocks = tail > 0 ? num_blocks - 1 : num_blocks;
+
+    uint8_t tweak_bytes[16];
+    tweak_cipher->encrypt_block(tweak.cptr(), tweak_bytes);
+    uint64_t t[2] = { load_le64(tweak_bytes), load_le64(tweak_bytes + 8) };
+
+    // Process the blocks eight at a time, so that the cipher may process
+    // them in parallel
+    const uint8_t *in = input.cptr();
+    uint8_t *out = output.ptr();
+    uint8_t tweaks[8 * 16];
+    uint8_t buffer[8 * 16];
+    for (size_t i = 0; i < bulk_blocks; i += 8) {
+        size_t batch = std::min(bulk_blocks - i, size_t(8));
+        for (size_t j = 0; j < batch; j++) {
+            store_tweak(tweaks + j * 16, t);
+            mul_x(t);
+        }
+        for (size_t j = 0; j < batch * 16; j++) {
+            buffer[j] = in[j] ^ tweaks[j];
+        }
+        if (encrypt) {
+            data_cipher->encrypt_blocks(buffer, buffer, batch);
+        } else {
+            data_cipher->decrypt_blocks(buffer, buffer, batch);
+        }
+        for (size_t j = 0; j < batch * 16; j++) {
+            out[j] = buffer[j] ^ tweaks[j];
+        }
+        in += batch * 16;
+        out += batch * 16;
+    }
+    if (tail == 0) {
+        return;
+    }
+
+    // Ciphertext stealing: the last full block is processed first, and the
+    // tail of the result is appended to the partial block, which is then
+    // processed in place of the last full block.  Decryption has to undo the
+    // second step first, so it uses the two tweaks in reverse order.
+    uint8_t last_full_tweak[16];
+    uint8_t partial_tweak[16];
+    store_tweak(last_full_tweak, t);
+    mul_x(t);
+    store_tweak(partial_tweak, t);
+    if (!encrypt) {
+        std::swap(last_full_tweak, partial_tweak);
+    }
+
+    auto crypt_block = [&](const uint8_t *block_in, const uint8_t *block_tweak,
+                           uint8_t *block_out) {
+        uint8_t block[16];
+        for (size_t j = 0; j < 16; j++) {
+            block[j] = block_in[j] ^ block_tweak[j];
+        }
+        if (encrypt) {
+            data_cipher->encrypt_block(block, block);
+        } else {
+            data_cipher->decrypt_block(block, block);
+        }
+        for (size_t j = 0; j < 16; j++) {
+            block_out[j] = block[j] ^ block_tweak[j];
+        }
+    };
+
+    uint8_t stolen[16];
+    uint8_t last[16];
+    crypt_block(in, last_full_tweak, stolen);
+    memcpy(last, in + 16, tail);
+    memcpy(last + tail, stolen + tail, 16 - tail);
+    memcpy(out + 16, stolen, tail);
+    crypt_block(last, partial_tweak, out);
+}
+
+void AESXTSImpl::encrypt(const memslice tweak, const memslice input,
+                         memslice output) const {
+    crypt(tweak, input, output, true);
+}
+
+void AESXTSImpl::decrypt(const memslice tweak, const memslice input,
+                         memslice output) const {
+    crypt(tweak, input, output, false);
+}
+
+}
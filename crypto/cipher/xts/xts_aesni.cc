@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// AES-XTS using AES-NI, compiled with -maes.
+
+#include "crypto/cipher/xts.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include <wmmintrin.h>
+
+namespace crypto {
+
+namespace {
+
+inline __m128i load_block(const uint8_t *ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+
+inline void store_block(uint8_t *ptr, __m128i block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr), block);
+}
+
+/**
+ * Multiply the tweak by x in GF(2^128) modulo x^128 + x^7 + x^2 + x + 1.  The
+ * tweak is a little-endian 128-bit integer, so this is a left shift by one
+ * bit with the bit shifted out of the top folded back as 0x87.  SSE has no
+ * 128-bit shift, so every 32-bit lane is shifted separately, and the bits
+ * shifted out of each lane are moved into the next one: the arithmetic shift
+ * turns the top bit of each lane into a mask, the shuffle rotates the masks
+ * by one lane, and the masks select either the carry bit or the reduction
+ * constant.
+ */
+inline __m128i mul_x(__m128i tweak) {
+    const __m128i carry_bits = _mm_set_epi32(1, 1, 1, 0x87);
+    __m128i carry = _mm_srai_epi32(tweak, 31);
+    carry = _mm_shuffle_epi32(carry, _MM_SHUFFLE(2, 1, 0, 3));
+    carry = _mm_and_si128(carry, carry_bits);
+    return _mm_xor_si128(_mm_add_epi32(tweak, tweak), carry);
+}
+
+/**
+ * The state shared by the encryption and decryption routines.
+ */
+struct XTSContext {
+    const __m128i *rk;
+    size_t nrounds;
+    bool encrypt;
+
+    // Tweak of the next block
+    __m128i tweak;
+
+    inline __m128i next_tweak() {
+        __m128i current = tweak;
+        tweak = mul_x(tweak);
+        return current;
+    }
+
+    // Encrypt or decrypt a single block with the specified tweak
+    inline __m128i crypt_block(__m128i block, __m128i t) const {
+        block = _mm_xor_si128(_mm_xor_si128(block, t), rk[0]);
+        if (encrypt) {
+            for (size_t i = 1; i < nrounds; i++) {
+                block = _mm_aesenc_si128(block, rk[i]);
+            }
+            block = _mm_aesenclast_si128(block, rk[nrounds]);
+        } else {
+            for (size_t i = 1; i < nrounds; i++) {
+                block = _mm_aesdec_si128(block, rk[i]);
+            }
+            block = _mm_aesdeclast_si128(block, rk[nrounds]);
+        }
+        return _mm_xor_si128(block, t);
+    }
+
+    // Encrypt or decrypt eight consecutive blocks.  The tweaks are computed
+    // while the first round keys are applied, and kept in registers until
+    // the output is produced.
+    inline void crypt8(const uint8_t *in, uint8_t *out) {
+        __m128i tweaks[8];
+        __m128i blocks[8];
+        for (size_t j = 0; j < 8; j++) {
+            tweaks[j] = next_tweak();
+            blocks[j] = _mm_xor_si128(load_block(in + j * 16), tweaks[j]);
+            blocks[j] = _mm_xor_si128(blocks[j], rk[0]);
+        }
+        if (encrypt) {
+            for (size_t i = 1; i < nrounds; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    blocks[j] = _mm_aesenc_si128(blocks[j], rk[i]);
+                }
+            }
+            for (size_t j = 0; j < 8; j++) {
+                blocks[j] = _mm_aesenclast_si128(blocks[j], rk[nrounds]);
+            }
+        } else {
+            for (size_t i = 1; i < nrounds; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    blocks[j] = _mm_aesdec_si128(blocks[j], rk[i]);
+                }
+            }
+            for (size_t j = 0; j < 8; j++) {
+                blocks[j] = _mm_aesdeclast_si128(blocks[j], rk[nrounds]);
+            }
+        }
+        for (size_t j = 0; j < 8; j++) {
+            store_block(out + j * 16, _mm_xor_si128(blocks[j], tweaks[j]));
+        }
+    }
+
+    void crypt(const uint8_t *in, uint8_t *out, size_t len) {
+        size_t num_blocks = len / 16;
+        size_t tail = len % 16;
+
+        // With ciphertext stealing, the last full block is processed together
+        // with the partial one
+        size_t bulk_blocks = tail > 0 ? num_blocks - 1 : num_blocks;
+
+        size_t i = 0;
+        for (; i + 8 <= bulk_blocks; i += 8) {
+            crypt8(in, out);
+            in += 8 * 16;
+            out += 8 * 16;
+        }
+        for (; i < bulk_blocks; i++) {
+            store_block(out, crypt_block(load_block(in), next_tweak()));
+            in += 16;
+            out += 16;
+        }
+        if (tail == 0) {
+            return;
+        }
+
+        // Ciphertext stealing: the last full block is processed first, and
+        // the tail of the result is appended to the partial block, which is
+        // then processed in place of the last full block.  Decryption has to
+        // undo the second step first, so it uses the two tweaks in reverse
+        // order.
+        __m128i last_full_tweak = next_tweak();
+        __m128i partial_tweak = next_tweak();
+        if (!encrypt) {
+            std::swap(last_full_tweak, partial_tweak);
+        }
+
+        uint8_t stolen[16];
+        uint8_t last[16];
+        store_block(stolen, crypt_block(load_block(in), last_full_tweak));
+        memcpy(last, in + 16, tail);
+        memcpy(last + tail, stolen + tail, 16 - tail);
+        memcpy(out + 16, stolen, tail);
+        store_block(out, crypt_block(load_block(last), partial_tweak));
+    }
+};
+
+}
+
+AESNIXTS::AESNIXTS(const memslice key)
+    : data_cipher(cmem(key.cptr(), key.size() / 2)),
+      tweak_cipher(cmem(key.cptr() + key.size() / 2, key.size() / 2)) {
+    contract_assert(is_valid_key_size(key.size()));
+}
+
+void AESNIXTS::encrypt(const memslice tweak, const memslice input,
+                       memslice output) const {
+    contract_assert(tweak.size() == 16);
+    contract_assert(input.size() >= 16);
+    contract_assert(output.size() == input.size());
+
+    XTSContext ctx;
+    ctx.rk = reinterpret_cast<const __m128i *>(data_cipher.enc_round_keys);
+    ctx.nrounds = data_cipher.nrounds;
+    ctx.encrypt = true;
+
+    uint8_t initial_tweak[16];
+    tweak_cipher.encrypt_block(tweak.cptr(), initial_tweak);
+    ctx.tweak = load_block(initial_tweak);
+
+    ctx.crypt(input.cptr(), output.ptr(), input.size());
+}
+
+void AESNIXTS::decrypt(const memslice tweak, const memslice input,
+                       memslice output) const {
+    contract_assert(tweak.size() == 16);
+    contract_assert(input.size() >= 16);
+    contract_assert(output.size() == input.size());
+
+    XTSContext ctx;
+    ctx.rk = reinterpret_cast<const __m128i *>(data_cipher.dec_round_keys);
+    ctx.nrounds = data_cipher.nrounds;
+    ctx.encrypt = false;
+
+    uint8_t initial_tweak[16];
+    tweak_cipher.encrypt_block(tweak.cptr(), initial_tweak);
+    ctx.tweak = load_block(initial_tweak);
+
+    ctx.crypt(input.cptr(), output.ptr(), input.size());
+}
+
+}
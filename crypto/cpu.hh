@@ -5,6 +5,8 @@
 #ifndef __CRYPTO_CPU_HH
 #define __CRYPTO_CPU_HH
 
+#include <stdint.h>
+
 #include <string>
 
 namespace crypto {
@@ -15,6 +17,53 @@ class CPU {
   // Constructor
   CPU();
 
+  // Queries the processor and reports the features in |disabled_features|,
+  // a mask of Feature values, as missing, like DisableFeatures() does for
+  // Get().
+  explicit CPU(uint32_t disabled_features);
+
+  // Returns the information for the processor the process runs on, which is
+  // queried the first time this is called and cached from then on. CPUID is
+  // slow, and much slower under virtualization, so this is what the
+  // factories should use instead of constructing a CPU every time.
+  //
+  // The features disabled with DisableFeatures() or listed in the
+  // LIBSEAL_DISABLE_CPU_FEATURES environment variable, separated by commas
+  // (like "avx2,aesni"), are reported as missing, so that the fallback
+  // implementations can be tested and benchmarked on any machine.
+  static const CPU& Get();
+
+  // Features which can be disabled, as a bit mask.
+  enum Feature {
+    FEATURE_SSE2 = 1 << 0,
+    FEATURE_SSSE3 = 1 << 1,
+    FEATURE_SSE41 = 1 << 2,
+    FEATURE_SSE42 = 1 << 3,
+    FEATURE_AVX = 1 << 4,
+    FEATURE_AVX2 = 1 << 5,
+    FEATURE_AESNI = 1 << 6,
+    FEATURE_PCLMULQDQ = 1 << 7,
+    FEATURE_BMI2 = 1 << 8,
+    FEATURE_ADX = 1 << 9,
+    FEATURE_SHA = 1 << 10,
+    FEATURE_VAES = 1 << 11,
+    FEATURE_VPCLMULQDQ = 1 << 12,
+  };
+
+  // Makes Get() report the features in |features| as missing. Disabling a
+  // feature also disables everything which builds on it, so that the result
+  // looks like an older processor: each of SSE2, SSSE3, SSE4.1, SSE4.2 and
+  // AVX needs the ones before it; AVX2, VAES and VPCLMULQDQ need AVX; the
+  // SHA extensions need SSSE3 and SSE4.1; VAES needs AES-NI and VPCLMULQDQ
+  // needs PCLMULQDQ. This has to be called before the first call to Get(),
+  // which any factory makes, and returns false if it was too late.
+  static bool DisableFeatures(uint32_t features);
+
+  // Parses a list of feature names separated by commas, as in the
+  // environment variable, into a mask of Feature values. Unknown names are
+  // ignored.
+  static uint32_t ParseFeatureList(const std::string& list);
+
   enum IntelMicroArchitecture {
     PENTIUM,
     SSE,
@@ -50,7 +99,17 @@ class CPU {
   // Note: you should never need to call this function. It was added in order
   // to workaround a bug in NSS but |has_avx()| is what you want.
   bool has_avx_hardware() const { return has_avx_hardware_; }
+  // AVX2, VAES and VPCLMULQDQ are reported only when |has_avx()| is true,
+  // since they need the same operating system support.
+  bool has_avx2() const { return has_avx2_; }
   bool has_aesni() const { return has_aesni_; }
+  bool has_pclmulqdq() const { return has_pclmulqdq_; }
+  bool has_bmi2() const { return has_bmi2_; }
+  bool has_adx() const { return has_adx_; }
+  // The SHA extensions, which despite the name only cover SHA-1 and SHA-256.
+  bool has_sha() const { return has_sha_; }
+  bool has_vaes() const { return has_vaes_; }
+  bool has_vpclmulqdq() const { return has_vpclmulqdq_; }
   bool has_non_stop_time_stamp_counter() const {
     return has_non_stop_time_stamp_counter_;
   }
@@ -61,6 +120,9 @@ class CPU {
   // Query the processor for CPUID information.
   void Initialize();
 
+  // Clear the flags of the features in |features|.
+  void Mask(uint32_t features);
+
   int signature_;  // raw form of type, family, model, and stepping
   int type_;  // process type
   int family_;  // family of the processor
@@ -77,7 +139,14 @@ class CPU {
   bool has_sse42_;
   bool has_avx_;
   bool has_avx_hardware_;
+  bool has_avx2_;
   bool has_aesni_;
+  bool has_pclmulqdq_;
+  bool has_bmi2_;
+  bool has_adx_;
+  bool has_sha_;
+  bool has_vaes_;
+  bool has_vpclmulqdq_;
   bool has_non_stop_time_stamp_counter_;
   std::string cpu_vendor_;
   std::string cpu_brand_;
@@ -0,0 +1,42 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// The implementations which use instruction set extensions live in their own
+// source files, built with the matching -m flags from the CMakeLists.txt next
+// to them.  The compiler may then use those extensions anywhere in the file,
+// so nothing in it may be called unless CPU::Get() reports every one of them,
+// and the factory which selects such an implementation checks exactly the
+// extensions named in the flags.  The header of each file only lists its
+// flags.
+//
+// Headers with code shared between such files, like the SHA round functions,
+// keep it in an anonymous namespace.  Otherwise each file would emit its own
+// copy of an inline function, compiled for its own extensions, and the linker
+// could keep one which uses instructions the CPU does not have.
+
+#ifndef __CRYPTO_DISPATCH_HH
+#define __CRYPTO_DISPATCH_HH
+
+namespace crypto {
+
+/**
+ * Construct |Impl| from |args| on the heap, and return it as |Base|.
+ *
+ * The factories which pick the implementation of an algorithm depending on
+ * the CPU keep a pointer to an instance of this function in a function-local
+ * static.  It is resolved from CPU::Get() the first time the factory is
+ * called, and reused from then on, so that neither the CPU nor the choice are
+ * queried again.
+ */
+template <typename Base, typename Impl, typename... Args>
+Base *construct(Args... args) {
+    return new Impl(args...);
+}
+
+}
+
+#endif /* __CRYPTO_DISPATCH_HH */
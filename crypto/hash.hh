@@ -7,13 +7,41 @@
 
 namespace crypto {
 
+class HashFunction;
+typedef std::unique_ptr<HashFunction> HashFunction_u;
+
+/**
+ * A hash output of |N| bytes held by value, so that hashing many short
+ * messages does not need a heap allocation for every result.
+ */
+template <size_t N>
+struct Digest {
+    uint8_t bytes[N];
+
+    inline constexpr size_t size() const { return N; }
+    inline memslice mem() { return memslice(bytes, N); }
+    inline const memslice cmem() const { return crypto::cmem(bytes, N); }
+
+    inline bool operator==(const Digest &other) const {
+        return cmem().eq(other.cmem());
+    }
+    inline bool operator!=(const Digest &other) const {
+        return !(*this == other);
+    }
+};
+
 /**
  * Common interface for all hash functions.  The data is inputted by calling
- * update(); calling finish() causes the hash for all data inputted so far to
- * be returned.
+ * update(); calling finish() or finish_into() causes the hash for all data
+ * inputted so far to be returned.
  */
 class HashFunction {
   public:
+    /**
+     * The longest output of any hash function, for buffers on the stack.
+     */
+    static constexpr size_t max_output_size = 64;
+
     virtual ~HashFunction() {};
 
     /**
@@ -38,14 +66,44 @@ class HashFunction {
     virtual void update(const memslice data) = 0;
 
     /**
-     * Finish computation of the hash function and return the output.  May
+     * Finish computation of the hash function and write the output into
+     * |output|, which has to be exactly get_output_size() bytes long.  May
      * change the state of the hash, so, if hash needs to be continued later,
-     * the caller should copy the hash state into another object.
+     * the caller should use finish_copy() or clone() instead.
+     */
+    virtual void finish_into(memslice output) = 0;
+
+    /**
+     * Like finish_into(), but return the output in a new bytestring.
+     */
+    bytestring_u finish() {
+        bytestring_u result = bytestring_u(new bytestring(get_output_size()));
+        finish_into(result->mem());
+        return result;
+    }
+
+    /**
+     * Return an independent copy of the hash, including all data inputted so
+     * far.  The copy uses the same implementation of the compression
+     * function.
+     */
+    virtual HashFunction_u clone() const = 0;
+
+    /**
+     * Replace the state of the hash with that of |other|, which has to be
+     * this object or a clone of it.  Unlike clone(), does not allocate.
      */
-    virtual bytestring_u finish() = 0;
+    virtual void assign(const HashFunction &other) = 0;
+
+    /**
+     * Return the hash of all data inputted so far without changing the state,
+     * so that more data can be fed in afterwards.
+     */
+    bytestring_u finish_copy() const {
+        return clone()->finish();
+    }
 };
 
-typedef std::unique_ptr<HashFunction> HashFunction_u;
 typedef std::function<HashFunction_u()> HashFunctionFactory;
 
 inline bytestring_u hash(HashFunctionFactory HFF, const memslice data) {
@@ -55,13 +113,22 @@ inline bytestring_u hash(HashFunctionFactory HFF, const memslice data) {
 }
 
 /**
- * Implements hash-based MAC as described in RFC 2104.
+ * Implements hash-based MAC as described in RFC 2104.  The hash states after
+ * the padded key are computed once, so one object can MAC any number of
+ * messages with the same key, calling reset() between them.
  */
 class HMAC {
   private:
+    // The states after the key XORed with ipad and opad was processed
+    HashFunction_u inner_key_hash;
+    HashFunction_u outer_key_hash;
+
+    // Copies of the above for the current message, created on first use
     HashFunction_u inner_hash;
     HashFunction_u outer_hash;
 
+    void create_working_hashes();
+
   public:
     /**
      * Create an HMAC using hash function |hash| and key |key|.
@@ -74,17 +141,37 @@ class HMAC {
     void update(const memslice data);
 
     /**
-     * Finish computing the MAC and return it.  May change the state of the
-     * hash.
+     * Return the length of the MAC, which is the output size of the hash.
+     */
+    size_t get_output_size() const {
+        return outer_key_hash->get_output_size();
+    }
+
+    /**
+     * Finish computing the MAC and write it into |output|, which has to be
+     * exactly get_output_size() bytes long.  Does not allocate.  May change
+     * the state of the hash, so reset() has to be called before the next
+     * message.
+     */
+    void finish_into(memslice output);
+
+    /**
+     * Like finish_into(), but return the MAC in a new bytestring.
      */
     bytestring_u finish();
+
+    /**
+     * Start a new message with the same key.
+     */
+    void reset();
 };
 
-inline bytestring_u hmac(HashFunctionFactory HFF, const memslice key, const memslice data) {
-    HMAC mac(HFF, key);
-    mac.update(data);
-    return mac.finish();
-}
+/**
+ * Compute the HMAC of a single message.  Uses the keyed hash states directly,
+ * without the copies an HMAC object needs for reset().
+ */
+bytestring_u hmac(HashFunctionFactory HFF, const memslice key,
+                  const memslice data);
 
 }
 
@@ -1,53 +1,115 @@
 #include "crypto/hash.hh"
 
+#include <algorithm>
 #include <cstring>
 
 namespace crypto {
 
+constexpr size_t HashFunction::max_output_size;
+
+namespace {
+
+/**
+ * Feed |block_size| bytes of |key| XORed with |padding|, with the key padded
+ * with zeros, into |hash|.  Goes in pieces, so that no buffer for a whole
+ * block is needed.
+ */
 template <uint8_t padding>
-static inline void copy_and_pad(const memslice in_mem, memslice out_mem) {
-    size_t i = 0;
-    const uint8_t *in = in_mem.cptr();
-    uint8_t *out = out_mem.ptr();
+void update_padded(HashFunction &hash, const memslice key,
+                   size_t block_size) {
+    const uint8_t *in = key.cptr();
+    uint8_t piece[64];
 
-    for (; i < in_mem.size(); i++) {
-        out[i] = in[i] ^ padding;
+    for (size_t offset = 0; offset < block_size; offset += sizeof(piece)) {
+        size_t len = std::min(sizeof(piece), block_size - offset);
+        for (size_t i = 0; i < len; i++) {
+            piece[i] = offset + i < key.size() ? in[offset + i] ^ padding
+                                               : padding;
+        }
+        hash.update(cmem(piece, len));
     }
+}
 
-    for (; i < out_mem.size(); i++) {
-        out[i] = padding;
+/**
+ * Process the padded key in |inner| and |outer|, which have to be fresh
+ * hashes, one a clone of the other.  A key longer than the block is hashed
+ * first, in |outer| before it is needed.
+ */
+void absorb_key(const memslice key, HashFunction &inner,
+                HashFunction &outer) {
+    contract_assert(inner.get_output_size() <= HashFunction::max_output_size);
+
+    size_t block_size = inner.get_block_size();
+    uint8_t hashed_key[HashFunction::max_output_size];
+    memslice real_key = key;
+    if (key.size() > block_size) {
+        outer.update(key);
+        real_key = mem(hashed_key, outer.get_output_size());
+        outer.finish_into(real_key);
+        outer.assign(inner);
     }
+
+    update_padded<0x36>(inner, real_key, block_size);
+    update_padded<0x5c>(outer, real_key, block_size);
 }
 
-HMAC::HMAC(HashFunctionFactory HFF, const memslice key) {
-    inner_hash = HFF();
-    outer_hash = HFF();
+void finish_hmac(HashFunction &inner, HashFunction &outer, memslice output) {
+    uint8_t inner_hash_value[HashFunction::max_output_size];
+    memslice value = mem(inner_hash_value, inner.get_output_size());
+    inner.finish_into(value);
+    outer.update(value);
+    outer.finish_into(output);
+}
 
-    size_t block_size = inner_hash->get_block_size();
-    bytestring inner_padded_key(block_size);
-    bytestring outer_padded_key(block_size);
+}
 
-    if (key.size() > block_size) {
-        bytestring_u real_key = hash(HFF, key);
-        copy_and_pad<0x36>(real_key->cmem(), inner_padded_key.mem());
-        copy_and_pad<0x5c>(real_key->cmem(), outer_padded_key.mem());
-    } else {
-        copy_and_pad<0x36>(key, inner_padded_key.mem());
-        copy_and_pad<0x5c>(key, outer_padded_key.mem());
-    }
+HMAC::HMAC(HashFunctionFactory HFF, const memslice key) {
+    inner_key_hash = HFF();
+    outer_key_hash = inner_key_hash->clone();
+    absorb_key(key, *inner_key_hash, *outer_key_hash);
+}
 
-    inner_hash->update(inner_padded_key.cmem());
-    outer_hash->update(outer_padded_key.cmem());
+void HMAC::create_working_hashes() {
+    if (inner_hash == nullptr) {
+        inner_hash = inner_key_hash->clone();
+        outer_hash = outer_key_hash->clone();
+    }
 }
 
 void HMAC::update(const memslice data) {
+    create_working_hashes();
     inner_hash->update(data);
 }
 
+void HMAC::finish_into(memslice output) {
+    create_working_hashes();
+    finish_hmac(*inner_hash, *outer_hash, output);
+}
+
 bytestring_u HMAC::finish() {
-    bytestring_u inner_hash_value = inner_hash->finish();
-    outer_hash->update(inner_hash_value->cmem());
-    return outer_hash->finish();
+    bytestring_u result = bytestring_u(new bytestring(get_output_size()));
+    finish_into(result->mem());
+    return result;
+}
+
+void HMAC::reset() {
+    if (inner_hash != nullptr) {
+        inner_hash->assign(*inner_key_hash);
+        outer_hash->assign(*outer_key_hash);
+    }
+}
+
+bytestring_u hmac(HashFunctionFactory HFF, const memslice key,
+                  const memslice data) {
+    HashFunction_u inner = HFF();
+    HashFunction_u outer = inner->clone();
+    absorb_key(key, *inner, *outer);
+    inner->update(data);
+
+    bytestring_u result =
+        bytestring_u(new bytestring(outer->get_output_size()));
+    finish_hmac(*inner, *outer, result->mem());
+    return result;
 }
 
 }
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// The driver shared by the SHA-1 and SHA-2 implementations which compute the
+// message schedule in vector registers while the scalar rounds run: after
+// each group of rounds, the words needed |lookahead| groups later are
+// computed.  The vector code and the rounds use different execution units,
+// so the schedule comes almost for free.
+//
+// Included from files built for different instruction sets, so it is all in
+// an anonymous namespace, as explained in crypto/dispatch.hh.
+
+#ifndef __CRYPTO_HASH_INTERLEAVED_ROUNDS_HH
+#define __CRYPTO_HASH_INTERLEAVED_ROUNDS_HH
+
+namespace crypto {
+
+namespace {
+
+/**
+ * Calls |schedule|.step<g>() if group |g| is one of the |groups| groups of
+ * the schedule; the step is never even instantiated otherwise.
+ */
+template <int g, int groups, bool needed = (g < groups)>
+struct ScheduleStep {
+    template <class Schedule>
+    static inline void run(Schedule &schedule) {
+        schedule.template step<g>();
+    }
+};
+
+template <int g, int groups>
+struct ScheduleStep<g, groups, false> {
+    template <class Schedule>
+    static inline void run(Schedule &) {}
+};
+
+/**
+ * A schedule which has already been computed in full, as for the second of
+ * two blocks scheduled together.
+ */
+struct NoSchedule {
+    template <int g>
+    inline void step() {}
+};
+
+/**
+ * Runs groups |g| to |groups| - 1 of the rounds with |Group|::run<g>(v, wk),
+ * calling |schedule|.step<g + lookahead>() after group g.  Everything is
+ * unrolled, so that the round constants and the indices into the rotating
+ * working variables are known at compile time.
+ */
+template <class Group, int g, int groups, int lookahead>
+struct InterleavedRounds {
+    template <class Word, class Schedule>
+    static inline void run(Word *v, const Word *wk, Schedule &schedule) {
+        Group::template run<g>(v, wk);
+        ScheduleStep<g + lookahead, groups>::run(schedule);
+        InterleavedRounds<Group, g + 1, groups, lookahead>::run(v, wk,
+                                                                schedule);
+    }
+};
+
+template <class Group, int groups, int lookahead>
+struct InterleavedRounds<Group, groups, groups, lookahead> {
+    template <class Word, class Schedule>
+    static inline void run(Word *, const Word *, Schedule &) {}
+};
+
+}
+
+}
+
+#endif /* __CRYPTO_HASH_INTERLEAVED_ROUNDS_HH */
@@ -23,6 +23,19 @@ class MD5Base : public HashFunction {
 typedef std::unique_ptr<MD5Base> MD5Base_u;
 MD5Base_u MD5();
 
+typedef Digest<16> MD5Digest;
+
+/**
+ * Hash |data| in one go.  Unlike going through MD5(), does not allocate.
+ */
+MD5Digest md5_digest(const memslice data);
+
+/**
+ * Run the MD5 compression function over |num_blocks| consecutive 64-byte
+ * blocks of |data|, updating the four-word |state|.  Does not do any padding.
+ */
+void md5_compress(uint32_t *state, const uint8_t *data, size_t num_blocks);
+
 class MD5Impl : public MD5Base {
   private:
     unsigned int sz[2];
@@ -35,7 +48,9 @@ class MD5Impl : public MD5Base {
     MD5Impl();
 
     virtual void update(const memslice data) override;
-    virtual bytestring_u finish() override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
 };
 
 }
@@ -35,6 +35,8 @@
 // some platform-specific hacks and big-endian support removed.
 
 #include "crypto/hash/md5.hh"
+#include "crypto/hash/md5/md5_t.hh"
+#include "crypto/assert.hh"
 
 #include <algorithm>
 #include <cstring>
@@ -45,6 +47,33 @@ MD5Base_u MD5() {
     return MD5Base_u(new MD5Impl());
 }
 
+MD5Digest md5_digest(const memslice data) {
+    MD5Impl hash;
+    hash.update(data);
+    MD5Digest digest;
+    hash.finish_into(digest.mem());
+    return digest;
+}
+
+const uint32_t md5_t[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
 static inline uint32_t
 cshift (uint32_t x, unsigned int n)
 {
@@ -80,8 +109,8 @@ a = b + cshift(a + OP(b,c,d) + X[k] + (i), s)
 #define DO3(a,b,c,d,k,s,i) DOIT(a,b,c,d,k,s,i,H)
 #define DO4(a,b,c,d,k,s,i) DOIT(a,b,c,d,k,s,i,I)
 
-void
-MD5Impl::calc (uint32_t *data)
+static void
+md5_block (uint32_t *counter, const uint32_t *data)
 {
   uint32_t AA, BB, CC, DD;
 
@@ -92,91 +121,91 @@ MD5Impl::calc (uint32_t *data)
 
   /* Round 1 */
 
-  DO1(A,B,C,D,0,7,0xd76aa478);
-  DO1(D,A,B,C,1,12,0xe8c7b756);
-  DO1(C,D,A,B,2,17,0x242070db);
-  DO1(B,C,D,A,3,22,0xc1bdceee);
+  DO1(A,B,C,D,0,7,md5_t[0]);
+  DO1(D,A,B,C,1,12,md5_t[1]);
+  DO1(C,D,A,B,2,17,md5_t[2]);
+  DO1(B,C,D,A,3,22,md5_t[3]);
 
-  DO1(A,B,C,D,4,7,0xf57c0faf);
-  DO1(D,A,B,C,5,12,0x4787c62a);
-  DO1(C,D,A,B,6,17,0xa8304613);
-  DO1(B,C,D,A,7,22,0xfd469501);
+  DO1(A,B,C,D,4,7,md5_t[4]);
+  DO1(D,A,B,C,5,12,md5_t[5]);
+  DO1(C,D,A,B,6,17,md5_t[6]);
+  DO1(B,C,D,A,7,22,md5_t[7]);
 
-  DO1(A,B,C,D,8,7,0x698098d8);
-  DO1(D,A,B,C,9,12,0x8b44f7af);
-  DO1(C,D,A,B,10,17,0xffff5bb1);
-  DO1(B,C,D,A,11,22,0x895cd7be);
+  DO1(A,B,C,D,8,7,md5_t[8]);
+  DO1(D,A,B,C,9,12,md5_t[9]);
+  DO1(C,D,A,B,10,17,md5_t[10]);
+  DO1(B,C,D,A,11,22,md5_t[11]);
 
-  DO1(A,B,C,D,12,7,0x6b901122);
-  DO1(D,A,B,C,13,12,0xfd987193);
-  DO1(C,D,A,B,14,17,0xa679438e);
-  DO1(B,C,D,A,15,22,0x49b40821);
+  DO1(A,B,C,D,12,7,md5_t[12]);
+  DO1(D,A,B,C,13,12,md5_t[13]);
+  DO1(C,D,A,B,14,17,md5_t[14]);
+  DO1(B,C,D,A,15,22,md5_t[15]);
 
   /* Round 2 */
 
-  DO2(A,B,C,D,1,5,0xf61e2562);
-  DO2(D,A,B,C,6,9,0xc040b340);
-  DO2(C,D,A,B,11,14,0x265e5a51);
-  DO2(B,C,D,A,0,20,0xe9b6c7aa);
+  DO2(A,B,C,D,1,5,md5_t[16]);
+  DO2(D,A,B,C,6,9,md5_t[17]);
+  DO2(C,D,A,B,11,14,md5_t[18]);
+  DO2(B,C,D,A,0,20,md5_t[19]);
 
-  DO2(A,B,C,D,5,5,0xd62f105d);
-  DO2(D,A,B,C,10,9,0x2441453);
-  DO2(C,D,A,B,15,14,0xd8a1e681);
-  DO2(B,C,D,A,4,20,0xe7d3fbc8);
+  DO2(A,B,C,D,5,5,md5_t[20]);
+  DO2(D,A,B,C,10,9,md5_t[21]);
+  DO2(C,D,A,B,15,14,md5_t[22]);
+  DO2(B,C,D,A,4,20,md5_t[23]);
 
-  DO2(A,B,C,D,9,5,0x21e1cde6);
-  DO2(D,A,B,C,14,9,0xc33707d6);
-  DO2(C,D,A,B,3,14,0xf4d50d87);
-  DO2(B,C,D,A,8,20,0x455a14ed);
+  DO2(A,B,C,D,9,5,md5_t[24]);
+  DO2(D,A,B,C,14,9,md5_t[25]);
+  DO2(C,D,A,B,3,14,md5_t[26]);
+  DO2(B,C,D,A,8,20,md5_t[27]);
 
-  DO2(A,B,C,D,13,5,0xa9e3e905);
-  DO2(D,A,B,C,2,9,0xfcefa3f8);
-  DO2(C,D,A,B,7,14,0x676f02d9);
-  DO2(B,C,D,A,12,20,0x8d2a4c8a);
+  DO2(A,B,C,D,13,5,md5_t[28]);
+  DO2(D,A,B,C,2,9,md5_t[29]);
+  DO2(C,D,A,B,7,14,md5_t[30]);
+  DO2(B,C,D,A,12,20,md5_t[31]);
 
   /* Round 3 */
 
-  DO3(A,B,C,D,5,4,0xfffa3942);
-  DO3(D,A,B,C,8,11,0x8771f681);
-  DO3(C,D,A,B,11,16,0x6d9d6122);
-  DO3(B,C,D,A,14,23,0xfde5380c);
+  DO3(A,B,C,D,5,4,md5_t[32]);
+  DO3(D,A,B,C,8,11,md5_t[33]);
+  DO3(C,D,A,B,11,16,md5_t[34]);
+  DO3(B,C,D,A,14,23,md5_t[35]);
 
-  DO3(A,B,C,D,1,4,0xa4beea44);
-  DO3(D,A,B,C,4,11,0x4bdecfa9);
-  DO3(C,D,A,B,7,16,0xf6bb4b60);
-  DO3(B,C,D,A,10,23,0xbebfbc70);
+  DO3(A,B,C,D,1,4,md5_t[36]);
+  DO3(D,A,B,C,4,11,md5_t[37]);
+  DO3(C,D,A,B,7,16,md5_t[38]);
+  DO3(B,C,D,A,10,23,md5_t[39]);
 
-  DO3(A,B,C,D,13,4,0x289b7ec6);
-  DO3(D,A,B,C,0,11,0xeaa127fa);
-  DO3(C,D,A,B,3,16,0xd4ef3085);
-  DO3(B,C,D,A,6,23,0x4881d05);
+  DO3(A,B,C,D,13,4,md5_t[40]);
+  DO3(D,A,B,C,0,11,md5_t[41]);
+  DO3(C,D,A,B,3,16,md5_t[42]);
+  DO3(B,C,D,A,6,23,md5_t[43]);
 
-  DO3(A,B,C,D,9,4,0xd9d4d039);
-  DO3(D,A,B,C,12,11,0xe6db99e5);
-  DO3(C,D,A,B,15,16,0x1fa27cf8);
-  DO3(B,C,D,A,2,23,0xc4ac5665);
+  DO3(A,B,C,D,9,4,md5_t[44]);
+  DO3(D,A,B,C,12,11,md5_t[45]);
+  DO3(C,D,A,B,15,16,md5_t[46]);
+  DO3(B,C,D,A,2,23,md5_t[47]);
 
   /* Round 4 */
 
-  DO4(A,B,C,D,0,6,0xf4292244);
-  DO4(D,A,B,C,7,10,0x432aff97);
-  DO4(C,D,A,B,14,15,0xab9423a7);
-  DO4(B,C,D,A,5,21,0xfc93a039);
+  DO4(A,B,C,D,0,6,md5_t[48]);
+  DO4(D,A,B,C,7,10,md5_t[49]);
+  DO4(C,D,A,B,14,15,md5_t[50]);
+  DO4(B,C,D,A,5,21,md5_t[51]);
 
-  DO4(A,B,C,D,12,6,0x655b59c3);
-  DO4(D,A,B,C,3,10,0x8f0ccc92);
-  DO4(C,D,A,B,10,15,0xffeff47d);
-  DO4(B,C,D,A,1,21,0x85845dd1);
+  DO4(A,B,C,D,12,6,md5_t[52]);
+  DO4(D,A,B,C,3,10,md5_t[53]);
+  DO4(C,D,A,B,10,15,md5_t[54]);
+  DO4(B,C,D,A,1,21,md5_t[55]);
 
-  DO4(A,B,C,D,8,6,0x6fa87e4f);
-  DO4(D,A,B,C,15,10,0xfe2ce6e0);
-  DO4(C,D,A,B,6,15,0xa3014314);
-  DO4(B,C,D,A,13,21,0x4e0811a1);
+  DO4(A,B,C,D,8,6,md5_t[56]);
+  DO4(D,A,B,C,15,10,md5_t[57]);
+  DO4(C,D,A,B,6,15,md5_t[58]);
+  DO4(B,C,D,A,13,21,md5_t[59]);
 
-  DO4(A,B,C,D,4,6,0xf7537e82);
-  DO4(D,A,B,C,11,10,0xbd3af235);
-  DO4(C,D,A,B,2,15,0x2ad7d2bb);
-  DO4(B,C,D,A,9,21,0xeb86d391);
+  DO4(A,B,C,D,4,6,md5_t[60]);
+  DO4(D,A,B,C,11,10,md5_t[61]);
+  DO4(C,D,A,B,2,15,md5_t[62]);
+  DO4(B,C,D,A,9,21,md5_t[63]);
 
   A += AA;
   B += BB;
@@ -184,6 +213,22 @@ MD5Impl::calc (uint32_t *data)
   D += DD;
 }
 
+void
+MD5Impl::calc (uint32_t *data)
+{
+  md5_block(counter, data);
+}
+
+void
+md5_compress (uint32_t *state, const uint8_t *data, size_t num_blocks)
+{
+  uint32_t in[16];
+  for (size_t i = 0; i < num_blocks; i++) {
+    memcpy(in, data + 64 * i, 64);
+    md5_block(state, in);
+  }
+}
+
 /*
  * From `Performance analysis of MD5' by Joseph D. Touch <touch@isi.edu>
  */
@@ -215,9 +260,11 @@ MD5Impl::update(const memslice data)
   }
 }
 
-bytestring_u
-MD5Impl::finish ()
+void
+MD5Impl::finish_into (memslice output)
 {
+  contract_assert(output.size() == 16);
+
   unsigned char zeros[72];
   unsigned offset = (sz[0] / 8) % 64;
   unsigned int dstart = (120 - offset - 1) % 64 + 1;
@@ -234,8 +281,7 @@ MD5Impl::finish ()
   zeros[dstart+7] = (sz[1] >> 24) & 0xff;
   update(mem(zeros, dstart + 8));
 
-  bytestring_u result{new bytestring(16)};
-  unsigned char *r = result->ptr();
+  unsigned char *r = output.ptr();
 
   for (int i = 0; i < 4; ++i) {
       r[4*i]   = counter[i] & 0xFF;
@@ -243,8 +289,20 @@ MD5Impl::finish ()
       r[4*i+2] = (counter[i] >> 16) & 0xFF;
       r[4*i+3] = (counter[i] >> 24) & 0xFF;
   }
+}
 
-  return result;
+HashFunction_u
+MD5Impl::clone () const
+{
+  return HashFunction_u(new MD5Impl(*this));
+}
+
+void
+MD5Impl::assign (const HashFunction &other)
+{
+  const MD5Impl *source = dynamic_cast<const MD5Impl *>(&other);
+  contract_assert(source != nullptr);
+  *this = *source;
 }
 
 }
@@ -0,0 +1,23 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#ifndef __CRYPTO_HASH_MD5_MD5_T_HH
+#define __CRYPTO_HASH_MD5_MD5_T_HH
+
+#include <cstdint>
+
+namespace crypto {
+
+/**
+ * The MD5 sine table T[1..64] of RFC 1321, indexed from zero, shared by the
+ * scalar and the multi-buffer implementations.
+ */
+extern const uint32_t md5_t[64];
+
+}
+
+#endif /* __CRYPTO_HASH_MD5_MD5_T_HH */
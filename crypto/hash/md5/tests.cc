@@ -84,6 +84,29 @@ TEST(MD5, RFC2202Vectors) {
     }
 }
 
+TEST(MD5, FinishCopy) {
+    crypto::HashFunction_u hash = defaultImpl();
+    hash->update(crypto::cmem("a", 1));
+    EXPECT_EQ(*crypto::hash(defaultImpl, crypto::cmem("a", 1)),
+              *hash->finish_copy());
+
+    crypto::HashFunction_u copy = hash->clone();
+    hash->update(crypto::cmem("bc", 2));
+    EXPECT_EQ(*crypto::hash(defaultImpl, crypto::cmem("abc", 3)),
+              *hash->finish_copy());
+    EXPECT_EQ(*crypto::hash(defaultImpl, crypto::cmem("a", 1)),
+              *copy->finish());
+}
+
+TEST(MD5, Digest) {
+    for (const RFCVector &vector : RFCVectors) {
+        crypto::MD5Digest digest = crypto::md5_digest(
+            crypto::cmem(vector.input, strlen(vector.input)));
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.output),
+                  crypto::bytestring(digest.cmem()));
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
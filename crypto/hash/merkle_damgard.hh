@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#ifndef __CRYPTO_HASH_MERKLE_DAMGARD_HH
+#define __CRYPTO_HASH_MERKLE_DAMGARD_HH
+
+#include "crypto/common.hh"
+
+#include <algorithm>
+
+namespace crypto {
+
+/**
+ * The buffering and padding of the hash functions built from a compression
+ * function with the Merkle-Damgard construction: SHA-1 and the SHA-2
+ * family.  Whole blocks of the input are passed to the compression function
+ * directly, without copying them.
+ *
+ * The state is |state_words| big-endian words of type |Word|, and the
+ * padding is a one bit, zeros up to |length_size| bytes short of a whole
+ * |block_size|-byte block and the message length in bits as a big-endian
+ * |length_size|-byte number.
+ */
+template <class Word, size_t state_words, size_t block_size,
+          size_t length_size>
+class MerkleDamgard {
+  public:
+    typedef void (*CompressFunction)(Word *state, const uint8_t *data,
+                                     size_t num_blocks);
+
+  private:
+    CompressFunction compress;
+    uint64_t length;
+    Word state[state_words];
+    uint8_t buffer[block_size];
+
+  public:
+    /**
+     * Start from |iv|, or continue from a state reached after |length| bytes
+     * of input, which have to be a whole number of blocks, as after the key
+     * block of HMAC.
+     */
+    MerkleDamgard(CompressFunction compress, const Word *iv,
+                  uint64_t length = 0)
+        : compress(compress), length(length) {
+        std::copy(iv, iv + state_words, state);
+    }
+
+    void update(const memslice data) {
+        const uint8_t *ptr = data.cptr();
+        size_t len = data.size();
+        size_t buffered = length % block_size;
+        length += len;
+
+        if (buffered > 0) {
+            size_t fill = std::min(len, block_size - buffered);
+            memcpy(buffer + buffered, ptr, fill);
+            ptr += fill;
+            len -= fill;
+            if (buffered + fill < block_size) {
+                return;
+            }
+            compress(state, buffer, 1);
+        }
+
+        compress(state, ptr, len / block_size);
+        memcpy(buffer, ptr + len - len % block_size, len % block_size);
+    }
+
+    /**
+     * Pad the message and write the first |output_words| words of the state
+     * to |output|.
+     */
+    void finish(uint8_t *output, size_t output_words) {
+        static_assert(length_size == 8 || length_size == 16,
+                      "the length is a 64-bit or 128-bit number");
+
+        uint64_t bits_high = length >> 61;
+        uint64_t bits_low = length << 3;
+        uint8_t padding[block_size + length_size] = { 0x80 };
+        size_t padding_len = block_size - (length + length_size) % block_size;
+        uint8_t *length_field = padding + padding_len;
+        for (size_t i = 0; i < 8; i++) {
+            if (length_size == 16) {
+                length_field[i] = bits_high >> (56 - 8 * i);
+            }
+            length_field[length_size - 8 + i] = bits_low >> (56 - 8 * i);
+        }
+        update(cmem(padding, padding_len + length_size));
+
+        for (size_t i = 0; i < output_words; i++) {
+            for (size_t j = 0; j < sizeof(Word); j++) {
+                output[sizeof(Word) * i + j] =
+                    state[i] >> (8 * (sizeof(Word) - 1 - j));
+            }
+        }
+    }
+};
+
+}
+
+#endif /* __CRYPTO_HASH_MERKLE_DAMGARD_HH */
@@ -0,0 +1,159 @@
+#ifndef __CRYPTO_HASH_MULTIBUFFER_HH
+#define __CRYPTO_HASH_MULTIBUFFER_HH
+
+#include "crypto/hash.hh"
+
+namespace crypto {
+
+/**
+ * Hashes many independent messages at once.  A single message is a chain of
+ * dependent compression function calls, which leaves most of the execution
+ * units of the CPU idle; here each lane of a vector register hashes a
+ * different message, so that four or eight of them progress in the time of
+ * one.  This pays off for batches of short messages, like per-record MACs or
+ * certificate fingerprints, which are all available at the same time.
+ */
+class MultiBufferHash {
+  public:
+    virtual ~MultiBufferHash() {}
+
+    /**
+     * The name of the hash function, like "MD5" or "SHA1".
+     */
+    virtual const char *get_name() const = 0;
+
+    /**
+     * Return the length of hash function's output.
+     */
+    virtual size_t get_output_size() const = 0;
+
+    /**
+     * The number of messages which are hashed in parallel.
+     */
+    virtual size_t get_lanes() const = 0;
+
+    /**
+     * Hash each of the |count| |inputs| into the corresponding element of
+     * |outputs|, which must be get_output_size() bytes long.  The messages
+     * may have any lengths; whenever one is done, the next one is started in
+     * its lane.
+     */
+    virtual void hash_batch(const memslice *inputs, memslice *outputs,
+                            size_t count) = 0;
+};
+
+typedef std::unique_ptr<MultiBufferHash> MultiBufferHash_u;
+MultiBufferHash_u MD5MultiBuffer();
+MultiBufferHash_u SHA1MultiBuffer();
+
+/**
+ * Runs the compression function over |num_blocks| consecutive blocks in
+ * each lane, lane k reading them from |data[k]|.  The state is stored word
+ * by word, with word i of lane k at state[i * lanes + k].
+ */
+typedef void (*LanesFunction)(uint32_t *state, const uint8_t *const *data,
+                              size_t num_blocks);
+
+/**
+ * The lane functions.  The portable ones have a single lane and call
+ * md5_compress() and sha1_compress(); the other ones may only be called if
+ * the CPU has the instructions they need.
+ */
+void md5_lanes_portable(uint32_t *state, const uint8_t *const *data,
+                        size_t num_blocks);
+void md5_lanes_ssse3(uint32_t *state, const uint8_t *const *data,
+                     size_t num_blocks);
+void md5_lanes_avx2(uint32_t *state, const uint8_t *const *data,
+                    size_t num_blocks);
+void sha1_lanes_portable(uint32_t *state, const uint8_t *const *data,
+                         size_t num_blocks);
+void sha1_lanes_ssse3(uint32_t *state, const uint8_t *const *data,
+                      size_t num_blocks);
+void sha1_lanes_avx2(uint32_t *state, const uint8_t *const *data,
+                     size_t num_blocks);
+
+/**
+ * Schedules the messages onto the lanes of a LanesFunction, and does the
+ * padding and the output for a Merkle-Damgård hash with 64-byte blocks.
+ */
+class MultiBufferLanes : public MultiBufferHash {
+  public:
+    struct Algorithm {
+        const char *name;
+        size_t output_size;
+        const uint32_t *iv;
+        bool big_endian;
+
+        /**
+         * The single-message compression function, used for the last message
+         * when the other lanes have run out.
+         */
+        void (*compress)(uint32_t *state, const uint8_t *data,
+                         size_t num_blocks);
+    };
+
+    static constexpr size_t max_lanes = 8;
+
+  private:
+    const Algorithm &algorithm;
+    LanesFunction lanes_function;
+    size_t lanes;
+
+  protected:
+    MultiBufferLanes(const Algorithm &algorithm, LanesFunction lanes_function,
+                     size_t lanes);
+
+  public:
+    virtual const char *get_name() const override { return algorithm.name; }
+    virtual size_t get_output_size() const override {
+        return algorithm.output_size;
+    }
+    virtual size_t get_lanes() const override { return lanes; }
+
+    virtual void hash_batch(const memslice *inputs, memslice *outputs,
+                            size_t count) override;
+};
+
+class MD5MultiBufferBase : public MultiBufferLanes {
+  protected:
+    MD5MultiBufferBase(LanesFunction lanes_function, size_t lanes);
+};
+
+class MD5MultiBufferImpl : public MD5MultiBufferBase {
+  public:
+    MD5MultiBufferImpl() : MD5MultiBufferBase(md5_lanes_portable, 1) {}
+};
+
+class MD5MultiBufferSSSE3 : public MD5MultiBufferBase {
+  public:
+    MD5MultiBufferSSSE3() : MD5MultiBufferBase(md5_lanes_ssse3, 4) {}
+};
+
+class MD5MultiBufferAVX2 : public MD5MultiBufferBase {
+  public:
+    MD5MultiBufferAVX2() : MD5MultiBufferBase(md5_lanes_avx2, 8) {}
+};
+
+class SHA1MultiBufferBase : public MultiBufferLanes {
+  protected:
+    SHA1MultiBufferBase(LanesFunction lanes_function, size_t lanes);
+};
+
+class SHA1MultiBufferImpl : public SHA1MultiBufferBase {
+  public:
+    SHA1MultiBufferImpl() : SHA1MultiBufferBase(sha1_lanes_portable, 1) {}
+};
+
+class SHA1MultiBufferSSSE3 : public SHA1MultiBufferBase {
+  public:
+    SHA1MultiBufferSSSE3() : SHA1MultiBufferBase(sha1_lanes_ssse3, 4) {}
+};
+
+class SHA1MultiBufferAVX2 : public SHA1MultiBufferBase {
+  public:
+    SHA1MultiBufferAVX2() : SHA1MultiBufferBase(sha1_lanes_avx2, 8) {}
+};
+
+}
+
+#endif /* __CRYPTO_HASH_MULTIBUFFER_HH */
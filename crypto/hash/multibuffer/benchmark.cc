@@ -0,0 +1,90 @@
+#include "crypto/hash/multibuffer.hh"
+#include "crypto/hash/md5.hh"
+#include "crypto/hash/sha1.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+#include <vector>
+
+namespace {
+
+using crypto::bytestring;
+
+const size_t batch_size = 64;
+
+/**
+ * Hash |batch_size| messages of each size one after another with |single|.
+ */
+void benchmark_single(const char *desc, const char *operation,
+                      const crypto::HashFunctionFactory &single) {
+    for (size_t size : { 64, 256, 1024 }) {
+        std::vector<bytestring> messages(batch_size, bytestring(size));
+
+        crypto::report_benchmark(
+            desc, operation, size,
+            crypto::cycles_per_byte([&]() {
+                for (const bytestring &message : messages) {
+                    crypto::hash(single, message.cmem());
+                }
+            }, size * batch_size, 100));
+    }
+}
+
+/**
+ * Hash the same messages as a single batch with |multi|.
+ */
+void benchmark_multi(const char *desc, const char *operation,
+                     crypto::MultiBufferHash &&multi) {
+    for (size_t size : { 64, 256, 1024 }) {
+        std::vector<bytestring> messages(batch_size, bytestring(size));
+        std::vector<bytestring> digests(batch_size,
+                                        bytestring(multi.get_output_size()));
+        std::vector<crypto::memslice> inputs;
+        std::vector<crypto::memslice> outputs;
+        for (size_t i = 0; i < batch_size; i++) {
+            inputs.push_back(messages[i].cmem());
+            outputs.push_back(digests[i].mem());
+        }
+
+        crypto::report_benchmark(
+            desc, operation, size,
+            crypto::cycles_per_byte([&]() {
+                multi.hash_batch(inputs.data(), outputs.data(), batch_size);
+            }, size * batch_size, 100));
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    benchmark_single("MD5()", "MD5 x64", []() {
+        return crypto::HashFunction_u(crypto::MD5());
+    });
+    benchmark_multi("Portable", "MD5 x64", crypto::MD5MultiBufferImpl());
+    if (cpu.has_ssse3()) {
+        benchmark_multi("SSSE3, 4 lanes", "MD5 x64",
+                        crypto::MD5MultiBufferSSSE3());
+    }
+    if (cpu.has_avx2()) {
+        benchmark_multi("AVX2, 8 lanes", "MD5 x64",
+                        crypto::MD5MultiBufferAVX2());
+    }
+
+    benchmark_single("SHA1()", "SHA-1 x64", []() {
+        return crypto::HashFunction_u(crypto::SHA1());
+    });
+    benchmark_multi("Portable", "SHA-1 x64", crypto::SHA1MultiBufferImpl());
+    if (cpu.has_ssse3()) {
+        benchmark_multi("SSSE3, 4 lanes", "SHA-1 x64",
+                        crypto::SHA1MultiBufferSSSE3());
+    }
+    if (cpu.has_avx2()) {
+        benchmark_multi("AVX2, 8 lanes", "SHA-1 x64",
+                        crypto::SHA1MultiBufferAVX2());
+    }
+
+    return 0;
+}
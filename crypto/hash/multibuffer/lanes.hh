@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// MD5 and SHA-1 with one message per vector lane, written against a vector
+// type |V| which provides the lane-wise operations:
+//
+//   V::lanes                  number of 32-bit lanes
+//   V::add, xor_, and_, or_   lane-wise arithmetic
+//   V::set1(x)                |x| in all lanes
+//   V::rol<n>(x)              rotation left by |n| bits
+//   V::load, V::store         |lanes| consecutive words
+//   V::load_message(data, offset, w)
+//                             word i of the blocks at data[k] + offset into
+//                             lane k of w[i], for i = 0..15
+//   V::byte_swap(x)           reverse the bytes of each lane
+//
+// The kernels are instantiated in lanes_ssse3.cc and lanes_avx2.cc, each
+// compiled for its own instruction set, so they are kept in an anonymous
+// namespace, as explained in crypto/dispatch.hh.
+
+#ifndef __CRYPTO_HASH_MULTIBUFFER_LANES_HH
+#define __CRYPTO_HASH_MULTIBUFFER_LANES_HH
+
+#include "crypto/hash/md5/md5_t.hh"
+#include "crypto/hash/sha1/sha1_rounds.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crypto {
+
+namespace {
+
+constexpr int md5_shift[16] = {
+    7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21
+};
+
+constexpr int md5_word(int i) {
+    return i < 16 ? i :
+           i < 32 ? (5 * i + 1) % 16 :
+           i < 48 ? (3 * i + 5) % 16 :
+                    (7 * i) % 16;
+}
+
+/**
+ * MD5 step |i|.  The working variables rotate through |v| instead of being
+ * moved, so after inlining all indices are constants and |v| lives in
+ * registers.
+ */
+template <class V, int i>
+inline void md5_step(typename V::type *v, const typename V::type *x) {
+    typedef typename V::type type;
+    type &a = v[(4 - i % 4) % 4];
+    type &b = v[(5 - i % 4) % 4];
+    type &c = v[(6 - i % 4) % 4];
+    type &d = v[(7 - i % 4) % 4];
+
+    type f;
+    if (i < 16) {
+        f = V::xor_(d, V::and_(b, V::xor_(c, d)));
+    } else if (i < 32) {
+        f = V::xor_(c, V::and_(d, V::xor_(b, c)));
+    } else if (i < 48) {
+        f = V::xor_(V::xor_(b, c), d);
+    } else {
+        f = V::xor_(c, V::or_(b, V::xor_(d, V::set1(0xffffffff))));
+    }
+
+    type sum = V::add(V::add(a, f),
+                      V::add(x[md5_word(i)], V::set1(md5_t[i])));
+    a = V::add(b, V::template rol<md5_shift[(i / 16) * 4 + i % 4]>(sum));
+}
+
+template <class V, int i>
+struct MD5Steps {
+    static inline void run(typename V::type *v, const typename V::type *x) {
+        md5_step<V, i>(v, x);
+        MD5Steps<V, i + 1>::run(v, x);
+    }
+};
+
+template <class V>
+struct MD5Steps<V, 64> {
+    static inline void run(typename V::type *, const typename V::type *) {}
+};
+
+template <class V>
+void md5_lanes(uint32_t *state, const uint8_t *const *data,
+               size_t num_blocks) {
+    typedef typename V::type type;
+
+    type v[4];
+    for (size_t i = 0; i < 4; i++) {
+        v[i] = V::load(state + i * V::lanes);
+    }
+
+    for (size_t block = 0; block < num_blocks; block++) {
+        type x[16];
+        V::load_message(data, 64 * block, x);
+
+        type saved[4] = { v[0], v[1], v[2], v[3] };
+        MD5Steps<V, 0>::run(v, x);
+        for (size_t i = 0; i < 4; i++) {
+            v[i] = V::add(v[i], saved[i]);
+        }
+    }
+
+    for (size_t i = 0; i < 4; i++) {
+        V::store(state + i * V::lanes, v[i]);
+    }
+}
+
+/**
+ * SHA-1 round |t|, computing W[t] in place in the 16-word window |w|.
+ */
+template <class V, int t>
+inline void sha1_step(typename V::type *v, typename V::type *w) {
+    typedef typename V::type type;
+    type &a = v[(5 - t % 5) % 5];
+    type &b = v[(6 - t % 5) % 5];
+    type &c = v[(7 - t % 5) % 5];
+    type &d = v[(8 - t % 5) % 5];
+    type &e = v[(9 - t % 5) % 5];
+
+    if (t >= 16) {
+        type x = V::xor_(V::xor_(w[(t - 3) % 16], w[(t - 8) % 16]),
+                         V::xor_(w[(t - 14) % 16], w[t % 16]));
+        w[t % 16] = V::template rol<1>(x);
+    }
+
+    type f;
+    if (t < 20) {
+        f = V::xor_(d, V::and_(b, V::xor_(c, d)));
+    } else if (t < 40 || t >= 60) {
+        f = V::xor_(V::xor_(b, c), d);
+    } else {
+        f = V::or_(V::and_(b, c), V::and_(d, V::or_(b, c)));
+    }
+
+    type sum = V::add(V::add(V::template rol<5>(a), f),
+                      V::add(w[t % 16], V::set1(sha1_k[t / 20])));
+    e = V::add(e, sum);
+    b = V::template rol<30>(b);
+}
+
+template <class V, int t>
+struct SHA1Steps {
+    static inline void run(typename V::type *v, typename V::type *w) {
+        sha1_step<V, t>(v, w);
+        SHA1Steps<V, t + 1>::run(v, w);
+    }
+};
+
+template <class V>
+struct SHA1Steps<V, 80> {
+    static inline void run(typename V::type *, typename V::type *) {}
+};
+
+template <class V>
+void sha1_lanes(uint32_t *state, const uint8_t *const *data,
+                size_t num_blocks) {
+    typedef typename V::type type;
+
+    type v[5];
+    for (size_t i = 0; i < 5; i++) {
+        v[i] = V::load(state + i * V::lanes);
+    }
+
+    for (size_t block = 0; block < num_blocks; block++) {
+        type w[16];
+        V::load_message(data, 64 * block, w);
+        for (size_t i = 0; i < 16; i++) {
+            w[i] = V::byte_swap(w[i]);
+        }
+
+        type saved[5] = { v[0], v[1], v[2], v[3], v[4] };
+        SHA1Steps<V, 0>::run(v, w);
+        for (size_t i = 0; i < 5; i++) {
+            v[i] = V::add(v[i], saved[i]);
+        }
+    }
+
+    for (size_t i = 0; i < 5; i++) {
+        V::store(state + i * V::lanes, v[i]);
+    }
+}
+
+}
+
+}
+
+#endif /* __CRYPTO_HASH_MULTIBUFFER_LANES_HH */
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Eight-lane MD5 and SHA-1 using AVX2, compiled with -mavx2.
+
+#include "crypto/hash/multibuffer.hh"
+#include "crypto/hash/multibuffer/lanes.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+struct AVX2 {
+    typedef __m256i type;
+    static constexpr size_t lanes = 8;
+
+    static inline type add(type a, type b) { return _mm256_add_epi32(a, b); }
+    static inline type xor_(type a, type b) {
+        return _mm256_xor_si256(a, b);
+    }
+    static inline type and_(type a, type b) {
+        return _mm256_and_si256(a, b);
+    }
+    static inline type or_(type a, type b) { return _mm256_or_si256(a, b); }
+    static inline type set1(uint32_t x) { return _mm256_set1_epi32(x); }
+
+    template <int n>
+    static inline type rol(type x) {
+        return _mm256_or_si256(_mm256_slli_epi32(x, n),
+                               _mm256_srli_epi32(x, 32 - n));
+    }
+
+    static inline type load(const uint32_t *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+    static inline void store(uint32_t *p, type x) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), x);
+    }
+
+    /**
+     * Load eight words of each lane and transpose them: first four words of
+     * four lanes within each 128-bit half, then the halves.
+     */
+    static inline void load_message(const uint8_t *const *data,
+                                    size_t offset, type *w) {
+        for (size_t i = 0; i < 16; i += 8) {
+            type r[8];
+            for (size_t k = 0; k < 8; k++) {
+                r[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                    data[k] + offset + 4 * i));
+            }
+
+            type u[8];
+            for (size_t k = 0; k < 8; k += 4) {
+                type t0 = _mm256_unpacklo_epi32(r[k], r[k + 1]);
+                type t1 = _mm256_unpacklo_epi32(r[k + 2], r[k + 3]);
+                type t2 = _mm256_unpackhi_epi32(r[k], r[k + 1]);
+                type t3 = _mm256_unpackhi_epi32(r[k + 2], r[k + 3]);
+                u[k + 0] = _mm256_unpacklo_epi64(t0, t1);
+                u[k + 1] = _mm256_unpackhi_epi64(t0, t1);
+                u[k + 2] = _mm256_unpacklo_epi64(t2, t3);
+                u[k + 3] = _mm256_unpackhi_epi64(t2, t3);
+            }
+
+            // u[j] holds words j and j + 4 of lanes 0-3, u[j + 4] the same
+            // words of lanes 4-7
+            for (size_t j = 0; j < 4; j++) {
+                w[i + j] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x20);
+                w[i + j + 4] =
+                    _mm256_permute2x128_si256(u[j], u[j + 4], 0x31);
+            }
+        }
+    }
+
+    static inline type byte_swap(type x) {
+        return _mm256_shuffle_epi8(
+            x, _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7,
+                               0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11,
+                               4, 5, 6, 7, 0, 1, 2, 3));
+    }
+};
+
+}
+
+void md5_lanes_avx2(uint32_t *state, const uint8_t *const *data,
+                    size_t num_blocks) {
+    md5_lanes<AVX2>(state, data, num_blocks);
+}
+
+void sha1_lanes_avx2(uint32_t *state, const uint8_t *const *data,
+                     size_t num_blocks) {
+    sha1_lanes<AVX2>(state, data, num_blocks);
+}
+
+}
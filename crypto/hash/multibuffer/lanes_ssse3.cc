@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// Four-lane MD5 and SHA-1 using SSSE3, compiled with -mssse3.
+
+#include "crypto/hash/multibuffer.hh"
+#include "crypto/hash/multibuffer/lanes.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+struct SSSE3 {
+    typedef __m128i type;
+    static constexpr size_t lanes = 4;
+
+    static inline type add(type a, type b) { return _mm_add_epi32(a, b); }
+    static inline type xor_(type a, type b) { return _mm_xor_si128(a, b); }
+    static inline type and_(type a, type b) { return _mm_and_si128(a, b); }
+    static inline type or_(type a, type b) { return _mm_or_si128(a, b); }
+    static inline type set1(uint32_t x) { return _mm_set1_epi32(x); }
+
+    template <int n>
+    static inline type rol(type x) {
+        return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+    }
+
+    static inline type load(const uint32_t *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+    static inline void store(uint32_t *p, type x) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), x);
+    }
+
+    /**
+     * Load four words of each lane and transpose them.
+     */
+    static inline void load_message(const uint8_t *const *data,
+                                    size_t offset, type *w) {
+        for (size_t i = 0; i < 16; i += 4) {
+            type r0 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data[0] + offset + 4 * i));
+            type r1 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data[1] + offset + 4 * i));
+            type r2 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data[2] + offset + 4 * i));
+            type r3 = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(data[3] + offset + 4 * i));
+
+            type t0 = _mm_unpacklo_epi32(r0, r1);
+            type t1 = _mm_unpacklo_epi32(r2, r3);
+            type t2 = _mm_unpackhi_epi32(r0, r1);
+            type t3 = _mm_unpackhi_epi32(r2, r3);
+            w[i + 0] = _mm_unpacklo_epi64(t0, t1);
+            w[i + 1] = _mm_unpackhi_epi64(t0, t1);
+            w[i + 2] = _mm_unpacklo_epi64(t2, t3);
+            w[i + 3] = _mm_unpackhi_epi64(t2, t3);
+        }
+    }
+
+    static inline type byte_swap(type x) {
+        return _mm_shuffle_epi8(x, _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                                4, 5, 6, 7, 0, 1, 2, 3));
+    }
+};
+
+}
+
+void md5_lanes_ssse3(uint32_t *state, const uint8_t *const *data,
+                     size_t num_blocks) {
+    md5_lanes<SSSE3>(state, data, num_blocks);
+}
+
+void sha1_lanes_ssse3(uint32_t *state, const uint8_t *const *data,
+                      size_t num_blocks) {
+    sha1_lanes<SSSE3>(state, data, num_blocks);
+}
+
+}
@@ -0,0 +1,264 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/hash/multibuffer.hh"
+#include "crypto/hash/md5.hh"
+#include "crypto/hash/sha1.hh"
+#include "crypto/assert.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace crypto {
+
+constexpr size_t MultiBufferLanes::max_lanes;
+
+namespace {
+
+const uint32_t md5_iv[4] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
+const MultiBufferLanes::Algorithm md5_algorithm = {
+    "MD5", 16, md5_iv, false, md5_compress
+};
+
+const MultiBufferLanes::Algorithm sha1_algorithm = {
+    "SHA1", 20, sha1_iv, true, sha1_compress
+};
+
+/**
+ * A message in a lane.  It is hashed in two segments: the whole blocks of
+ * the message itself, read in place, and then the last partial block with
+ * the padding, one or two blocks copied into |tail|.
+ */
+struct Lane {
+    bool active;
+    size_t message;
+    const uint8_t *data;
+    size_t blocks;
+    bool in_tail;
+    size_t tail_blocks;
+    uint8_t tail[128];
+};
+
+void store_word(uint8_t *output, uint32_t word, bool big_endian) {
+    for (size_t i = 0; i < 4; i++) {
+        output[i] = word >> (big_endian ? 24 - 8 * i : 8 * i);
+    }
+}
+
+void start_message(const MultiBufferLanes::Algorithm &algorithm, Lane &lane,
+                   size_t message, const memslice input, uint32_t *state,
+                   size_t lanes, size_t k) {
+    size_t len = input.size();
+    size_t rest = len % 64;
+
+    lane.active = true;
+    lane.message = message;
+    lane.data = input.cptr();
+    lane.blocks = len / 64;
+    lane.in_tail = false;
+
+    // The length in bits follows the 0x80 byte and the zeros, in the last
+    // eight bytes of the last block
+    lane.tail_blocks = rest + 9 > 64 ? 2 : 1;
+    size_t tail_len = 64 * lane.tail_blocks;
+    if (rest > 0) {
+        memcpy(lane.tail, input.cptr() + len - rest, rest);
+    }
+    lane.tail[rest] = 0x80;
+    memset(lane.tail + rest + 1, 0, tail_len - rest - 1);
+    uint64_t bits = static_cast<uint64_t>(len) * 8;
+    for (size_t i = 0; i < 8; i++) {
+        size_t shift = algorithm.big_endian ? 56 - 8 * i : 8 * i;
+        lane.tail[tail_len - 8 + i] = bits >> shift;
+    }
+
+    if (lane.blocks == 0) {
+        lane.in_tail = true;
+        lane.data = lane.tail;
+        lane.blocks = lane.tail_blocks;
+    }
+
+    for (size_t i = 0; i < algorithm.output_size / 4; i++) {
+        state[i * lanes + k] = algorithm.iv[i];
+    }
+}
+
+void finish_message(const MultiBufferLanes::Algorithm &algorithm,
+                    const Lane &lane, const uint32_t *state, size_t lanes,
+                    size_t k, memslice *outputs) {
+    uint8_t *output = outputs[lane.message].ptr();
+    for (size_t i = 0; i < algorithm.output_size / 4; i++) {
+        store_word(output + 4 * i, state[i * lanes + k], algorithm.big_endian);
+    }
+}
+
+typedef MultiBufferHash *(*MultiBufferConstructor)();
+
+MultiBufferConstructor select_md5_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_avx2()) {
+        return construct<MultiBufferHash, MD5MultiBufferAVX2>;
+    }
+    if (cpu.has_ssse3()) {
+        return construct<MultiBufferHash, MD5MultiBufferSSSE3>;
+    }
+
+    return construct<MultiBufferHash, MD5MultiBufferImpl>;
+}
+
+MultiBufferConstructor select_sha1_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_avx2()) {
+        return construct<MultiBufferHash, SHA1MultiBufferAVX2>;
+    }
+    // One message at a time with the SHA extensions beats four lanes of
+    // SSSE3; the portable lane function goes through sha1_compress()
+    if (cpu.has_ssse3() && !cpu.has_sha()) {
+        return construct<MultiBufferHash, SHA1MultiBufferSSSE3>;
+    }
+
+    return construct<MultiBufferHash, SHA1MultiBufferImpl>;
+}
+
+}
+
+MultiBufferHash_u MD5MultiBuffer() {
+    static const MultiBufferConstructor constructor =
+        select_md5_implementation();
+    return MultiBufferHash_u(constructor());
+}
+
+MultiBufferHash_u SHA1MultiBuffer() {
+    static const MultiBufferConstructor constructor =
+        select_sha1_implementation();
+    return MultiBufferHash_u(constructor());
+}
+
+void md5_lanes_portable(uint32_t *state, const uint8_t *const *data,
+                        size_t num_blocks) {
+    md5_compress(state, data[0], num_blocks);
+}
+
+void sha1_lanes_portable(uint32_t *state, const uint8_t *const *data,
+                         size_t num_blocks) {
+    sha1_compress(state, data[0], num_blocks);
+}
+
+MultiBufferLanes::MultiBufferLanes(const Algorithm &algorithm,
+                                   LanesFunction lanes_function, size_t lanes)
+    : algorithm(algorithm), lanes_function(lanes_function), lanes(lanes) {
+    contract_assert(lanes >= 1 && lanes <= max_lanes);
+}
+
+void MultiBufferLanes::hash_batch(const memslice *inputs, memslice *outputs,
+                                  size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        contract_assert(outputs[i].size() == algorithm.output_size);
+    }
+
+    // The idle lanes still run the compression function on their state, so
+    // it is never left uninitialized
+    Lane lane[max_lanes];
+    uint32_t state[5 * max_lanes] = {};
+    const uint8_t *data[max_lanes];
+    size_t next_message = 0;
+    size_t active = 0;
+
+    for (size_t k = 0; k < lanes; k++) {
+        lane[k].active = next_message < count;
+        if (lane[k].active) {
+            start_message(algorithm, lane[k], next_message,
+                          inputs[next_message], state, lanes, k);
+            next_message++;
+            active++;
+        }
+    }
+
+    while (active > 0) {
+        // Once the last message is alone, the other lanes would only do
+        // wasted work, so it is finished on its own
+        if (active == 1 && next_message == count && lanes > 1) {
+            size_t k = 0;
+            while (!lane[k].active) {
+                k++;
+            }
+
+            uint32_t single[5];
+            for (size_t i = 0; i < algorithm.output_size / 4; i++) {
+                single[i] = state[i * lanes + k];
+            }
+            algorithm.compress(single, lane[k].data, lane[k].blocks);
+            if (!lane[k].in_tail) {
+                algorithm.compress(single, lane[k].tail, lane[k].tail_blocks);
+            }
+            finish_message(algorithm, lane[k], single, 1, 0, outputs);
+            break;
+        }
+
+        // Run all lanes up to the end of the shortest segment; the idle ones
+        // read the data of an active one, and their result is ignored
+        size_t num_blocks = SIZE_MAX;
+        const uint8_t *filler = nullptr;
+        for (size_t k = 0; k < lanes; k++) {
+            if (lane[k].active) {
+                num_blocks = std::min(num_blocks, lane[k].blocks);
+                filler = lane[k].data;
+            }
+        }
+        for (size_t k = 0; k < lanes; k++) {
+            data[k] = lane[k].active ? lane[k].data : filler;
+        }
+
+        lanes_function(state, data, num_blocks);
+
+        for (size_t k = 0; k < lanes; k++) {
+            if (!lane[k].active) {
+                continue;
+            }
+
+            lane[k].data += 64 * num_blocks;
+            lane[k].blocks -= num_blocks;
+            if (lane[k].blocks > 0) {
+                continue;
+            }
+
+            if (!lane[k].in_tail) {
+                lane[k].in_tail = true;
+                lane[k].data = lane[k].tail;
+                lane[k].blocks = lane[k].tail_blocks;
+                continue;
+            }
+
+            finish_message(algorithm, lane[k], state, lanes, k, outputs);
+            if (next_message < count) {
+                start_message(algorithm, lane[k], next_message,
+                              inputs[next_message], state, lanes, k);
+                next_message++;
+            } else {
+                lane[k].active = false;
+                active--;
+            }
+        }
+    }
+}
+
+MD5MultiBufferBase::MD5MultiBufferBase(LanesFunction lanes_function,
+                                       size_t lanes)
+    : MultiBufferLanes(md5_algorithm, lanes_function, lanes) {}
+
+SHA1MultiBufferBase::SHA1MultiBufferBase(LanesFunction lanes_function,
+                                         size_t lanes)
+    : MultiBufferLanes(sha1_algorithm, lanes_function, lanes) {}
+
+}
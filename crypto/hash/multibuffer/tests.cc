@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#include "crypto/hash/multibuffer.hh"
+#include "crypto/hash/md5.hh"
+#include "crypto/hash/sha1.hh"
+#include "crypto/cpu.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include <random>
+
+namespace {
+
+/**
+ * Hash a batch of messages whose lengths cover all the padding cases, in an
+ * order which makes the lanes retire at different times, and compare each
+ * digest against the single-message implementation.
+ */
+void test_batch(crypto::MultiBufferHash &multi,
+                const crypto::HashFunctionFactory &single) {
+    std::mt19937 rng(20);
+    std::vector<crypto::bytestring> messages;
+    for (size_t len = 0; len < 200; len++) {
+        messages.push_back(crypto::random_bytes(rng, len));
+        messages.push_back(crypto::random_bytes(rng, (len * 37) % 1000));
+    }
+
+    // Batches of every size up to a few times the number of lanes
+    for (size_t count : { 0, 1, 2, 3, 5, 8, 9, 17, 400 }) {
+        std::vector<crypto::memslice> inputs;
+        std::vector<crypto::bytestring> digests;
+        std::vector<crypto::memslice> outputs;
+        for (size_t i = 0; i < count; i++) {
+            inputs.push_back(messages[i].cmem());
+            digests.push_back(crypto::bytestring(multi.get_output_size()));
+        }
+        for (size_t i = 0; i < count; i++) {
+            outputs.push_back(digests[i].mem());
+        }
+
+        multi.hash_batch(inputs.data(), outputs.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(*crypto::hash(single, inputs[i]), digests[i])
+                << multi.get_lanes() << " lanes, batch of " << count
+                << ", message " << i << " of length " << inputs[i].size();
+        }
+    }
+}
+
+const crypto::HashFunctionFactory md5 = []() {
+    return crypto::MD5Base_u(new crypto::MD5Impl());
+};
+
+const crypto::HashFunctionFactory sha1 = []() {
+    return crypto::SHA1Base_u(new crypto::SHA1Impl());
+};
+
+}
+
+TEST(MultiBuffer, MD5Portable) {
+    crypto::MD5MultiBufferImpl multi;
+    test_batch(multi, md5);
+}
+
+TEST(MultiBuffer, MD5SSSE3) {
+    crypto::CPU cpu;
+    if (!cpu.has_ssse3()) {
+        return;
+    }
+
+    crypto::MD5MultiBufferSSSE3 multi;
+    test_batch(multi, md5);
+}
+
+TEST(MultiBuffer, MD5AVX2) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2()) {
+        return;
+    }
+
+    crypto::MD5MultiBufferAVX2 multi;
+    test_batch(multi, md5);
+}
+
+TEST(MultiBuffer, SHA1Portable) {
+    crypto::SHA1MultiBufferImpl multi;
+    test_batch(multi, sha1);
+}
+
+TEST(MultiBuffer, SHA1SSSE3) {
+    crypto::CPU cpu;
+    if (!cpu.has_ssse3()) {
+        return;
+    }
+
+    crypto::SHA1MultiBufferSSSE3 multi;
+    test_batch(multi, sha1);
+}
+
+TEST(MultiBuffer, SHA1AVX2) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2()) {
+        return;
+    }
+
+    crypto::SHA1MultiBufferAVX2 multi;
+    test_batch(multi, sha1);
+}
+
+TEST(MultiBuffer, Factories) {
+    crypto::MultiBufferHash_u md5_multi = crypto::MD5MultiBuffer();
+    EXPECT_STREQ("MD5", md5_multi->get_name());
+    EXPECT_EQ(16u, md5_multi->get_output_size());
+    test_batch(*md5_multi, md5);
+
+    crypto::MultiBufferHash_u sha1_multi = crypto::SHA1MultiBuffer();
+    EXPECT_STREQ("SHA1", sha1_multi->get_name());
+    EXPECT_EQ(20u, sha1_multi->get_output_size());
+    test_batch(*sha1_multi, sha1);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,129 @@
+#ifndef __CRYPTO_HASH_POLY1305_HH
+#define __CRYPTO_HASH_POLY1305_HH
+
+#include "crypto/common.hh"
+
+#include <functional>
+
+namespace crypto {
+
+/**
+ * Base class for implementations of Poly1305, the one-time authenticator
+ * specified in RFC 8439.  The 32-byte key consists of the evaluation point r
+ * and the pad s, and MUST never be used for more than one message.  The data
+ * is inputted by calling update(); finish() produces the 16-byte tag.
+ *
+ * The implementations only provide the arithmetic on 16-byte blocks; the
+ * base class takes care of buffering the partial blocks.
+ */
+class Poly1305Base {
+  private:
+    uint8_t buffer[16];
+    size_t buffered;
+
+  protected:
+    /**
+     * Process |num_blocks| 16-byte blocks of |data|.  |final| is set for the
+     * last partial block, which is already padded with 0x01 and zeros, and
+     * so does not get the implicit 2^128 added.
+     */
+    virtual void blocks(const uint8_t *data, size_t num_blocks,
+                        bool final) = 0;
+
+    /**
+     * Reduce the accumulator, add the pad and write the tag into |tag|.
+     */
+    virtual void emit(uint8_t *tag) = 0;
+
+  public:
+    Poly1305Base() : buffered(0) {};
+    virtual ~Poly1305Base() {};
+
+    virtual const char *get_impl_desc() const = 0;
+
+    static size_t get_key_size() {
+        return 32;
+    }
+
+    static size_t get_tag_size() {
+        return 16;
+    }
+
+    /**
+     * Feed data into the MAC.
+     */
+    void update(const memslice data);
+
+    /**
+     * Finish computing the MAC and write the 16-byte tag into |tag|.  The
+     * object may not be used afterwards.
+     */
+    void finish(uint8_t *tag);
+};
+
+typedef std::unique_ptr<Poly1305Base> Poly1305Base_u;
+typedef std::function<Poly1305Base_u(const memslice)> Poly1305Factory;
+Poly1305Base_u Poly1305(const memslice key);
+
+/**
+ * Portable implementation which keeps the accumulator in five 26-bit limbs,
+ * so that all products fit into 64 bits.
+ */
+class Poly1305Radix26 : public Poly1305Base {
+  private:
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+
+  protected:
+    virtual void blocks(const uint8_t *data, size_t num_blocks,
+                        bool final) override;
+    virtual void emit(uint8_t *tag) override;
+
+  public:
+    Poly1305Radix26(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "Poly1305 (26-bit limbs)";
+    }
+};
+
+#if defined(__SIZEOF_INT128__)
+
+/**
+ * Implementation for 64-bit platforms which keeps the accumulator in two
+ * 64-bit limbs plus two extra bits, using 64x64->128-bit multiplications.  It
+ * needs four multiplications per block instead of 25.
+ */
+class Poly1305Radix64 : public Poly1305Base {
+  private:
+    uint64_t r[2];
+    uint64_t h[3];
+    uint64_t pad[2];
+
+  protected:
+    virtual void blocks(const uint8_t *data, size_t num_blocks,
+                        bool final) override;
+    virtual void emit(uint8_t *tag) override;
+
+  public:
+    Poly1305Radix64(const memslice key);
+
+    virtual const char *get_impl_desc() const override {
+        return "Poly1305 (64-bit limbs)";
+    }
+};
+
+// The fastest implementation the compiler can provide, for the constructions
+// which keep the MAC on the stack
+typedef Poly1305Radix64 Poly1305Native;
+
+#else
+
+typedef Poly1305Radix26 Poly1305Native;
+
+#endif
+
+}
+
+#endif /* __CRYPTO_HASH_POLY1305_HH */
@@ -0,0 +1,273 @@
+#include "crypto/hash/poly1305.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace crypto {
+
+Poly1305Base_u Poly1305(const memslice key) {
+    return Poly1305Base_u(new Poly1305Native(key));
+}
+
+namespace {
+
+inline uint32_t load_le32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+           (uint32_t(p[3]) << 24);
+}
+
+inline void store_le32(uint8_t *p, uint32_t x) {
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+}
+
+void Poly1305Base::update(const memslice data) {
+    const uint8_t *ptr = data.cptr();
+    size_t len = data.size();
+
+    if (buffered > 0) {
+        size_t fill = std::min(len, 16 - buffered);
+        memcpy(buffer + buffered, ptr, fill);
+        buffered += fill;
+        ptr += fill;
+        len -= fill;
+        if (buffered < 16) {
+            return;
+        }
+        blocks(buffer, 1, false);
+        buffered = 0;
+    }
+
+    if (len >= 16) {
+        blocks(ptr, len / 16, false);
+        ptr += len - len % 16;
+        len %= 16;
+    }
+
+    memcpy(buffer, ptr, len);
+    buffered = len;
+}
+
+void Poly1305Base::finish(uint8_t *tag) {
+    if (buffered > 0) {
+        buffer[buffered] = 1;
+        std::fill(buffer + buffered + 1, buffer + 16, 0);
+        blocks(buffer, 1, true);
+    }
+    emit(tag);
+}
+
+Poly1305Radix26::Poly1305Radix26(const memslice key) {
+    contract_assert(key.size() == get_key_size());
+    const uint8_t *k = key.cptr();
+
+    // r is clamped as required by the specification
+    r[0] = (load_le32(k + 0)) & 0x3ffffff;
+    r[1] = (load_le32(k + 3) >> 2) & 0x3ffff03;
+    r[2] = (load_le32(k + 6) >> 4) & 0x3ffc0ff;
+    r[3] = (load_le32(k + 9) >> 6) & 0x3f03fff;
+    r[4] = (load_le32(k + 12) >> 8) & 0x00fffff;
+
+    for (size_t i = 0; i < 5; i++) {
+        h[i] = 0;
+    }
+    for (size_t i = 0; i < 4; i++) {
+        pad[i] = load_le32(k + 16 + 4 * i);
+    }
+}
+
+void Poly1305Radix26::blocks(const uint8_t *data, size_t num_blocks,
+                             bool final) {
+    const uint32_t mask = 0x3ffffff;
+    const uint32_t hibit = final ? 0 : (1 << 24);
+
+    uint32_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+    uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+    for (size_t i = 0; i < num_blocks; i++, data += 16) {
+        // h += m
+        h0 += (load_le32(data + 0)) & mask;
+        h1 += (load_le32(data + 3) >> 2) & mask;
+        h2 += (load_le32(data + 6) >> 4) & mask;
+        h3 += (load_le32(data + 9) >> 6) & mask;
+        h4 += (load_le32(data + 12) >> 8) | hibit;
+
+        // h *= r, with the limbs above 2^130 folded back multiplied by 5
+        uint64_t d0 = uint64_t(h0) * r0 + uint64_t(h1) * s4 +
+                      uint64_t(h2) * s3 + uint64_t(h3) * s2 +
+                      uint64_t(h4) * s1;
+        uint64_t d1 = uint64_t(h0) * r1 + uint64_t(h1) * r0 +
+                      uint64_t(h2) * s4 + uint64_t(h3) * s3 +
+                      uint64_t(h4) * s2;
+        uint64_t d2 = uint64_t(h0) * r2 + uint64_t(h1) * r1 +
+                      uint64_t(h2) * r0 + uint64_t(h3) * s4 +
+                      uint64_t(h4) * s3;
+        uint64_t d3 = uint64_t(h0) * r3 + uint64_t(h1) * r2 +
+                      uint64_t(h2) * r1 + uint64_t(h3) * r0 +
+                      uint64_t(h4) * s4;
+        uint64_t d4 = uint64_t(h0) * r4 + uint64_t(h1) * r3 +
+                      uint64_t(h2) * r2 + uint64_t(h3) * r1 +
+                      uint64_t(h4) * r0;
+
+        // Partial reduction mod 2^130 - 5
+        uint32_t c;
+        c = d0 >> 26; h0 = d0 & mask;
+        d1 += c;      c = d1 >> 26; h1 = d1 & mask;
+        d2 += c;      c = d2 >> 26; h2 = d2 & mask;
+        d3 += c;      c = d3 >> 26; h3 = d3 & mask;
+        d4 += c;      c = d4 >> 26; h4 = d4 & mask;
+        h0 += c * 5;  c = h0 >> 26; h0 = h0 & mask;
+        h1 += c;
+    }
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+    h[3] = h3;
+    h[4] = h4;
+}
+
+void Poly1305Radix26::emit(uint8_t *tag) {
+    const uint32_t mask = 0x3ffffff;
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+    // Fully carry h
+    uint32_t c;
+    c = h1 >> 26; h1 &= mask;
+    h2 += c;      c = h2 >> 26; h2 &= mask;
+    h3 += c;      c = h3 >> 26; h3 &= mask;
+    h4 += c;      c = h4 >> 26; h4 &= mask;
+    h0 += c * 5;  c = h0 >> 26; h0 &= mask;
+    h1 += c;
+
+    // Compute h - p = h + 5 - 2^130, and select it if it is not negative
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= mask;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= mask;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= mask;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= mask;
+    uint32_t g4 = h4 + c - (1 << 26);
+
+    uint32_t select = (g4 >> 31) - 1;
+    h0 = (h0 & ~select) | (g0 & select);
+    h1 = (h1 & ~select) | (g1 & select);
+    h2 = (h2 & ~select) | (g2 & select);
+    h3 = (h3 & ~select) | (g3 & select);
+    h4 = (h4 & ~select) | (g4 & select);
+
+    // h = (h + pad) mod 2^128
+    uint32_t words[4] = {
+        h0 | (h1 << 26),
+        (h1 >> 6) | (h2 << 20),
+        (h2 >> 12) | (h3 << 14),
+        (h3 >> 18) | (h4 << 8)
+    };
+    uint64_t f = 0;
+    for (size_t i = 0; i < 4; i++) {
+        f = uint64_t(words[i]) + pad[i] + (f >> 32);
+        store_le32(tag + 4 * i, f);
+    }
+}
+
+#if defined(__SIZEOF_INT128__)
+
+namespace {
+
+typedef unsigned __int128 uint128_t;
+
+inline uint64_t load_le64(const uint8_t *p) {
+    return uint64_t(load_le32(p)) | (uint64_t(load_le32(p + 4)) << 32);
+}
+
+// Carry out of the addition of |b| which produced |sum|, without branches
+inline uint64_t carry_of(uint64_t sum, uint64_t b) {
+    return (sum ^ ((sum ^ b) | ((sum - b) ^ b))) >> 63;
+}
+
+}
+
+Poly1305Radix64::Poly1305Radix64(const memslice key) {
+    contract_assert(key.size() == get_key_size());
+    const uint8_t *k = key.cptr();
+
+    r[0] = load_le64(k) & 0x0ffffffc0fffffffULL;
+    r[1] = load_le64(k + 8) & 0x0ffffffc0ffffffcULL;
+    h[0] = h[1] = h[2] = 0;
+    pad[0] = load_le64(k + 16);
+    pad[1] = load_le64(k + 24);
+}
+
+void Poly1305Radix64::blocks(const uint8_t *data, size_t num_blocks,
+                             bool final) {
+    const uint64_t hibit = final ? 0 : 1;
+    uint64_t r0 = r[0], r1 = r[1];
+
+    // The clamping clears the low two bits of r1, so 5 * r1 / 4 is exact
+    uint64_t s1 = r1 + (r1 >> 2);
+    uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+
+    for (size_t i = 0; i < num_blocks; i++, data += 16) {
+        // h += m
+        uint128_t d0 = uint128_t(h0) + load_le64(data);
+        uint128_t d1 = uint128_t(h1) + (d0 >> 64) + load_le64(data + 8);
+        h0 = uint64_t(d0);
+        h1 = uint64_t(d1);
+        h2 += uint64_t(d1 >> 64) + hibit;
+
+        // h *= r, with 2^128 folded back as 5/4 since r1 is divisible by 4
+        d0 = uint128_t(h0) * r0 + uint128_t(h1) * s1;
+        d1 = uint128_t(h0) * r1 + uint128_t(h1) * r0 + h2 * s1;
+        h2 = h2 * r0;
+
+        h0 = uint64_t(d0);
+        d1 += d0 >> 64;
+        h1 = uint64_t(d1);
+        h2 += uint64_t(d1 >> 64);
+
+        // Partial reduction: fold the bits above 2^130 back multiplied by 5
+        uint64_t c = (h2 >> 2) + (h2 & ~uint64_t(3));
+        h2 &= 3;
+        h0 += c;
+        c = carry_of(h0, c);
+        h1 += c;
+        h2 += carry_of(h1, c);
+    }
+
+    h[0] = h0;
+    h[1] = h1;
+    h[2] = h2;
+}
+
+void Poly1305Radix64::emit(uint8_t *tag) {
+    uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+
+    // Compute h + 5; if it reaches 2^130, h was not fully reduced
+    uint128_t t = uint128_t(h0) + 5;
+    uint64_t g0 = uint64_t(t);
+    t = uint128_t(h1) + (t >> 64);
+    uint64_t g1 = uint64_t(t);
+    uint64_t g2 = h2 + uint64_t(t >> 64);
+
+    uint64_t select = 0 - (g2 >> 2);
+    h0 = (h0 & ~select) | (g0 & select);
+    h1 = (h1 & ~select) | (g1 & select);
+
+    // h = (h + pad) mod 2^128
+    t = uint128_t(h0) + pad[0];
+    h0 = uint64_t(t);
+    t = uint128_t(h1) + pad[1] + (t >> 64);
+    h1 = uint64_t(t);
+
+    store_le32(tag, h0);
+    store_le32(tag + 4, h0 >> 32);
+    store_le32(tag + 8, h1);
+    store_le32(tag + 12, h1 >> 32);
+}
+
+#endif
+
+}
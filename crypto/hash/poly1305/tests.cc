@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+
+#include "crypto/hash/poly1305.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include <random>
+
+namespace {
+
+struct Poly1305Vector {
+    const char *key;
+    const char *input;
+    const char *tag;
+};
+
+// RFC 8439, section 2.5.2 and appendix A.3; the latter mostly exercise the
+// carries and the final reduction
+const Poly1305Vector RFCVectors[] = {
+    { "85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b",
+      "43727970746f6772617068696320466f72756d2052657365617263682047726f7570",
+      "a8061dc1305136c6c22b8baf0c0127a9" },
+    { "0000000000000000000000000000000000000000000000000000000000000000",
+      "00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+      "00000000000000000000000000000000" },
+    { "0200000000000000000000000000000000000000000000000000000000000000",
+      "ffffffffffffffffffffffffffffffff",
+      "03000000000000000000000000000000" },
+    { "02000000000000000000000000000000ffffffffffffffffffffffffffffffff",
+      "02000000000000000000000000000000",
+      "03000000000000000000000000000000" },
+    { "0100000000000000000000000000000000000000000000000000000000000000",
+      "fffffffffffffffffffffffffffffffff0ffffffffffffffffffffffffffffff11000000000000000000000000000000",
+      "05000000000000000000000000000000" },
+    { "0100000000000000000000000000000000000000000000000000000000000000",
+      "fffffffffffffffffffffffffffffffffbfefefefefefefefefefefefefefefe01010101010101010101010101010101",
+      "00000000000000000000000000000000" },
+    { "0200000000000000000000000000000000000000000000000000000000000000",
+      "fdffffffffffffffffffffffffffffff",
+      "faffffffffffffffffffffffffffffff" },
+    { "0100000000000000040000000000000000000000000000000000000000000000",
+      "e33594d7505e43b900000000000000003394d7505e4379cd01000000000000000000000000000000000000000000000001000000000000000000000000000000",
+      "14000000000000005500000000000000" },
+    { "0100000000000000040000000000000000000000000000000000000000000000",
+      "e33594d7505e43b900000000000000003394d7505e4379cd010000000000000000000000000000000000000000000000",
+      "13000000000000000000000000000000" },
+};
+
+crypto::bytestring compute_tag(crypto::Poly1305Base &mac,
+                               const crypto::bytestring &input) {
+    crypto::bytestring tag(crypto::Poly1305Base::get_tag_size());
+    mac.update(input.cmem());
+    mac.finish(tag.ptr());
+    return tag;
+}
+
+template <class Impl>
+void test_vectors() {
+    for (const Poly1305Vector &vector : RFCVectors) {
+        crypto::bytestring key = crypto::bytestring::from_hex(vector.key);
+        crypto::bytestring input = crypto::bytestring::from_hex(vector.input);
+        crypto::bytestring expected = crypto::bytestring::from_hex(vector.tag);
+
+        Impl mac(key.cmem());
+        EXPECT_EQ(expected, compute_tag(mac, input)) << vector.input;
+    }
+}
+
+}
+
+TEST(Poly1305, Radix26RFCVectors) {
+    test_vectors<crypto::Poly1305Radix26>();
+}
+
+#if defined(__SIZEOF_INT128__)
+TEST(Poly1305, Radix64RFCVectors) {
+    test_vectors<crypto::Poly1305Radix64>();
+}
+#endif
+
+// Feed the input in chunks of every size, which must not change the tag
+TEST(Poly1305, Chunked) {
+    std::mt19937 rng(1305);
+    crypto::bytestring key = crypto::random_bytes(rng, 32);
+    crypto::bytestring input = crypto::random_bytes(rng, 200);
+
+    crypto::Poly1305Base_u reference = crypto::Poly1305(key.cmem());
+    crypto::bytestring expected = compute_tag(*reference, input);
+
+    for (size_t chunk = 1; chunk <= 40; chunk++) {
+        crypto::Poly1305Base_u mac = crypto::Poly1305(key.cmem());
+        for (size_t i = 0; i < input.size(); i += chunk) {
+            size_t len = std::min(chunk, input.size() - i);
+            mac->update(crypto::cmem(input.cptr() + i, len));
+        }
+        crypto::bytestring tag(16);
+        mac->finish(tag.ptr());
+        EXPECT_EQ(expected, tag) << "Chunk size " << chunk;
+    }
+}
+
+#if defined(__SIZEOF_INT128__)
+// Both representations must agree on random keys and inputs of all lengths
+TEST(Poly1305, Radix26Radix64Compat) {
+    std::mt19937 rng(26 + 64);
+
+    for (size_t len = 0; len < 300; len++) {
+        crypto::bytestring key = crypto::random_bytes(rng, 32);
+        crypto::bytestring input = crypto::random_bytes(rng, len);
+
+        crypto::Poly1305Radix26 radix26(key.cmem());
+        crypto::Poly1305Radix64 radix64(key.cmem());
+        EXPECT_EQ(compute_tag(radix26, input), compute_tag(radix64, input))
+            << "Length " << len;
+    }
+}
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -2,6 +2,7 @@
 #define __CRYPTO_HASH_SHA1_HH
 
 #include "crypto/hash.hh"
+#include "crypto/hash/merkle_damgard.hh"
 
 namespace crypto {
 
@@ -16,13 +17,102 @@ class SHA1Base : public HashFunction {
     }
 
     virtual size_t get_output_size() const override {
-        return 16;
+        return 20;
     }
 };
 
 typedef std::unique_ptr<SHA1Base> SHA1Base_u;
 SHA1Base_u SHA1();
 
+typedef Digest<20> SHA1Digest;
+
+/**
+ * Hash |data| in one go, using the fastest compression function the CPU
+ * supports.  Unlike going through SHA1(), does not allocate.
+ */
+SHA1Digest sha1_digest(const memslice data);
+
+/**
+ * Run the SHA-1 compression function over |num_blocks| consecutive 64-byte
+ * blocks of |data|, updating the five-word |state|.  Does not do any padding;
+ * this is meant for the constructions which need to control the exact
+ * sequence of blocks, like the constant-time MAC check of TLS CBC records.
+ * Uses the fastest of the functions below which the CPU supports.
+ */
+void sha1_compress(uint32_t *state, const uint8_t *data, size_t num_blocks);
+
+typedef void (*SHA1CompressFunction)(uint32_t *state, const uint8_t *data,
+                                     size_t num_blocks);
+
+/**
+ * The initial SHA-1 state, for use with the compression functions.
+ */
+extern const uint32_t sha1_iv[5];
+
+/**
+ * The implementations of the compression function.  The portable one is the
+ * same as in SHA1Impl; the other ones may only be called if the CPU has the
+ * instructions they need.
+ */
+void sha1_compress_portable(uint32_t *state, const uint8_t *data,
+                            size_t num_blocks);
+void sha1_compress_ssse3(uint32_t *state, const uint8_t *data,
+                         size_t num_blocks);
+void sha1_compress_avx2(uint32_t *state, const uint8_t *data,
+                        size_t num_blocks);
+void sha1_compress_shani(uint32_t *state, const uint8_t *data,
+                         size_t num_blocks);
+
+/**
+ * The buffering and padding of SHA-1, also used for the inner hash of
+ * HMAC-SHA1 in the TLS CBC records.
+ */
+typedef MerkleDamgard<uint32_t, 5, 64, 8> SHA1State;
+
+/**
+ * SHA-1 on top of one of the compression functions above.  Whole blocks of
+ * the input are passed to it directly, without copying them.
+ */
+class SHA1Blocks : public SHA1Base {
+  private:
+    SHA1State state;
+
+  public:
+    SHA1Blocks(SHA1CompressFunction compress);
+
+    virtual void update(const memslice data) override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
+};
+
+/**
+ * SHA-1 with the message schedule computed in SSSE3 registers, interleaved
+ * with the scalar rounds.
+ */
+class SHA1SSSE3 : public SHA1Blocks {
+  public:
+    SHA1SSSE3() : SHA1Blocks(sha1_compress_ssse3) {}
+};
+
+/**
+ * Like SHA1SSSE3, but computing the schedules of two blocks at once in AVX2
+ * registers.
+ */
+class SHA1AVX2 : public SHA1Blocks {
+  public:
+    SHA1AVX2() : SHA1Blocks(sha1_compress_avx2) {}
+};
+
+/**
+ * SHA-1 using the SHA extensions (sha1rnds4, sha1nexte, sha1msg1 and
+ * sha1msg2).
+ */
+class SHA1SHANI : public SHA1Blocks {
+  public:
+    SHA1SHANI() : SHA1Blocks(sha1_compress_shani) {}
+};
+
 class SHA1Impl : public SHA1Base {
   private:
     unsigned int sz[2];
@@ -35,7 +125,9 @@ class SHA1Impl : public SHA1Base {
     SHA1Impl();
 
     virtual void update(const memslice data) override;
-    virtual bytestring_u finish() override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
 };
 
 }
@@ -0,0 +1,52 @@
+#include "crypto/hash/sha1.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_hash(const char *desc, const crypto::HashFunctionFactory &factory) {
+    for (size_t size : { 64, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            desc, "SHA-1", size,
+            crypto::cycles_per_byte([&]() {
+                crypto::hash(factory, input.mem());
+            }, size, iterations));
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    benchmark_hash("KTH", []() {
+        return crypto::SHA1Base_u(new crypto::SHA1Impl());
+    });
+    benchmark_hash("Portable blocks", []() {
+        return crypto::SHA1Base_u(
+            new crypto::SHA1Blocks(crypto::sha1_compress_portable));
+    });
+    if (cpu.has_ssse3()) {
+        benchmark_hash("SSSE3", []() {
+            return crypto::SHA1Base_u(new crypto::SHA1SSSE3());
+        });
+    }
+    if (cpu.has_avx2()) {
+        benchmark_hash("AVX2", []() {
+            return crypto::SHA1Base_u(new crypto::SHA1AVX2());
+        });
+    }
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        benchmark_hash("SHA-NI", []() {
+            return crypto::SHA1Base_u(new crypto::SHA1SHANI());
+        });
+    }
+
+    return 0;
+}
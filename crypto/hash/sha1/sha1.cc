@@ -32,13 +32,68 @@
  */
 
 #include "crypto/hash/sha1.hh"
+#include "crypto/assert.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
 
 #include <algorithm>
 
 namespace crypto {
 
+namespace {
+
+typedef SHA1Base *(*SHA1Constructor)();
+
+SHA1Constructor select_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        return construct<SHA1Base, SHA1SHANI>;
+    }
+    if (cpu.has_avx2()) {
+        return construct<SHA1Base, SHA1AVX2>;
+    }
+    if (cpu.has_ssse3()) {
+        return construct<SHA1Base, SHA1SSSE3>;
+    }
+
+    return construct<SHA1Base, SHA1Impl>;
+}
+
+SHA1CompressFunction select_compress_function() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        return sha1_compress_shani;
+    }
+    if (cpu.has_avx2()) {
+        return sha1_compress_avx2;
+    }
+    if (cpu.has_ssse3()) {
+        return sha1_compress_ssse3;
+    }
+
+    return sha1_compress_portable;
+}
+
+}
+
 SHA1Base_u SHA1() {
-    return SHA1Base_u(new SHA1Impl());
+    static const SHA1Constructor constructor = select_implementation();
+    return SHA1Base_u(constructor());
+}
+
+void sha1_compress(uint32_t *state, const uint8_t *data, size_t num_blocks) {
+    static const SHA1CompressFunction compress = select_compress_function();
+    compress(state, data, num_blocks);
+}
+
+SHA1Digest sha1_digest(const memslice data) {
+    SHA1Blocks hash(sha1_compress);
+    hash.update(data);
+    SHA1Digest digest;
+    hash.finish_into(digest.mem());
+    return digest;
 }
 
 static inline uint32_t
@@ -88,8 +143,12 @@ do { \
   AA = temp; \
 } while(0)
 
-void
-SHA1Impl::calc (uint32_t *in)
+/*
+ * The compression function.  |counter| is the five-word chaining state, so
+ * that the A-E macros above refer to it.
+ */
+static void
+sha1_block (uint32_t *counter, const uint32_t *in)
 {
   uint32_t AA, BB, CC, DD, EE;
   uint32_t data[80];
@@ -205,6 +264,27 @@ SHA1Impl::calc (uint32_t *in)
   E += EE;
 }
 
+void
+SHA1Impl::calc (uint32_t *in)
+{
+  sha1_block(counter, in);
+}
+
+void
+sha1_compress_portable (uint32_t *state, const uint8_t *data,
+                        size_t num_blocks)
+{
+  uint32_t in[16];
+  for (size_t i = 0; i < num_blocks; i++) {
+    for (int j = 0; j < 16; j++) {
+      const uint8_t *p = data + 64 * i + 4 * j;
+      in[j] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+              ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    }
+    sha1_block(state, in);
+  }
+}
+
 /*
  * From `Performance analysis of MD5' by Joseph D. Touch <touch@isi.edu>
  */
@@ -266,9 +346,11 @@ SHA1Impl::update (const memslice data)
   }
 }
 
-bytestring_u
-SHA1Impl::finish ()
+void
+SHA1Impl::finish_into (memslice output)
 {
+  contract_assert(output.size() == 20);
+
   unsigned char zeros[72];
   unsigned offset = (sz[0] / 8) % 64;
   unsigned int dstart = (120 - offset - 1) % 64 + 1;
@@ -285,8 +367,7 @@ SHA1Impl::finish ()
   zeros[dstart+0] = (sz[1] >> 24) & 0xff;
   update (mem(zeros, dstart + 8));
 
-  bytestring_u result = bytestring_u(new bytestring(20));
-  uint8_t *r = result->ptr();
+  uint8_t *r = output.ptr();
 
   for (int i = 0; i < 5; ++i) {
       r[4*i+3] = counter[i] & 0xFF;
@@ -294,8 +375,20 @@ SHA1Impl::finish ()
       r[4*i+1] = (counter[i] >> 16) & 0xFF;
       r[4*i]   = (counter[i] >> 24) & 0xFF;
   }
+}
 
-  return result;
+HashFunction_u
+SHA1Impl::clone () const
+{
+  return HashFunction_u(new SHA1Impl(*this));
+}
+
+void
+SHA1Impl::assign (const HashFunction &other)
+{
+  const SHA1Impl *source = dynamic_cast<const SHA1Impl *>(&other);
+  contract_assert(source != nullptr);
+  *this = *source;
 }
 
 }
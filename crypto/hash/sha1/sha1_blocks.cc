@@ -0,0 +1,39 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/hash/sha1.hh"
+#include "crypto/assert.hh"
+
+namespace crypto {
+
+const uint32_t sha1_iv[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+SHA1Blocks::SHA1Blocks(SHA1CompressFunction compress)
+    : state(compress, sha1_iv) {}
+
+void SHA1Blocks::update(const memslice data) {
+    state.update(data);
+}
+
+void SHA1Blocks::finish_into(memslice output) {
+    contract_assert(output.size() == 20);
+    state.finish(output.ptr(), 5);
+}
+
+HashFunction_u SHA1Blocks::clone() const {
+    return HashFunction_u(new SHA1Blocks(*this));
+}
+
+void SHA1Blocks::assign(const HashFunction &other) {
+    const SHA1Blocks *source = dynamic_cast<const SHA1Blocks *>(&other);
+    contract_assert(source != nullptr);
+    *this = *source;
+}
+
+}
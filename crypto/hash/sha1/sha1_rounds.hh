@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// The scalar SHA-1 rounds shared by the implementations which compute W[t] + K
+// separately: the SIMD ones in vector registers, leaving only the rounds
+// themselves to the integer units, and the stitched AES-CBC-HMAC-SHA1 a few
+// rounds at a time between AES rounds.
+//
+// Included from files built for different instruction sets, so it is all in
+// an anonymous namespace, as explained in crypto/dispatch.hh.
+
+#ifndef __CRYPTO_HASH_SHA1_SHA1_ROUNDS_HH
+#define __CRYPTO_HASH_SHA1_SHA1_ROUNDS_HH
+
+#include "crypto/hash/interleaved_rounds.hh"
+
+#include <cstdint>
+
+namespace crypto {
+
+namespace {
+
+const uint32_t sha1_k[4] = {
+    0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6
+};
+
+inline uint32_t sha1_rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+/**
+ * SHA-1 round |t|.  The working variables rotate through |v| instead of
+ * being moved, so after inlining all indices are constants and |v| lives in
+ * registers.  |wk| holds W + K in groups of four words, |stride| words
+ * apart, so that the two-block AVX2 schedule can be used in place.
+ */
+template <int t, int stride>
+inline void sha1_round(uint32_t *v, const uint32_t *wk) {
+    uint32_t &a = v[(5 - t % 5) % 5];
+    uint32_t &b = v[(6 - t % 5) % 5];
+    uint32_t &c = v[(7 - t % 5) % 5];
+    uint32_t &d = v[(8 - t % 5) % 5];
+    uint32_t &e = v[(9 - t % 5) % 5];
+
+    uint32_t f;
+    if (t < 20) {
+        f = d ^ (b & (c ^ d));
+    } else if (t < 40 || t >= 60) {
+        f = b ^ c ^ d;
+    } else {
+        f = (b & c) | (d & (b | c));
+    }
+
+    e += sha1_rol(a, 5) + f + wk[(t / 4) * stride + t % 4];
+    b = sha1_rol(b, 30);
+}
+
+template <int g, int stride>
+inline void sha1_rounds4(uint32_t *v, const uint32_t *wk) {
+    sha1_round<4 * g + 0, stride>(v, wk);
+    sha1_round<4 * g + 1, stride>(v, wk);
+    sha1_round<4 * g + 2, stride>(v, wk);
+    sha1_round<4 * g + 3, stride>(v, wk);
+}
+
+/**
+ * A group of four rounds, for InterleavedRounds.
+ */
+template <int stride>
+struct SHA1Group {
+    template <int g>
+    static inline void run(uint32_t *v, const uint32_t *wk) {
+        sha1_rounds4<g, stride>(v, wk);
+    }
+};
+
+/**
+ * The 80 rounds, computing the words of group g + 4 after group g.
+ */
+template <int stride>
+using SHA1Rounds = InterleavedRounds<SHA1Group<stride>, 0, 20, 4>;
+
+}
+
+}
+
+#endif /* __CRYPTO_HASH_SHA1_SHA1_ROUNDS_HH */
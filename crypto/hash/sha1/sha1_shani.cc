@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// SHA-1 using the SHA extensions, compiled with -msha -msse4.1.
+//
+// sha1rnds4 does four rounds on A-D, and takes E added to the four message
+// words in its second operand; sha1nexte computes that E from the A of four
+// rounds before.  The message schedule is computed four words at a time,
+// interleaved with the rounds: W[t] for the group of rounds g + 1 is
+// started with sha1msg1 in group g - 2, XORed with W[t - 8] in group g - 1
+// and finished with sha1msg2 in group g.
+
+#include "crypto/hash/sha1.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+/**
+ * Rounds 4 * g to 4 * g + 3.  |msg| holds the message words of groups g to
+ * g + 3, with group g in msg[g % 4].  The E of the rounds alternates between
+ * |e0| and |e1|.
+ */
+template <int g>
+inline void rounds4(__m128i &abcd, __m128i &e0, __m128i &e1, __m128i *msg) {
+    __m128i &e = g % 2 == 0 ? e0 : e1;
+    __m128i &next_e = g % 2 == 0 ? e1 : e0;
+
+    if (g == 0) {
+        e = _mm_add_epi32(e, msg[0]);
+    } else {
+        e = _mm_sha1nexte_epu32(e, msg[g % 4]);
+    }
+    next_e = abcd;
+    if (g >= 3 && g <= 18) {
+        msg[(g + 1) % 4] = _mm_sha1msg2_epu32(msg[(g + 1) % 4], msg[g % 4]);
+    }
+    abcd = _mm_sha1rnds4_epu32(abcd, e, g / 5);
+    if (g >= 1 && g <= 16) {
+        msg[(g + 3) % 4] = _mm_sha1msg1_epu32(msg[(g + 3) % 4], msg[g % 4]);
+    }
+    if (g >= 2 && g <= 17) {
+        msg[(g + 2) % 4] = _mm_xor_si128(msg[(g + 2) % 4], msg[g % 4]);
+    }
+}
+
+template <int g>
+struct Rounds {
+    static inline void run(__m128i &abcd, __m128i &e0, __m128i &e1,
+                           __m128i *msg) {
+        rounds4<g>(abcd, e0, e1, msg);
+        Rounds<g + 1>::run(abcd, e0, e1, msg);
+    }
+};
+
+template <>
+struct Rounds<20> {
+    static inline void run(__m128i &, __m128i &, __m128i &, __m128i *) {}
+};
+
+}
+
+void sha1_compress_shani(uint32_t *state, const uint8_t *data,
+                         size_t num_blocks) {
+    // Reverses the bytes of the whole register, so that the message words
+    // are big-endian and the first one is in the highest lane, as A is
+    const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL,
+                                             0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+    abcd = _mm_shuffle_epi32(abcd, 0x1b);
+    __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+    __m128i e1;
+
+    for (size_t i = 0; i < num_blocks; i++, data += 64) {
+        __m128i abcd_save = abcd;
+        __m128i e_save = e0;
+
+        __m128i msg[4];
+        for (size_t j = 0; j < 4; j++) {
+            msg[j] = _mm_shuffle_epi8(
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(data + 16 * j)),
+                byte_swap);
+        }
+
+        Rounds<0>::run(abcd, e0, e1, msg);
+
+        // The last group of rounds leaves the A it started with in e0
+        e0 = _mm_sha1nexte_epu32(e0, e_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    abcd = _mm_shuffle_epi32(abcd, 0x1b);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), abcd);
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// SHA-1 with the message schedule computed four words at a time using
+// SSSE3, in the way of Intel's "Improving the Performance of the Secure Hash
+// Algorithm (SHA-1)".  Compiled with -mssse3.
+//
+// For words 16 to 31, W[t + 3] depends on W[t], so lane 3 is first computed
+// without it and then fixed up.  From word 32 on, the equivalent recurrence
+//   W[t] = (W[t - 6] ^ W[t - 16] ^ W[t - 28] ^ W[t - 32]) <<< 2
+// has no dependencies within a vector.
+
+#include "crypto/hash/sha1.hh"
+#include "crypto/hash/sha1/sha1_rounds.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+template <int n>
+inline __m128i rol(__m128i x) {
+    return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+struct Schedule {
+    __m128i w[20];
+    uint32_t *wk;
+
+    /**
+     * Compute W[4g..4g+3] from the previous words and store it.
+     */
+    template <int g>
+    inline void step() {
+        __m128i x;
+        if (g < 8) {
+            x = _mm_xor_si128(w[g - 4], w[g - 2]);
+            x = _mm_xor_si128(x, _mm_alignr_epi8(w[g - 3], w[g - 4], 8));
+            x = _mm_xor_si128(x, _mm_srli_si128(w[g - 1], 4));
+            __m128i fixup = _mm_slli_si128(x, 12);
+            x = _mm_xor_si128(rol<1>(x), rol<2>(fixup));
+        } else {
+            x = _mm_xor_si128(w[g - 4], w[g - 7]);
+            x = _mm_xor_si128(x, w[g - 8]);
+            x = _mm_xor_si128(x, _mm_alignr_epi8(w[g - 1], w[g - 2], 8));
+            x = rol<2>(x);
+        }
+        store<g>(x);
+    }
+
+    /**
+     * Keep W[4g..4g+3] for the rest of the schedule and store it plus K to
+     * |wk| for the rounds.
+     */
+    template <int g>
+    inline void store(__m128i x) {
+        w[g] = x;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(wk + 4 * g),
+                         _mm_add_epi32(x, _mm_set1_epi32(sha1_k[g / 5])));
+    }
+};
+
+}
+
+void sha1_compress_ssse3(uint32_t *state, const uint8_t *data,
+                         size_t num_blocks) {
+    const __m128i byte_swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                           4, 5, 6, 7, 0, 1, 2, 3);
+
+    uint32_t wk[80];
+    Schedule schedule;
+    schedule.wk = wk;
+
+    for (size_t i = 0; i < num_blocks; i++, data += 64) {
+        schedule.store<0>(_mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)),
+            byte_swap));
+        schedule.store<1>(_mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16)),
+            byte_swap));
+        schedule.store<2>(_mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32)),
+            byte_swap));
+        schedule.store<3>(_mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48)),
+            byte_swap));
+
+        uint32_t v[5] = { state[0], state[1], state[2], state[3], state[4] };
+        SHA1Rounds<4>::run(v, wk, schedule);
+
+        // After 80 rounds the variables have rotated back into place
+        for (size_t j = 0; j < 5; j++) {
+            state[j] += v[j];
+        }
+    }
+}
+
+}
@@ -1,6 +1,11 @@
 #include "gtest/gtest.h"
 
 #include "crypto/hash/sha1.hh"
+#include "crypto/cpu.hh"
+#include "crypto/testutils/hash_tester.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include <random>
 
 struct NISTVector {
     const char *input;
@@ -206,6 +211,125 @@ TEST(SHA1, RFC2202Vectors) {
     }
 }
 
+namespace {
+
+// Compare against SHA1Impl, with chunk sizes straddling the block boundaries
+void test_against_impl(const crypto::HashFunctionFactory &factory) {
+    crypto::test_randomized_hash_compat(defaultImpl, factory, 300,
+                                        { 1, 7, 63, 65, 300 }, 160);
+}
+
+}
+
+TEST(SHA1, BlocksPortable) {
+    test_against_impl([]() {
+        return crypto::SHA1Base_u(
+            new crypto::SHA1Blocks(crypto::sha1_compress_portable));
+    });
+}
+
+TEST(SHA1, SSSE3) {
+    crypto::CPU cpu;
+    if (!cpu.has_ssse3()) {
+        return;
+    }
+
+    test_against_impl([]() {
+        return crypto::SHA1Base_u(new crypto::SHA1SSSE3());
+    });
+}
+
+TEST(SHA1, AVX2) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2()) {
+        return;
+    }
+
+    test_against_impl([]() {
+        return crypto::SHA1Base_u(new crypto::SHA1AVX2());
+    });
+}
+
+TEST(SHA1, SHANI) {
+    crypto::CPU cpu;
+    if (!cpu.has_sha() || !cpu.has_sse41()) {
+        return;
+    }
+
+    test_against_impl([]() {
+        return crypto::SHA1Base_u(new crypto::SHA1SHANI());
+    });
+}
+
+// finish_copy() after every chunk of a running hash gives the hash of the
+// prefix, and a clone continues independently of the original
+TEST(SHA1, Snapshots) {
+    std::mt19937 rng(3);
+    crypto::bytestring input = crypto::random_bytes(rng, 300);
+
+    for (const crypto::HashFunctionFactory &factory :
+         { defaultImpl, crypto::HashFunctionFactory(crypto::SHA1) }) {
+        crypto::HashFunction_u hash = factory();
+        for (size_t i = 0; i < input.size(); i += 37) {
+            size_t len = std::min<size_t>(37, input.size() - i);
+            hash->update(crypto::cmem(input.cptr() + i, len));
+            crypto::bytestring_u expected =
+                crypto::hash(defaultImpl, crypto::cmem(input.cptr(), i + len));
+            EXPECT_EQ(*expected, *hash->finish_copy()) << "Length " << i + len;
+        }
+
+        crypto::HashFunction_u copy = hash->clone();
+        copy->update(crypto::cmem("abc", 3));
+        crypto::HashFunction_u extended = defaultImpl();
+        extended->update(input.mem());
+        extended->update(crypto::cmem("abc", 3));
+        EXPECT_EQ(*extended->finish(), *copy->finish());
+        EXPECT_EQ(*crypto::hash(defaultImpl, input.mem()), *hash->finish());
+    }
+}
+
+// The compression functions on their own, from an arbitrary state and for
+// odd and even numbers of blocks
+TEST(SHA1, CompressFunctions) {
+    crypto::CPU cpu;
+    std::vector<std::pair<const char *, crypto::SHA1CompressFunction>> impls;
+    if (cpu.has_ssse3()) {
+        impls.emplace_back("SSSE3", crypto::sha1_compress_ssse3);
+    }
+    if (cpu.has_avx2()) {
+        impls.emplace_back("AVX2", crypto::sha1_compress_avx2);
+    }
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        impls.emplace_back("SHA-NI", crypto::sha1_compress_shani);
+    }
+
+    std::mt19937 rng(1);
+    crypto::bytestring data = crypto::random_bytes(rng, 64 * 5);
+    for (size_t num_blocks = 0; num_blocks <= 5; num_blocks++) {
+        uint32_t expected[5] = { 1, 2, 3, 4, 5 };
+        crypto::sha1_compress_portable(expected, data.cptr(), num_blocks);
+
+        for (auto impl : impls) {
+            uint32_t actual[5] = { 1, 2, 3, 4, 5 };
+            impl.second(actual, data.cptr(), num_blocks);
+            for (size_t i = 0; i < 5; i++) {
+                EXPECT_EQ(expected[i], actual[i])
+                    << impl.first << ", " << num_blocks << " blocks, word "
+                    << i;
+            }
+        }
+    }
+}
+
+TEST(SHA1, Digest) {
+    for (const NISTVector &vector : NISTVectors) {
+        crypto::bytestring input = crypto::bytestring::from_hex(vector.input);
+        crypto::SHA1Digest digest = crypto::sha1_digest(input.cmem());
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.output),
+                  crypto::bytestring(digest.cmem()));
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
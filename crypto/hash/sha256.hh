@@ -0,0 +1,156 @@
+#ifndef __CRYPTO_HASH_SHA256_HH
+#define __CRYPTO_HASH_SHA256_HH
+
+#include "crypto/hash.hh"
+#include "crypto/hash/merkle_damgard.hh"
+
+namespace crypto {
+
+class SHA256Base : public HashFunction {
+  public:
+    virtual const char *get_name() const override {
+        return "SHA256";
+    }
+
+    virtual size_t get_block_size() const override {
+        return 64;
+    }
+
+    virtual size_t get_output_size() const override {
+        return 32;
+    }
+};
+
+typedef std::unique_ptr<SHA256Base> SHA256Base_u;
+SHA256Base_u SHA256();
+
+typedef Digest<32> SHA256Digest;
+
+/**
+ * Hash |data| in one go, using the fastest compression function the CPU
+ * supports.  Unlike going through SHA256(), does not allocate.
+ */
+SHA256Digest sha256_digest(const memslice data);
+
+/**
+ * SHA-224 is SHA-256 with a different initial state and the output
+ * truncated to seven words.
+ */
+class SHA224Base : public HashFunction {
+  public:
+    virtual const char *get_name() const override {
+        return "SHA224";
+    }
+
+    virtual size_t get_block_size() const override {
+        return 64;
+    }
+
+    virtual size_t get_output_size() const override {
+        return 28;
+    }
+};
+
+typedef std::unique_ptr<SHA224Base> SHA224Base_u;
+SHA224Base_u SHA224();
+
+typedef Digest<28> SHA224Digest;
+
+/**
+ * Hash |data| in one go, using the fastest compression function the CPU
+ * supports.  Unlike going through SHA224(), does not allocate.
+ */
+SHA224Digest sha224_digest(const memslice data);
+
+/**
+ * Run the SHA-256 compression function over |num_blocks| consecutive 64-byte
+ * blocks of |data|, updating the eight-word |state|.  Does not do any
+ * padding.  Uses the fastest of the functions below which the CPU supports.
+ */
+void sha256_compress(uint32_t *state, const uint8_t *data, size_t num_blocks);
+
+typedef void (*SHA256CompressFunction)(uint32_t *state, const uint8_t *data,
+                                       size_t num_blocks);
+
+/**
+ * The implementations of the compression function.  The AVX2 and SHA-NI ones
+ * may only be called if the CPU has the instructions they need.
+ */
+void sha256_compress_portable(uint32_t *state, const uint8_t *data,
+                              size_t num_blocks);
+void sha256_compress_avx2(uint32_t *state, const uint8_t *data,
+                          size_t num_blocks);
+void sha256_compress_shani(uint32_t *state, const uint8_t *data,
+                           size_t num_blocks);
+
+/**
+ * The buffering and padding shared by SHA-256 and SHA-224.
+ */
+typedef MerkleDamgard<uint32_t, 8, 64, 8> SHA256State;
+
+class SHA256Blocks : public SHA256Base {
+  private:
+    SHA256State state;
+
+  public:
+    SHA256Blocks(SHA256CompressFunction compress);
+
+    virtual void update(const memslice data) override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
+};
+
+class SHA256Impl : public SHA256Blocks {
+  public:
+    SHA256Impl() : SHA256Blocks(sha256_compress_portable) {}
+};
+
+/**
+ * SHA-256 with the message schedules of two blocks computed at once in AVX2
+ * registers, interleaved with the scalar rounds.  Needs BMI2 as well.
+ */
+class SHA256AVX2 : public SHA256Blocks {
+  public:
+    SHA256AVX2() : SHA256Blocks(sha256_compress_avx2) {}
+};
+
+/**
+ * SHA-256 using the SHA extensions (sha256rnds2, sha256msg1 and sha256msg2).
+ */
+class SHA256SHANI : public SHA256Blocks {
+  public:
+    SHA256SHANI() : SHA256Blocks(sha256_compress_shani) {}
+};
+
+class SHA224Blocks : public SHA224Base {
+  private:
+    SHA256State state;
+
+  public:
+    SHA224Blocks(SHA256CompressFunction compress);
+
+    virtual void update(const memslice data) override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
+};
+
+class SHA224Impl : public SHA224Blocks {
+  public:
+    SHA224Impl() : SHA224Blocks(sha256_compress_portable) {}
+};
+
+class SHA224AVX2 : public SHA224Blocks {
+  public:
+    SHA224AVX2() : SHA224Blocks(sha256_compress_avx2) {}
+};
+
+class SHA224SHANI : public SHA224Blocks {
+  public:
+    SHA224SHANI() : SHA224Blocks(sha256_compress_shani) {}
+};
+
+}
+
+#endif /* __CRYPTO_HASH_SHA256_HH */
@@ -0,0 +1,43 @@
+#include "crypto/hash/sha256.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_hash(const char *desc, const crypto::HashFunctionFactory &factory) {
+    for (size_t size : { 64, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            desc, "SHA-256", size,
+            crypto::cycles_per_byte([&]() {
+                crypto::hash(factory, input.mem());
+            }, size, iterations));
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    benchmark_hash("Portable", []() {
+        return crypto::SHA256Base_u(new crypto::SHA256Impl());
+    });
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        benchmark_hash("AVX2", []() {
+            return crypto::SHA256Base_u(new crypto::SHA256AVX2());
+        });
+    }
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        benchmark_hash("SHA-NI", []() {
+            return crypto::SHA256Base_u(new crypto::SHA256SHANI());
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/hash/sha256.hh"
+#include "crypto/hash/sha256/sha256_k.hh"
+#include "crypto/assert.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+
+namespace crypto {
+
+const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+namespace {
+
+const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+const uint32_t sha224_iv[8] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4,
+};
+
+typedef SHA256Base *(*SHA256Constructor)();
+typedef SHA224Base *(*SHA224Constructor)();
+
+SHA256Constructor select_sha256_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        return construct<SHA256Base, SHA256SHANI>;
+    }
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        return construct<SHA256Base, SHA256AVX2>;
+    }
+
+    return construct<SHA256Base, SHA256Impl>;
+}
+
+SHA224Constructor select_sha224_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        return construct<SHA224Base, SHA224SHANI>;
+    }
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        return construct<SHA224Base, SHA224AVX2>;
+    }
+
+    return construct<SHA224Base, SHA224Impl>;
+}
+
+SHA256CompressFunction select_compress_function() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_sha() && cpu.has_sse41()) {
+        return sha256_compress_shani;
+    }
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        return sha256_compress_avx2;
+    }
+
+    return sha256_compress_portable;
+}
+
+inline uint32_t ror(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t load_be32(const uint8_t *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+}
+
+SHA256Base_u SHA256() {
+    static const SHA256Constructor constructor =
+        select_sha256_implementation();
+    return SHA256Base_u(constructor());
+}
+
+SHA224Base_u SHA224() {
+    static const SHA224Constructor constructor =
+        select_sha224_implementation();
+    return SHA224Base_u(constructor());
+}
+
+void sha256_compress(uint32_t *state, const uint8_t *data,
+                     size_t num_blocks) {
+    static const SHA256CompressFunction compress = select_compress_function();
+    compress(state, data, num_blocks);
+}
+
+SHA256Digest sha256_digest(const memslice data) {
+    SHA256Blocks hash(sha256_compress);
+    hash.update(data);
+    SHA256Digest digest;
+    hash.finish_into(digest.mem());
+    return digest;
+}
+
+SHA224Digest sha224_digest(const memslice data) {
+    SHA224Blocks hash(sha256_compress);
+    hash.update(data);
+    SHA224Digest digest;
+    hash.finish_into(digest.mem());
+    return digest;
+}
+
+void sha256_compress_portable(uint32_t *state, const uint8_t *data,
+                              size_t num_blocks) {
+    for (size_t block = 0; block < num_blocks; block++, data += 64) {
+        uint32_t w[64];
+        for (size_t t = 0; t < 16; t++) {
+            w[t] = load_be32(data + 4 * t);
+        }
+        for (size_t t = 16; t < 64; t++) {
+            uint32_t s0 = ror(w[t - 15], 7) ^ ror(w[t - 15], 18) ^
+                          (w[t - 15] >> 3);
+            uint32_t s1 = ror(w[t - 2], 17) ^ ror(w[t - 2], 19) ^
+                          (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t t = 0; t < 64; t++) {
+            uint32_t s1 = ror(e, 6) ^ ror(e, 11) ^ ror(e, 25);
+            uint32_t ch = g ^ (e & (f ^ g));
+            uint32_t t1 = h + s1 + ch + sha256_k[t] + w[t];
+            uint32_t s0 = ror(a, 2) ^ ror(a, 13) ^ ror(a, 22);
+            uint32_t maj = (a & b) | (c & (a | b));
+            uint32_t t2 = s0 + maj;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+SHA256Blocks::SHA256Blocks(SHA256CompressFunction compress)
+    : state(compress, sha256_iv) {}
+
+void SHA256Blocks::update(const memslice data) {
+    state.update(data);
+}
+
+void SHA256Blocks::finish_into(memslice output) {
+    contract_assert(output.size() == 32);
+    state.finish(output.ptr(), 8);
+}
+
+HashFunction_u SHA256Blocks::clone() const {
+    return HashFunction_u(new SHA256Blocks(*this));
+}
+
+void SHA256Blocks::assign(const HashFunction &other) {
+    const SHA256Blocks *source = dynamic_cast<const SHA256Blocks *>(&other);
+    contract_assert(source != nullptr);
+    *this = *source;
+}
+
+SHA224Blocks::SHA224Blocks(SHA256CompressFunction compress)
+    : state(compress, sha224_iv) {}
+
+void SHA224Blocks::update(const memslice data) {
+    state.update(data);
+}
+
+void SHA224Blocks::finish_into(memslice output) {
+    contract_assert(output.size() == 28);
+    state.finish(output.ptr(), 7);
+}
+
+HashFunction_u SHA224Blocks::clone() const {
+    return HashFunction_u(new SHA224Blocks(*this));
+}
+
+void SHA224Blocks::assign(const HashFunction &other) {
+    const SHA224Blocks *source = dynamic_cast<const SHA224Blocks *>(&other);
+    contract_assert(source != nullptr);
+    *this = *source;
+}
+
+}
@@ -0,0 +1,198 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// SHA-256 with the message schedules of two blocks computed at once using
+// AVX2.  Compiled with -mavx2 -mbmi2; BMI2 gives the scalar rounds rorx,
+// which rotates without touching the flags or its source.
+//
+// The first block is in the low 128-bit lanes and the second one in the high
+// ones.  The schedule is computed four words at a time, during the rounds of
+// the first block, and the second block then only needs the scalar rounds.
+// Within a vector, W[t + 2] and W[t + 3] depend on W[t] and W[t + 1] through
+// sigma1, so that term is added in two halves.
+
+#include "crypto/hash/interleaved_rounds.hh"
+#include "crypto/hash/sha256.hh"
+#include "crypto/hash/sha256/sha256_k.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+inline uint32_t ror(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+template <int n>
+inline __m256i ror(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n),
+                           _mm256_slli_epi32(x, 32 - n));
+}
+
+inline __m256i sigma0(__m256i x) {
+    return _mm256_xor_si256(_mm256_xor_si256(ror<7>(x), ror<18>(x)),
+                            _mm256_srli_epi32(x, 3));
+}
+
+inline __m256i sigma1(__m256i x) {
+    return _mm256_xor_si256(_mm256_xor_si256(ror<17>(x), ror<19>(x)),
+                            _mm256_srli_epi32(x, 10));
+}
+
+/**
+ * SHA-256 round |t|.  The working variables rotate through |v| instead of
+ * being moved, so after inlining all indices are constants and |v| lives in
+ * registers.  |wk| holds W + K in groups of four words, eight words apart.
+ */
+template <int t>
+inline void round(uint32_t *v, const uint32_t *wk) {
+    uint32_t &a = v[(8 - t % 8) % 8];
+    uint32_t &b = v[(9 - t % 8) % 8];
+    uint32_t &c = v[(10 - t % 8) % 8];
+    uint32_t &d = v[(11 - t % 8) % 8];
+    uint32_t &e = v[(12 - t % 8) % 8];
+    uint32_t &f = v[(13 - t % 8) % 8];
+    uint32_t &g = v[(14 - t % 8) % 8];
+    uint32_t &h = v[(15 - t % 8) % 8];
+
+    uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) +
+                  (g ^ (e & (f ^ g))) + wk[(t / 4) * 8 + t % 4];
+    uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) +
+                  ((a & b) | (c & (a | b)));
+    d += t1;
+    h = t1 + t2;
+}
+
+struct Schedule {
+    __m256i w[16];
+    uint32_t *wk;
+
+    /**
+     * Compute W[4g..4g+3] of both blocks from the previous words and store
+     * it.
+     */
+    template <int g>
+    inline void step() {
+        __m256i w15 = _mm256_alignr_epi8(w[g - 3], w[g - 4], 4);
+        __m256i w7 = _mm256_alignr_epi8(w[g - 1], w[g - 2], 4);
+        __m256i x = _mm256_add_epi32(_mm256_add_epi32(w[g - 4], w7),
+                                     sigma0(w15));
+
+        // sigma1 of W[t - 2] and W[t - 1] for the low two words, then of the
+        // new W[t] and W[t + 1] for the high ones; the zeros shifted in
+        // give zero
+        x = _mm256_add_epi32(x, sigma1(_mm256_srli_si256(w[g - 1], 8)));
+        x = _mm256_add_epi32(x, sigma1(_mm256_slli_si256(x, 8)));
+        store<g>(x);
+    }
+
+    /**
+     * Keep W[4g..4g+3] for the rest of the schedule and store it plus K to
+     * |wk|, with the words of the first block followed by the ones of the
+     * second.
+     */
+    template <int g>
+    inline void store(__m256i x) {
+        w[g] = x;
+        __m128i k = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(sha256_k + 4 * g));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(wk + 8 * g),
+            _mm256_add_epi32(x, _mm256_broadcastsi128_si256(k)));
+    }
+};
+
+/**
+ * A group of four rounds; the schedule computes the words of group g + 4
+ * after group g.
+ */
+struct Group {
+    template <int g>
+    static inline void run(uint32_t *v, const uint32_t *wk) {
+        round<4 * g + 0>(v, wk);
+        round<4 * g + 1>(v, wk);
+        round<4 * g + 2>(v, wk);
+        round<4 * g + 3>(v, wk);
+    }
+};
+
+typedef InterleavedRounds<Group, 0, 16, 4> Rounds;
+
+inline __m256i load_2blocks(const uint8_t *data, __m256i byte_swap) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 64));
+    return _mm256_shuffle_epi8(
+        _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1),
+        byte_swap);
+}
+
+/**
+ * Load a lone block into both lanes; only the low one is used.
+ */
+inline __m256i load_1block(const uint8_t *data, __m256i byte_swap) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(x), byte_swap);
+}
+
+}
+
+void sha256_compress_avx2(uint32_t *state, const uint8_t *data,
+                          size_t num_blocks) {
+    const __m256i byte_swap = _mm256_set_epi8(
+        12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+        12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+    uint32_t wk[128];
+    Schedule schedule;
+    schedule.wk = wk;
+    NoSchedule no_schedule;
+
+    for (; num_blocks >= 2; num_blocks -= 2, data += 128) {
+        schedule.store<0>(load_2blocks(data, byte_swap));
+        schedule.store<1>(load_2blocks(data + 16, byte_swap));
+        schedule.store<2>(load_2blocks(data + 32, byte_swap));
+        schedule.store<3>(load_2blocks(data + 48, byte_swap));
+
+        uint32_t v[8];
+        for (size_t j = 0; j < 8; j++) {
+            v[j] = state[j];
+        }
+        Rounds::run(v, wk, schedule);
+        for (size_t j = 0; j < 8; j++) {
+            state[j] += v[j];
+            v[j] = state[j];
+        }
+
+        Rounds::run(v, wk + 4, no_schedule);
+        for (size_t j = 0; j < 8; j++) {
+            state[j] += v[j];
+        }
+    }
+
+    // A lone block, such as the last one of a message, still gets the vector
+    // schedule; the high lanes compute a copy of it which is never used.
+    if (num_blocks > 0) {
+        schedule.store<0>(load_1block(data, byte_swap));
+        schedule.store<1>(load_1block(data + 16, byte_swap));
+        schedule.store<2>(load_1block(data + 32, byte_swap));
+        schedule.store<3>(load_1block(data + 48, byte_swap));
+
+        uint32_t v[8];
+        for (size_t j = 0; j < 8; j++) {
+            v[j] = state[j];
+        }
+        Rounds::run(v, wk, schedule);
+        for (size_t j = 0; j < 8; j++) {
+            state[j] += v[j];
+        }
+    }
+}
+
+}
@@ -0,0 +1,23 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#ifndef __CRYPTO_HASH_SHA256_SHA256_K_HH
+#define __CRYPTO_HASH_SHA256_SHA256_K_HH
+
+#include <cstdint>
+
+namespace crypto {
+
+/**
+ * The SHA-256 round constants, shared by the implementations of the
+ * compression function.
+ */
+extern const uint32_t sha256_k[64];
+
+}
+
+#endif /* __CRYPTO_HASH_SHA256_SHA256_K_HH */
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// SHA-256 using the SHA extensions, compiled with -msha -msse4.1.
+//
+// sha256rnds2 does two rounds on the state split into ABEF and CDGH, taking
+// W + K for both in the low half of its third operand; each group of four
+// rounds is two of them.  The message schedule is computed four words at a
+// time, interleaved with the rounds: the words of group g + 1 are started
+// with sha256msg1 in group g - 2 and finished with sha256msg2 in group g.
+
+#include "crypto/hash/sha256.hh"
+#include "crypto/hash/sha256/sha256_k.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+/**
+ * Rounds 4 * g to 4 * g + 3.  |msg| holds the message words of groups g to
+ * g + 3, with group g in msg[g % 4].
+ */
+template <int g>
+inline void rounds4(__m128i &abef, __m128i &cdgh, __m128i *msg) {
+    __m128i wk = _mm_add_epi32(
+        msg[g % 4],
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(sha256_k + 4 * g)));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+    if (g >= 3 && g <= 14) {
+        __m128i w7 = _mm_alignr_epi8(msg[g % 4], msg[(g + 3) % 4], 4);
+        msg[(g + 1) % 4] = _mm_add_epi32(msg[(g + 1) % 4], w7);
+        msg[(g + 1) % 4] = _mm_sha256msg2_epu32(msg[(g + 1) % 4],
+                                                msg[g % 4]);
+    }
+    wk = _mm_shuffle_epi32(wk, 0x0e);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, wk);
+    if (g >= 1 && g <= 12) {
+        msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4],
+                                                msg[g % 4]);
+    }
+}
+
+template <int g>
+struct Rounds {
+    static inline void run(__m128i &abef, __m128i &cdgh, __m128i *msg) {
+        rounds4<g>(abef, cdgh, msg);
+        Rounds<g + 1>::run(abef, cdgh, msg);
+    }
+};
+
+template <>
+struct Rounds<16> {
+    static inline void run(__m128i &, __m128i &, __m128i *) {}
+};
+
+}
+
+void sha256_compress_shani(uint32_t *state, const uint8_t *data,
+                           size_t num_blocks) {
+    // Reverses the bytes of each word
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                             0x0405060700010203ULL);
+
+    // Rearrange A-H from the state into ABEF and CDGH, with A and C in the
+    // highest lanes
+    __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+    __m128i efgh =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(state + 4));
+    __m128i cdab = _mm_shuffle_epi32(abcd, 0xb1);
+    __m128i hgfe = _mm_shuffle_epi32(efgh, 0x1b);
+    __m128i abef = _mm_alignr_epi8(cdab, hgfe, 8);
+    __m128i cdgh = _mm_blend_epi16(hgfe, cdab, 0xf0);
+
+    for (size_t i = 0; i < num_blocks; i++, data += 64) {
+        __m128i abef_save = abef;
+        __m128i cdgh_save = cdgh;
+
+        __m128i msg[4];
+        for (size_t j = 0; j < 4; j++) {
+            msg[j] = _mm_shuffle_epi8(
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(data + 16 * j)),
+                byte_swap);
+        }
+
+        Rounds<0>::run(abef, cdgh, msg);
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+    abcd = _mm_blend_epi16(feba, dchg, 0xf0);
+    efgh = _mm_alignr_epi8(dchg, feba, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), abcd);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state + 4), efgh);
+}
+
+}
@@ -0,0 +1,271 @@
+#include "gtest/gtest.h"
+
+#include "crypto/hash/sha256.hh"
+#include "crypto/cpu.hh"
+#include "crypto/testutils/hash_tester.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include <random>
+
+namespace {
+
+struct HashVector {
+    const char *input;
+    size_t repeat;
+    const char *sha256;
+    const char *sha224;
+};
+
+// The examples of FIPS 180-4 and its companion documents
+const HashVector FIPSVectors[] = {
+    { "", 1,
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+      "d14a028c2a3a2bc9476102bb288234c415a2b01f828ea62ac5b3e42f" },
+    { "abc", 1,
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+      "23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da7" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+      "75388b16512776cc5dba5da1fd890150b0c6455cb4f58b1952522525" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+      "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+      "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+      "c97ca9a559850ce97a04a96def6d99a9e0e0e2ab14e6b8df265fc0b3" },
+    { "a", 1000000,
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+      "20794655980c91d8bbb4c1ea97618a4bf03f42581948b2ee4ee7ad67" },
+};
+
+struct HMACVector {
+    const char *key;
+    const char *input;
+    const char *sha256;
+    const char *sha224;
+};
+
+// RFC 4231, except for the test case with truncated output
+const HMACVector RFC4231Vectors[] = {
+    { "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+      "4869205468657265",
+      "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+      "896fb1128abbdf196832107cd49df33f47b4b1169912ba4f53684b22" },
+    { "4a656665",
+      "7768617420646f2079612077616e7420666f72206e6f7468696e673f",
+      "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+      "a30e01098bc6dbbf45690f3a7e9e6d0f8bbea2a39e6148008fd05e44" },
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd"
+      "dddddddddddddddddddddddddddddddd",
+      "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe",
+      "7fb3cb3588c6c1f6ffa9694d7d6ad2649365b0c1f65d69d1ec8333ea" },
+    { "0102030405060708090a0b0c0d0e0f10111213141516171819",
+      "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd"
+      "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd",
+      "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b",
+      "6c11506874013cac6a2abc1bb382627cec6a90d86efc012de7afec5a" },
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "54657374205573696e67204c6172676572205468616e20426c6f636b2d53697a65"
+      "204b6579202d2048617368204b6579204669727374",
+      "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+      "95e9a0db962095adaebe9b2d6f0dbce2d499f112f2d2b7273fa6870e" },
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "5468697320697320612074657374207573696e672061206c617267657220746861"
+      "6e20626c6f636b2d73697a65206b657920616e642061206c617267657220746861"
+      "6e20626c6f636b2d73697a6520646174612e20546865206b6579206e6565647320"
+      "746f20626520686173686564206265666f7265206265696e672075736564206279"
+      "2074686520484d414320616c676f726974686d2e",
+      "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2",
+      "3a854166ac5d9f023f54d517d0b39dbd946770db9c2b95c9f6f565d1" },
+};
+
+template <class Impl>
+crypto::HashFunctionFactory factory() {
+    return []() { return crypto::HashFunction_u(new Impl()); };
+}
+
+/**
+ * Check the FIPS and RFC 4231 vectors with the SHA-256 and SHA-224 versions
+ * of one implementation.
+ */
+template <class Impl256, class Impl224>
+void test_vectors() {
+    for (const HashVector &vector : FIPSVectors) {
+        std::string input;
+        for (size_t i = 0; i < vector.repeat; i++) {
+            input += vector.input;
+        }
+        crypto::memslice data = crypto::cmem(input.data(), input.size());
+
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha256),
+                  *crypto::hash(factory<Impl256>(), data))
+            << vector.input;
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha224),
+                  *crypto::hash(factory<Impl224>(), data))
+            << vector.input;
+    }
+
+    for (const HMACVector &vector : RFC4231Vectors) {
+        crypto::bytestring key = crypto::bytestring::from_hex(vector.key);
+        crypto::bytestring input = crypto::bytestring::from_hex(vector.input);
+
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha256),
+                  *crypto::hmac(factory<Impl256>(), key.cmem(), input.cmem()))
+            << vector.key;
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha224),
+                  *crypto::hmac(factory<Impl224>(), key.cmem(), input.cmem()))
+            << vector.key;
+    }
+}
+
+// Compare against SHA256Impl, with chunk sizes straddling the block
+// boundaries
+void test_against_impl(const crypto::HashFunctionFactory &factory) {
+    crypto::test_randomized_hash_compat(::factory<crypto::SHA256Impl>(),
+                                        factory, 300,
+                                        { 1, 7, 63, 65, 300 }, 256);
+}
+
+}
+
+TEST(SHA256, PortableVectors) {
+    test_vectors<crypto::SHA256Impl, crypto::SHA224Impl>();
+}
+
+TEST(SHA256, AVX2Vectors) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2() || !cpu.has_bmi2()) {
+        return;
+    }
+
+    test_vectors<crypto::SHA256AVX2, crypto::SHA224AVX2>();
+}
+
+TEST(SHA256, SHANIVectors) {
+    crypto::CPU cpu;
+    if (!cpu.has_sha() || !cpu.has_sse41()) {
+        return;
+    }
+
+    test_vectors<crypto::SHA256SHANI, crypto::SHA224SHANI>();
+}
+
+TEST(SHA256, AVX2AgainstPortable) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2() || !cpu.has_bmi2()) {
+        return;
+    }
+
+    test_against_impl(factory<crypto::SHA256AVX2>());
+}
+
+TEST(SHA256, SHANIAgainstPortable) {
+    crypto::CPU cpu;
+    if (!cpu.has_sha() || !cpu.has_sse41()) {
+        return;
+    }
+
+    test_against_impl(factory<crypto::SHA256SHANI>());
+}
+
+TEST(SHA256, Factories) {
+    crypto::SHA256Base_u sha256 = crypto::SHA256();
+    EXPECT_EQ(32u, sha256->get_output_size());
+    sha256->update(crypto::cmem("abc", 3));
+    EXPECT_EQ(crypto::bytestring::from_hex(FIPSVectors[1].sha256),
+              *sha256->finish());
+
+    crypto::SHA224Base_u sha224 = crypto::SHA224();
+    EXPECT_EQ(28u, sha224->get_output_size());
+    sha224->update(crypto::cmem("abc", 3));
+    EXPECT_EQ(crypto::bytestring::from_hex(FIPSVectors[1].sha224),
+              *sha224->finish());
+}
+
+// A running transcript hash, as in a TLS handshake: finish_copy() at every
+// point matches hashing the prefix, and the hash can be continued
+TEST(SHA256, Snapshots) {
+    std::mt19937 rng(5);
+    crypto::bytestring input = crypto::random_bytes(rng, 1000);
+
+    crypto::HashFunction_u hash = crypto::SHA256();
+    for (size_t i = 0; i < input.size(); i += 97) {
+        size_t len = std::min<size_t>(97, input.size() - i);
+        hash->update(crypto::cmem(input.cptr() + i, len));
+        EXPECT_EQ(*crypto::hash(factory<crypto::SHA256Impl>(),
+                                crypto::cmem(input.cptr(), i + len)),
+                  *hash->finish_copy())
+            << "Length " << i + len;
+    }
+
+    crypto::HashFunction_u copy = hash->clone();
+    EXPECT_EQ(*crypto::hash(factory<crypto::SHA256Impl>(), input.mem()),
+              *hash->finish());
+    EXPECT_EQ(std::string("SHA256"), copy->get_name());
+    copy->update(crypto::cmem("abc", 3));
+    crypto::HashFunction_u extended = factory<crypto::SHA256Impl>()();
+    extended->update(input.mem());
+    extended->update(crypto::cmem("abc", 3));
+    EXPECT_EQ(*extended->finish(), *copy->finish());
+}
+
+// One HMAC object reused with reset() for messages of different lengths, with
+// a key shorter and one longer than the block
+TEST(SHA256, HMACReset) {
+    std::mt19937 rng(7);
+    for (size_t key_len : { 32, 100 }) {
+        crypto::bytestring key = crypto::random_bytes(rng, key_len);
+        crypto::HMAC mac(crypto::SHA256, key.cmem());
+        mac.reset();
+
+        for (size_t len : { 0, 13, 64, 200, 1000 }) {
+            crypto::bytestring input = crypto::random_bytes(rng, len);
+            mac.update(input.cmem());
+            EXPECT_EQ(*crypto::hmac(factory<crypto::SHA256Impl>(), key.cmem(),
+                                    input.cmem()),
+                      *mac.finish())
+                << "Key length " << key_len << ", length " << len;
+            mac.reset();
+        }
+    }
+}
+
+// The allocation-free outputs: the one-shot digests and HMAC::finish_into()
+TEST(SHA256, Digest) {
+    for (const HashVector &vector : FIPSVectors) {
+        std::string input;
+        for (size_t i = 0; i < vector.repeat; i++) {
+            input += vector.input;
+        }
+        crypto::memslice data = crypto::cmem(input.data(), input.size());
+
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha256),
+                  crypto::bytestring(crypto::sha256_digest(data).cmem()));
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha224),
+                  crypto::bytestring(crypto::sha224_digest(data).cmem()));
+    }
+
+    for (const HMACVector &vector : RFC4231Vectors) {
+        crypto::bytestring key = crypto::bytestring::from_hex(vector.key);
+        crypto::bytestring input = crypto::bytestring::from_hex(vector.input);
+
+        crypto::HMAC mac(crypto::SHA256, key.cmem());
+        crypto::SHA256Digest digest;
+        EXPECT_EQ(digest.size(), mac.get_output_size());
+        mac.update(input.cmem());
+        mac.finish_into(digest.mem());
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha256),
+                  crypto::bytestring(digest.cmem()))
+            << vector.key;
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
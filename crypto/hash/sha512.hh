@@ -0,0 +1,142 @@
+#ifndef __CRYPTO_HASH_SHA512_HH
+#define __CRYPTO_HASH_SHA512_HH
+
+#include "crypto/hash.hh"
+#include "crypto/hash/merkle_damgard.hh"
+
+namespace crypto {
+
+class SHA512Base : public HashFunction {
+  public:
+    virtual const char *get_name() const override {
+        return "SHA512";
+    }
+
+    virtual size_t get_block_size() const override {
+        return 128;
+    }
+
+    virtual size_t get_output_size() const override {
+        return 64;
+    }
+};
+
+typedef std::unique_ptr<SHA512Base> SHA512Base_u;
+SHA512Base_u SHA512();
+
+typedef Digest<64> SHA512Digest;
+
+/**
+ * Hash |data| in one go, using the fastest compression function the CPU
+ * supports.  Unlike going through SHA512(), does not allocate.
+ */
+SHA512Digest sha512_digest(const memslice data);
+
+/**
+ * SHA-384 is SHA-512 with a different initial state and the output
+ * truncated to six words.
+ */
+class SHA384Base : public HashFunction {
+  public:
+    virtual const char *get_name() const override {
+        return "SHA384";
+    }
+
+    virtual size_t get_block_size() const override {
+        return 128;
+    }
+
+    virtual size_t get_output_size() const override {
+        return 48;
+    }
+};
+
+typedef std::unique_ptr<SHA384Base> SHA384Base_u;
+SHA384Base_u SHA384();
+
+typedef Digest<48> SHA384Digest;
+
+/**
+ * Hash |data| in one go, using the fastest compression function the CPU
+ * supports.  Unlike going through SHA384(), does not allocate.
+ */
+SHA384Digest sha384_digest(const memslice data);
+
+/**
+ * Run the SHA-512 compression function over |num_blocks| consecutive
+ * 128-byte blocks of |data|, updating the eight-word |state|.  Does not do
+ * any padding.  Uses the fastest of the functions below which the CPU
+ * supports.
+ */
+void sha512_compress(uint64_t *state, const uint8_t *data, size_t num_blocks);
+
+typedef void (*SHA512CompressFunction)(uint64_t *state, const uint8_t *data,
+                                       size_t num_blocks);
+
+/**
+ * The implementations of the compression function.  The AVX2 one may only be
+ * called if the CPU has AVX2 and BMI2.
+ */
+void sha512_compress_portable(uint64_t *state, const uint8_t *data,
+                              size_t num_blocks);
+void sha512_compress_avx2(uint64_t *state, const uint8_t *data,
+                          size_t num_blocks);
+
+/**
+ * The buffering and padding shared by SHA-512 and SHA-384.
+ */
+typedef MerkleDamgard<uint64_t, 8, 128, 16> SHA512State;
+
+class SHA512Blocks : public SHA512Base {
+  private:
+    SHA512State state;
+
+  public:
+    SHA512Blocks(SHA512CompressFunction compress);
+
+    virtual void update(const memslice data) override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
+};
+
+class SHA512Impl : public SHA512Blocks {
+  public:
+    SHA512Impl() : SHA512Blocks(sha512_compress_portable) {}
+};
+
+/**
+ * SHA-512 with the message schedules of two blocks computed at once in AVX2
+ * registers, interleaved with the scalar rounds.  Needs BMI2 as well.
+ */
+class SHA512AVX2 : public SHA512Blocks {
+  public:
+    SHA512AVX2() : SHA512Blocks(sha512_compress_avx2) {}
+};
+
+class SHA384Blocks : public SHA384Base {
+  private:
+    SHA512State state;
+
+  public:
+    SHA384Blocks(SHA512CompressFunction compress);
+
+    virtual void update(const memslice data) override;
+    virtual void finish_into(memslice output) override;
+    virtual HashFunction_u clone() const override;
+    virtual void assign(const HashFunction &other) override;
+};
+
+class SHA384Impl : public SHA384Blocks {
+  public:
+    SHA384Impl() : SHA384Blocks(sha512_compress_portable) {}
+};
+
+class SHA384AVX2 : public SHA384Blocks {
+  public:
+    SHA384AVX2() : SHA384Blocks(sha512_compress_avx2) {}
+};
+
+}
+
+#endif /* __CRYPTO_HASH_SHA512_HH */
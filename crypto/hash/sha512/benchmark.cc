@@ -0,0 +1,38 @@
+#include "crypto/hash/sha512.hh"
+#include "crypto/cpu.hh"
+
+#include "crypto/testutils/benchmark.hh"
+
+namespace {
+
+using crypto::bytestring;
+
+void benchmark_hash(const char *desc, const crypto::HashFunctionFactory &factory) {
+    for (size_t size : { 64, 1024, 16384 }) {
+        bytestring input(size);
+        size_t iterations = size < 1024 ? 10000 : 100;
+
+        crypto::report_benchmark(
+            desc, "SHA-512", size,
+            crypto::cycles_per_byte([&]() {
+                crypto::hash(factory, input.mem());
+            }, size, iterations));
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    crypto::CPU cpu;
+
+    benchmark_hash("Portable", []() {
+        return crypto::SHA512Base_u(new crypto::SHA512Impl());
+    });
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        benchmark_hash("AVX2", []() {
+            return crypto::SHA512Base_u(new crypto::SHA512AVX2());
+        });
+    }
+
+    return 0;
+}
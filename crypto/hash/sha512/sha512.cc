@@ -0,0 +1,246 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+#include "crypto/hash/sha512.hh"
+#include "crypto/hash/sha512/sha512_k.hh"
+#include "crypto/assert.hh"
+#include "crypto/cpu.hh"
+#include "crypto/dispatch.hh"
+
+namespace crypto {
+
+const uint64_t sha512_k[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+    0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+    0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+    0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+    0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+    0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+    0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+    0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+    0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+    0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+    0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+    0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+    0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+    0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+namespace {
+
+const uint64_t sha512_iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+const uint64_t sha384_iv[8] = {
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL,
+    0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+    0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+    0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+};
+
+typedef SHA512Base *(*SHA512Constructor)();
+typedef SHA384Base *(*SHA384Constructor)();
+
+SHA512Constructor select_sha512_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        return construct<SHA512Base, SHA512AVX2>;
+    }
+
+    return construct<SHA512Base, SHA512Impl>;
+}
+
+SHA384Constructor select_sha384_implementation() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        return construct<SHA384Base, SHA384AVX2>;
+    }
+
+    return construct<SHA384Base, SHA384Impl>;
+}
+
+SHA512CompressFunction select_compress_function() {
+    const CPU &cpu = CPU::Get();
+
+    if (cpu.has_avx2() && cpu.has_bmi2()) {
+        return sha512_compress_avx2;
+    }
+
+    return sha512_compress_portable;
+}
+
+inline uint64_t ror(uint64_t x, int n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+inline uint64_t load_be64(const uint8_t *p) {
+    uint64_t x = 0;
+    for (size_t i = 0; i < 8; i++) {
+        x = (x << 8) | p[i];
+    }
+    return x;
+}
+
+}
+
+SHA512Base_u SHA512() {
+    static const SHA512Constructor constructor =
+        select_sha512_implementation();
+    return SHA512Base_u(constructor());
+}
+
+SHA384Base_u SHA384() {
+    static const SHA384Constructor constructor =
+        select_sha384_implementation();
+    return SHA384Base_u(constructor());
+}
+
+void sha512_compress(uint64_t *state, const uint8_t *data,
+                     size_t num_blocks) {
+    static const SHA512CompressFunction compress = select_compress_function();
+    compress(state, data, num_blocks);
+}
+
+SHA512Digest sha512_digest(const memslice data) {
+    SHA512Blocks hash(sha512_compress);
+    hash.update(data);
+    SHA512Digest digest;
+    hash.finish_into(digest.mem());
+    return digest;
+}
+
+SHA384Digest sha384_digest(const memslice data) {
+    SHA384Blocks hash(sha512_compress);
+    hash.update(data);
+    SHA384Digest digest;
+    hash.finish_into(digest.mem());
+    return digest;
+}
+
+void sha512_compress_portable(uint64_t *state, const uint8_t *data,
+                              size_t num_blocks) {
+    for (size_t block = 0; block < num_blocks; block++, data += 128) {
+        uint64_t w[80];
+        for (size_t t = 0; t < 16; t++) {
+            w[t] = load_be64(data + 8 * t);
+        }
+        for (size_t t = 16; t < 80; t++) {
+            uint64_t s0 = ror(w[t - 15], 1) ^ ror(w[t - 15], 8) ^
+                          (w[t - 15] >> 7);
+            uint64_t s1 = ror(w[t - 2], 19) ^ ror(w[t - 2], 61) ^
+                          (w[t - 2] >> 6);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t t = 0; t < 80; t++) {
+            uint64_t s1 = ror(e, 14) ^ ror(e, 18) ^ ror(e, 41);
+            uint64_t ch = g ^ (e & (f ^ g));
+            uint64_t t1 = h + s1 + ch + sha512_k[t] + w[t];
+            uint64_t s0 = ror(a, 28) ^ ror(a, 34) ^ ror(a, 39);
+            uint64_t maj = (a & b) | (c & (a | b));
+            uint64_t t2 = s0 + maj;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+SHA512Blocks::SHA512Blocks(SHA512CompressFunction compress)
+    : state(compress, sha512_iv) {}
+
+void SHA512Blocks::update(const memslice data) {
+    state.update(data);
+}
+
+void SHA512Blocks::finish_into(memslice output) {
+    contract_assert(output.size() == 64);
+    state.finish(output.ptr(), 8);
+}
+
+HashFunction_u SHA512Blocks::clone() const {
+    return HashFunction_u(new SHA512Blocks(*this));
+}
+
+void SHA512Blocks::assign(const HashFunction &other) {
+    const SHA512Blocks *source = dynamic_cast<const SHA512Blocks *>(&other);
+    contract_assert(source != nullptr);
+    *this = *source;
+}
+
+SHA384Blocks::SHA384Blocks(SHA512CompressFunction compress)
+    : state(compress, sha384_iv) {}
+
+void SHA384Blocks::update(const memslice data) {
+    state.update(data);
+}
+
+void SHA384Blocks::finish_into(memslice output) {
+    contract_assert(output.size() == 48);
+    state.finish(output.ptr(), 6);
+}
+
+HashFunction_u SHA384Blocks::clone() const {
+    return HashFunction_u(new SHA384Blocks(*this));
+}
+
+void SHA384Blocks::assign(const HashFunction &other) {
+    const SHA384Blocks *source = dynamic_cast<const SHA384Blocks *>(&other);
+    contract_assert(source != nullptr);
+    *this = *source;
+}
+
+}
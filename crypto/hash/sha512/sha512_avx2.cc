@@ -0,0 +1,211 @@
+/**
+ * Copyright (C) 2014 The libseal Authors.  All rights reservied.
+ *
+ * Use of this source code file is governed by MIT license, as stated in the
+ * LICENSE file.
+ */
+
+// SHA-512 with the message schedules of two blocks computed at once using
+// AVX2.  Compiled with -mavx2 -mbmi2; BMI2 gives the scalar rounds rorx.
+//
+// Each vector holds two consecutive message words of the first block in its
+// low 128-bit lane and the same words of the second block in the high one.
+// W[t] and W[t + 1] only depend on words at least two positions back, so
+// unlike in SHA-256 a whole vector is computed at once.  The schedule is
+// computed during the rounds of the first block, and the second block then
+// only needs the scalar rounds.
+
+#include "crypto/hash/interleaved_rounds.hh"
+#include "crypto/hash/sha512.hh"
+#include "crypto/hash/sha512/sha512_k.hh"
+
+#include <immintrin.h>
+
+namespace crypto {
+
+namespace {
+
+inline uint64_t ror(uint64_t x, int n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+template <int n>
+inline __m256i ror(__m256i x) {
+    return _mm256_or_si256(_mm256_srli_epi64(x, n),
+                           _mm256_slli_epi64(x, 64 - n));
+}
+
+inline __m256i sigma0(__m256i x) {
+    return _mm256_xor_si256(_mm256_xor_si256(ror<1>(x), ror<8>(x)),
+                            _mm256_srli_epi64(x, 7));
+}
+
+inline __m256i sigma1(__m256i x) {
+    return _mm256_xor_si256(_mm256_xor_si256(ror<19>(x), ror<61>(x)),
+                            _mm256_srli_epi64(x, 6));
+}
+
+/**
+ * SHA-512 round |t|.  The working variables rotate through |v| instead of
+ * being moved, so after inlining all indices are constants and |v| lives in
+ * registers.  |wk| holds W + K in pairs of words, four words apart.
+ */
+template <int t>
+inline void round(uint64_t *v, const uint64_t *wk) {
+    uint64_t &a = v[(8 - t % 8) % 8];
+    uint64_t &b = v[(9 - t % 8) % 8];
+    uint64_t &c = v[(10 - t % 8) % 8];
+    uint64_t &d = v[(11 - t % 8) % 8];
+    uint64_t &e = v[(12 - t % 8) % 8];
+    uint64_t &f = v[(13 - t % 8) % 8];
+    uint64_t &g = v[(14 - t % 8) % 8];
+    uint64_t &h = v[(15 - t % 8) % 8];
+
+    uint64_t t1 = h + (ror(e, 14) ^ ror(e, 18) ^ ror(e, 41)) +
+                  (g ^ (e & (f ^ g))) + wk[(t / 2) * 4 + t % 2];
+    uint64_t t2 = (ror(a, 28) ^ ror(a, 34) ^ ror(a, 39)) +
+                  ((a & b) | (c & (a | b)));
+    d += t1;
+    h = t1 + t2;
+}
+
+struct Schedule {
+    __m256i w[40];
+    uint64_t *wk;
+
+    /**
+     * Compute W[2g] and W[2g + 1] of both blocks from the previous words and
+     * store them.
+     */
+    template <int g>
+    inline void step() {
+        __m256i w15 = _mm256_alignr_epi8(w[g - 7], w[g - 8], 8);
+        __m256i w7 = _mm256_alignr_epi8(w[g - 3], w[g - 4], 8);
+        __m256i x = _mm256_add_epi64(_mm256_add_epi64(w[g - 8], w7),
+                                     _mm256_add_epi64(sigma0(w15),
+                                                      sigma1(w[g - 1])));
+        store<g>(x);
+    }
+
+    /**
+     * Keep W[2g] and W[2g + 1] for the rest of the schedule and store them
+     * plus K to |wk|, with the words of the first block followed by the ones
+     * of the second.
+     */
+    template <int g>
+    inline void store(__m256i x) {
+        w[g] = x;
+        __m128i k = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(sha512_k + 2 * g));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(wk + 4 * g),
+            _mm256_add_epi64(x, _mm256_broadcastsi128_si256(k)));
+    }
+};
+
+/**
+ * A pair of rounds; the schedule computes the words of pair g + 8 after
+ * pair g.
+ */
+struct Group {
+    template <int g>
+    static inline void run(uint64_t *v, const uint64_t *wk) {
+        round<2 * g + 0>(v, wk);
+        round<2 * g + 1>(v, wk);
+    }
+};
+
+typedef InterleavedRounds<Group, 0, 40, 8> Rounds;
+
+inline __m256i load_2blocks(const uint8_t *data, __m256i byte_swap) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 128));
+    return _mm256_shuffle_epi8(
+        _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1),
+        byte_swap);
+}
+
+/**
+ * Load a lone block into both lanes; only the low one is used.
+ */
+inline __m256i load_1block(const uint8_t *data, __m256i byte_swap) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(x), byte_swap);
+}
+
+template <int g>
+inline void load_words(Schedule &schedule, const uint8_t *data,
+                       __m256i byte_swap) {
+    schedule.store<g>(load_2blocks(data + 16 * g, byte_swap));
+}
+
+template <int g>
+inline void load_lone_words(Schedule &schedule, const uint8_t *data,
+                            __m256i byte_swap) {
+    schedule.store<g>(load_1block(data + 16 * g, byte_swap));
+}
+
+}
+
+void sha512_compress_avx2(uint64_t *state, const uint8_t *data,
+                          size_t num_blocks) {
+    const __m256i byte_swap = _mm256_set_epi8(
+        8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+        8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+
+    uint64_t wk[160];
+    Schedule schedule;
+    schedule.wk = wk;
+    NoSchedule no_schedule;
+
+    for (; num_blocks >= 2; num_blocks -= 2, data += 256) {
+        load_words<0>(schedule, data, byte_swap);
+        load_words<1>(schedule, data, byte_swap);
+        load_words<2>(schedule, data, byte_swap);
+        load_words<3>(schedule, data, byte_swap);
+        load_words<4>(schedule, data, byte_swap);
+        load_words<5>(schedule, data, byte_swap);
+        load_words<6>(schedule, data, byte_swap);
+        load_words<7>(schedule, data, byte_swap);
+
+        uint64_t v[8];
+        for (size_t j = 0; j < 8; j++) {
+            v[j] = state[j];
+        }
+        Rounds::run(v, wk, schedule);
+        for (size_t j = 0; j < 8; j++) {
+            state[j] += v[j];
+            v[j] = state[j];
+        }
+
+        Rounds::run(v, wk + 2, no_schedule);
+        for (size_t j = 0; j < 8; j++) {
+            state[j] += v[j];
+        }
+    }
+
+    // A lone block, such as the last one of a message, still gets the vector
+    // schedule; the high lanes compute a copy of it which is never used.
+    if (num_blocks > 0) {
+        load_lone_words<0>(schedule, data, byte_swap);
+        load_lone_words<1>(schedule, data, byte_swap);
+        load_lone_words<2>(schedule, data, byte_swap);
+        load_lone_words<3>(schedule, data, byte_swap);
+        load_lone_words<4>(schedule, data, byte_swap);
+        load_lone_words<5>(schedule, data, byte_swap);
+        load_lone_words<6>(schedule, data, byte_swap);
+        load_lone_words<7>(schedule, data, byte_swap);
+
+        uint64_t v[8];
+        for (size_t j = 0; j < 8; j++) {
+            v[j] = state[j];
+        }
+        Rounds::run(v, wk, schedule);
+        for (size_t j = 0; j < 8; j++) {
+            state[j] += v[j];
+        }
+    }
+}
+
+}
@@ -0,0 +1,209 @@
+#include "gtest/gtest.h"
+
+#include "crypto/hash/sha512.hh"
+#include "crypto/cpu.hh"
+#include "crypto/testutils/hash_tester.hh"
+
+namespace {
+
+struct HashVector {
+    const char *input;
+    size_t repeat;
+    const char *sha512;
+    const char *sha384;
+};
+
+// The examples of FIPS 180-4 and its companion documents
+const HashVector FIPSVectors[] = {
+    { "", 1,
+      "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+      "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e",
+      "38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da"
+      "274edebfe76f65fbd51ad2f14898b95b" },
+    { "abc", 1,
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+      "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+      "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed"
+      "8086072ba1e7cc2358baeca134c825a7" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+      "204a8fc6dda82f0a0ced7beb8e08a41657c16ef468b228a8279be331a703c335"
+      "96fd15c13b1b07f9aa1d3bea57789ca031ad85c7a71dd70354ec631238ca3445",
+      "3391fdddfc8dc7393707a65b1b4709397cf8b1d162af05abfe8f450de5f36bc6"
+      "b0455a8520bc4e6f5fe95b1fe3c8452b" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmno"
+      "ijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+      "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+      "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909",
+      "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712"
+      "fcc7c71a557e2db966c3e9fa91746039" },
+    { "a", 1000000,
+      "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973eb"
+      "de0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b",
+      "9d0e1809716474cb086e834e310a4a1ced149e9c00f248527972cec5704c2a5b"
+      "07b8b3dc38ecc4ebae97ddd87f3d8985" },
+};
+
+struct HMACVector {
+    const char *key;
+    const char *input;
+    const char *sha512;
+    const char *sha384;
+};
+
+// RFC 4231, except for the test case with truncated output
+const HMACVector RFC4231Vectors[] = {
+    { "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+      "4869205468657265",
+      "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cde"
+      "daa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854",
+      "afd03944d84895626b0825f4ab46907f15f9dadbe4101ec682aa034c7cebc59c"
+      "faea9ea9076ede7f4af152e8b2fa9cb6" },
+    { "4a656665",
+      "7768617420646f2079612077616e7420666f72206e6f7468696e673f",
+      "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+      "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737",
+      "af45d2e376484031617f78d2b58a6b1b9c7ef464f5a01b47e42ec3736322445e"
+      "8e2240ca5e69e2c78b3239ecfab21649" },
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd"
+      "dddddddddddddddddddddddddddddddd",
+      "fa73b0089d56a284efb0f0756c890be9b1b5dbdd8ee81a3655f83e33b2279d39"
+      "bf3e848279a722c806b485a47e67c807b946a337bee8942674278859e13292fb",
+      "88062608d3e6ad8a0aa2ace014c8a86f0aa635d947ac9febe83ef4e55966144b"
+      "2a5ab39dc13814b94e3ab6e101a34f27" },
+    { "0102030405060708090a0b0c0d0e0f10111213141516171819",
+      "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd"
+      "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd",
+      "b0ba465637458c6990e5a8c5f61d4af7e576d97ff94b872de76f8050361ee3db"
+      "a91ca5c11aa25eb4d679275cc5788063a5f19741120c4f2de2adebeb10a298dd",
+      "3e8a69b7783c25851933ab6290af6ca77a9981480850009cc5577c6e1f573b4e"
+      "6801dd23c4a7d679ccf8a386c674cffb" },
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "54657374205573696e67204c6172676572205468616e20426c6f636b2d53697a65"
+      "204b6579202d2048617368204b6579204669727374",
+      "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+      "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598",
+      "4ece084485813e9088d2c63a041bc5b44f9ef1012a2b588f3cd11f05033ac4c6"
+      "0c2ef6ab4030fe8296248df163f44952" },
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "5468697320697320612074657374207573696e672061206c617267657220746861"
+      "6e20626c6f636b2d73697a65206b657920616e642061206c617267657220746861"
+      "6e20626c6f636b2d73697a6520646174612e20546865206b6579206e6565647320"
+      "746f20626520686173686564206265666f7265206265696e672075736564206279"
+      "2074686520484d414320616c676f726974686d2e",
+      "e37b6a775dc87dbaa4dfa9f96e5e3ffddebd71f8867289865df5a32d20cdc944"
+      "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58",
+      "6617178e941f020d351e2f254e8fd32c602420feb0b8fb9adccebb82461e99c5"
+      "a678cc31e799176d3860e6110c46523e" },
+};
+
+template <class Impl>
+crypto::HashFunctionFactory factory() {
+    return []() { return crypto::HashFunction_u(new Impl()); };
+}
+
+/**
+ * Check the FIPS and RFC 4231 vectors with the SHA-512 and SHA-384 versions
+ * of one implementation.
+ */
+template <class Impl512, class Impl384>
+void test_vectors() {
+    for (const HashVector &vector : FIPSVectors) {
+        std::string input;
+        for (size_t i = 0; i < vector.repeat; i++) {
+            input += vector.input;
+        }
+        crypto::memslice data = crypto::cmem(input.data(), input.size());
+
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha512),
+                  *crypto::hash(factory<Impl512>(), data))
+            << vector.input;
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha384),
+                  *crypto::hash(factory<Impl384>(), data))
+            << vector.input;
+    }
+
+    for (const HMACVector &vector : RFC4231Vectors) {
+        crypto::bytestring key = crypto::bytestring::from_hex(vector.key);
+        crypto::bytestring input = crypto::bytestring::from_hex(vector.input);
+
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha512),
+                  *crypto::hmac(factory<Impl512>(), key.cmem(), input.cmem()))
+            << vector.key;
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha384),
+                  *crypto::hmac(factory<Impl384>(), key.cmem(), input.cmem()))
+            << vector.key;
+    }
+}
+
+// Compare against SHA512Impl, with chunk sizes straddling the block
+// boundaries
+void test_against_impl(const crypto::HashFunctionFactory &factory) {
+    crypto::test_randomized_hash_compat(::factory<crypto::SHA512Impl>(),
+                                        factory, 600,
+                                        { 1, 7, 127, 129, 600 }, 512);
+}
+
+}
+
+TEST(SHA512, PortableVectors) {
+    test_vectors<crypto::SHA512Impl, crypto::SHA384Impl>();
+}
+
+TEST(SHA512, AVX2Vectors) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2() || !cpu.has_bmi2()) {
+        return;
+    }
+
+    test_vectors<crypto::SHA512AVX2, crypto::SHA384AVX2>();
+}
+
+TEST(SHA512, AVX2AgainstPortable) {
+    crypto::CPU cpu;
+    if (!cpu.has_avx2() || !cpu.has_bmi2()) {
+        return;
+    }
+
+    test_against_impl(factory<crypto::SHA512AVX2>());
+}
+
+TEST(SHA512, Factories) {
+    crypto::SHA512Base_u sha512 = crypto::SHA512();
+    EXPECT_EQ(64u, sha512->get_output_size());
+    sha512->update(crypto::cmem("abc", 3));
+    EXPECT_EQ(crypto::bytestring::from_hex(FIPSVectors[1].sha512),
+              *sha512->finish());
+
+    crypto::SHA384Base_u sha384 = crypto::SHA384();
+    EXPECT_EQ(48u, sha384->get_output_size());
+    sha384->update(crypto::cmem("abc", 3));
+    EXPECT_EQ(crypto::bytestring::from_hex(FIPSVectors[1].sha384),
+              *sha384->finish());
+}
+
+TEST(SHA512, Digest) {
+    for (const HashVector &vector : FIPSVectors) {
+        std::string input;
+        for (size_t i = 0; i < vector.repeat; i++) {
+            input += vector.input;
+        }
+        crypto::memslice data = crypto::cmem(input.data(), input.size());
+
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha512),
+                  crypto::bytestring(crypto::sha512_digest(data).cmem()));
+        EXPECT_EQ(crypto::bytestring::from_hex(vector.sha384),
+                  crypto::bytestring(crypto::sha384_digest(data).cmem()));
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,19 @@
+#include "crypto/testutils/benchmark.hh"
+
+#include <cstdio>
+
+#include <x86intrin.h>
+
+namespace crypto {
+
+uint64_t cycle_counter() {
+    return __rdtsc();
+}
+
+void report_benchmark(const char *impl, const char *operation, size_t bytes,
+                      double cpb) {
+    printf("%-28s %-24s %7zu bytes %9.2f cycles/byte\n", impl, operation, bytes,
+           cpb);
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef __CRYPTO_TESTUTILS_BENCHMARK_HH
+#define __CRYPTO_TESTUTILS_BENCHMARK_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace crypto {
+
+/**
+ * Returns the current value of the CPU timestamp counter.
+ */
+uint64_t cycle_counter();
+
+/**
+ * Run |fn|, which processes |bytes| bytes of data per invocation, repeatedly
+ * and return the number of cycles spent per byte.  The measurement is
+ * repeated several times and the best result is returned, in order to reduce
+ * the noise caused by interrupts and frequency scaling.
+ */
+template <typename Fn>
+double cycles_per_byte(Fn fn, size_t bytes, size_t iterations = 1000) {
+    // Warm up caches and branch predictors
+    for (size_t i = 0; i < iterations / 10 + 1; i++) {
+        fn();
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int run = 0; run < 5; run++) {
+        uint64_t start = cycle_counter();
+        for (size_t i = 0; i < iterations; i++) {
+            fn();
+        }
+        uint64_t elapsed = cycle_counter() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return static_cast<double>(best) / iterations / bytes;
+}
+
+/**
+ * Print a single line of benchmark results in a uniform format.
+ */
+void report_benchmark(const char *impl, const char *operation, size_t bytes,
+                      double cpb);
+
+}
+
+#endif /* __CRYPTO_TESTUTILS_BENCHMARK_HH */
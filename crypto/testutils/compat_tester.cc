@@ -12,7 +12,7 @@ void test_randomized_compat(BlockCipherFactory implA,
                             uint32_t iters) {
     std::mt19937 rng;
     rng.seed(12345); // Use fixed seed so the test is deterministic
-    std::uniform_int_distribution<uint8_t> all_bytes;
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
 
     size_t block_size;
     bytestring bogus_key(key_size);
@@ -54,4 +54,124 @@ void test_randomized_compat(BlockCipherFactory implA,
     }
 }
 
+void test_randomized_ctr_compat(BlockCipherFactory implA,
+                                BlockCipherFactory implB, size_t key_size,
+                                uint32_t iters) {
+    std::mt19937 rng;
+    rng.seed(12345); // Use fixed seed so the test is deterministic
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
+    std::uniform_int_distribution<size_t> lengths(0, 1024);
+    std::uniform_int_distribution<size_t> low_blocks(0, 16);
+
+    size_t block_size;
+    bytestring bogus_key(key_size);
+    block_size = implA(bogus_key.cmem())->get_block_size();
+    ASSERT_EQ(block_size, implB(bogus_key.cmem())->get_block_size());
+
+    bytestring buffer_key(key_size), iv(block_size), input;
+    bytestring outputA, outputB;
+    for (uint32_t i = 0; i < iters; i++) {
+        for (size_t j = 0; j < buffer_key.size(); j++) {
+            buffer_key[j] = all_bytes(rng);
+        }
+        BlockCipher_u cipherA = implA(buffer_key.cmem());
+        BlockCipher_u cipherB = implB(buffer_key.cmem());
+
+        // Set the counter to be a few blocks away from overflowing the
+        // lower 32 or 64 bits
+        for (size_t j = 0; j < iv.size(); j++) {
+            iv[j] = all_bytes(rng);
+        }
+        size_t ones = (i % 2) ? 8 : 4;
+        for (size_t j = block_size - ones; j < block_size; j++) {
+            iv[j] = 0xff;
+        }
+        iv[block_size - 1] -= low_blocks(rng);
+
+        input.resize(lengths(rng));
+        for (size_t j = 0; j < input.size(); j++) {
+            input[j] = all_bytes(rng);
+        }
+
+        cipherA->counter_xor(iv, input, outputA);
+        cipherB->counter_xor(iv, input, outputB);
+        ASSERT_EQ(outputA, outputB);
+
+        // Check that applying CTR twice yields the original input
+        cipherA->counter_xor(iv, outputB, outputA);
+        ASSERT_EQ(input, outputA);
+
+        // Check that in-place operation on a memslice matches
+        bytestring buffer(input);
+        cipherA->counter_xor(iv.cmem(), buffer.cmem(), buffer.mem());
+        ASSERT_EQ(outputB, buffer);
+    }
+}
+
+void test_randomized_cbc_compat(BlockCipherFactory implA,
+                                BlockCipherFactory implB, size_t key_size,
+                                uint32_t iters) {
+    std::mt19937 rng;
+    rng.seed(12345); // Use fixed seed so the test is deterministic
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
+    std::uniform_int_distribution<size_t> block_counts(0, 64);
+
+    size_t block_size;
+    bytestring bogus_key(key_size);
+    block_size = implA(bogus_key.cmem())->get_block_size();
+    ASSERT_EQ(block_size, implB(bogus_key.cmem())->get_block_size());
+
+    bytestring buffer_key(key_size), iv(block_size), input;
+    bytestring ciphertext, plaintext, blocksA, blocksB;
+    for (uint32_t i = 0; i < iters; i++) {
+        for (size_t j = 0; j < buffer_key.size(); j++) {
+            buffer_key[j] = all_bytes(rng);
+        }
+        BlockCipher_u cipherA = implA(buffer_key.cmem());
+        BlockCipher_u cipherB = implB(buffer_key.cmem());
+
+        for (size_t j = 0; j < iv.size(); j++) {
+            iv[j] = all_bytes(rng);
+        }
+        size_t num_blocks = block_counts(rng);
+        input.resize(num_blocks * block_size);
+        for (size_t j = 0; j < input.size(); j++) {
+            input[j] = all_bytes(rng);
+        }
+
+        // Check B_dec( A_enc(X) ) == X and vice versa
+        cipherA->encrypt_cbc(input, iv, ciphertext);
+        cipherB->decrypt_cbc(ciphertext, iv, plaintext);
+        ASSERT_EQ(input, plaintext);
+        cipherB->encrypt_cbc(input, iv, ciphertext);
+        cipherA->decrypt_cbc(ciphertext, iv, plaintext);
+        ASSERT_EQ(input, plaintext);
+
+        // Check that in-place encryption and decryption of a memslice match
+        bytestring buffer(input);
+        cipherA->encrypt_cbc(buffer.cmem(), iv.cmem(), buffer.mem());
+        ASSERT_EQ(ciphertext, buffer);
+        cipherB->decrypt_cbc(buffer.cmem(), iv.cmem(), buffer.mem());
+        ASSERT_EQ(input, buffer);
+
+        // Check that encrypting and decrypting many blocks at once matches
+        // processing them one by one
+        blocksA.resize(input.size());
+        blocksB.resize(input.size());
+        for (size_t j = 0; j < num_blocks; j++) {
+            cipherA->encrypt_block(input.cptr() + j * block_size,
+                                   blocksA.ptr() + j * block_size);
+        }
+        cipherB->encrypt_blocks(input.cptr(), blocksB.ptr(), num_blocks);
+        ASSERT_EQ(blocksA, blocksB);
+
+        for (size_t j = 0; j < num_blocks; j++) {
+            cipherA->decrypt_block(input.cptr() + j * block_size,
+                                   blocksA.ptr() + j * block_size);
+        }
+        cipherB->decrypt_blocks(input.cptr(), blocksB.ptr(), num_blocks);
+        ASSERT_EQ(blocksA, blocksB);
+    }
+}
+
 }
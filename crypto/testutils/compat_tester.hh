@@ -13,6 +13,24 @@ void test_randomized_compat(BlockCipherFactory cipherA,
                             BlockCipherFactory cipherB, size_t key_size,
                             uint32_t iters);
 
+/**
+ * Test that CTR mode of block ciphers A and B produces the same output for
+ * random inputs of random length.  The initial counters are chosen close to
+ * the values where the lower words overflow, in order to exercise carry
+ * propagation.
+ */
+void test_randomized_ctr_compat(BlockCipherFactory cipherA,
+                                BlockCipherFactory cipherB, size_t key_size,
+                                uint32_t iters);
+
+/**
+ * Test that CBC mode and multi-block decryption of block ciphers A and B are
+ * mutually compatible for random inputs of random length.
+ */
+void test_randomized_cbc_compat(BlockCipherFactory cipherA,
+                                BlockCipherFactory cipherB, size_t key_size,
+                                uint32_t iters);
+
 }
 
 #endif /* __CRYPTO_TESTUTILS_COMPAT_TESTER__ */
@@ -0,0 +1,31 @@
+#include "crypto/testutils/hash_tester.hh"
+#include "crypto/testutils/random_data.hh"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+namespace crypto {
+
+void test_randomized_hash_compat(HashFunctionFactory implA,
+                                 HashFunctionFactory implB, size_t max_length,
+                                 std::initializer_list<size_t> chunk_sizes,
+                                 uint32_t seed) {
+    std::mt19937 rng(seed);
+
+    for (size_t len = 0; len < max_length; len++) {
+        bytestring input = random_bytes(rng, len);
+        bytestring_u expected = hash(implA, input.mem());
+
+        for (size_t chunk : chunk_sizes) {
+            HashFunction_u hashB = implB();
+            for (size_t i = 0; i < len; i += chunk) {
+                hashB->update(cmem(input.cptr() + i, std::min(chunk, len - i)));
+            }
+            EXPECT_EQ(*expected, *hashB->finish())
+                << "Length " << len << ", chunk size " << chunk;
+        }
+    }
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef __CRYPTO_TESTUTILS_HASH_TESTER_HH
+#define __CRYPTO_TESTUTILS_HASH_TESTER_HH
+
+#include "crypto/hash.hh"
+
+#include <initializer_list>
+
+namespace crypto {
+
+/**
+ * Test that hash functions A and B agree on random inputs of every length
+ * below |max_length|, fed to B in chunks of each of |chunk_sizes| bytes.
+ * Chunk sizes next to the block size make the chunks straddle the block
+ * boundaries.
+ */
+void test_randomized_hash_compat(HashFunctionFactory implA,
+                                 HashFunctionFactory implB, size_t max_length,
+                                 std::initializer_list<size_t> chunk_sizes,
+                                 uint32_t seed);
+
+}
+
+#endif /* __CRYPTO_TESTUTILS_HASH_TESTER_HH */
@@ -0,0 +1,16 @@
+#include "crypto/testutils/random_data.hh"
+
+namespace crypto {
+
+bytestring random_bytes(std::mt19937 &rng, size_t size) {
+    // uniform_int_distribution is not defined for char types, so draw
+    // unsigned ints and truncate them
+    std::uniform_int_distribution<unsigned> all_bytes(0, 255);
+    bytestring result(size);
+    for (size_t i = 0; i < size; i++) {
+        result[i] = all_bytes(rng);
+    }
+    return result;
+}
+
+}
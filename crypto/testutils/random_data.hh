@@ -0,0 +1,18 @@
+#ifndef __CRYPTO_TESTUTILS_RANDOM_DATA_HH
+#define __CRYPTO_TESTUTILS_RANDOM_DATA_HH
+
+#include "crypto/common.hh"
+
+#include <random>
+
+namespace crypto {
+
+/**
+ * Returns |size| bytes drawn from |rng|.  Meant for tests which need
+ * reproducible inputs, not for anything secret.
+ */
+bytestring random_bytes(std::mt19937 &rng, size_t size);
+
+}
+
+#endif /* __CRYPTO_TESTUTILS_RANDOM_DATA_HH */